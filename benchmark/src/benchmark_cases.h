@@ -0,0 +1,34 @@
+#pragma once
+
+#include "benchmark_harness.h"
+#include <string>
+
+// Benchmark cases of canny_benchmark, one function per stage. Each checks its
+// kernels against a reference before timing them and throws on a mismatch.
+
+void RunGaussianFilterBenchmarks(BenchmarkHarness &harness);
+void RunGradientBenchmarks(BenchmarkHarness &harness);
+void RunNonMaxSuppressionBenchmarks(BenchmarkHarness &harness);
+void RunDoubleThresholdBenchmarks(BenchmarkHarness &harness);
+void RunHysteresisBenchmarks(BenchmarkHarness &harness);
+
+/**
+ * @brief FastCanny and OpenCV's blur and Canny end to end, on synthetic scenes
+ * and on every `<coco_image_path>/<size>x<size>` set when the path is not
+ * empty
+ */
+void RunCannyBenchmarks(BenchmarkHarness &harness,
+                        const std::string &cocoImagePath);
+
+// Detection modes on synthetic scenes, each checked against FastCanny before
+// it is timed next to it
+
+void RunStreamingCannyBenchmarks(BenchmarkHarness &harness);
+void RunVideoCannyBenchmarks(BenchmarkHarness &harness);
+void RunRoiCannyBenchmarks(BenchmarkHarness &harness);
+void RunMaskedCannyBenchmarks(BenchmarkHarness &harness);
+void RunThresholdSweepBenchmarks(BenchmarkHarness &harness);
+void RunThresholdSessionBenchmarks(BenchmarkHarness &harness);
+void RunPyramidCannyBenchmarks(BenchmarkHarness &harness);
+void RunDeadlineCannyBenchmarks(BenchmarkHarness &harness);
+void RunOutputOverloadBenchmarks(BenchmarkHarness &harness);
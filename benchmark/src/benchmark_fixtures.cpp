@@ -0,0 +1,64 @@
+#include "benchmark_fixtures.h"
+#include <algorithm>
+#include <cmath>
+#include <opencv2/opencv.hpp>
+#include <random>
+#include <stdexcept>
+
+std::vector<double> RandomImage(int width, int height) {
+  std::uniform_int_distribution<int> unif(0, 255);
+  std::default_random_engine re;
+
+  std::vector<double> image((size_t)width * height);
+  for (double &pixel : image) {
+    pixel = unif(re);
+  }
+  return image;
+}
+
+std::vector<double> RandomAngles(int width, int height) {
+  std::uniform_real_distribution<double> unifPi(-M_PI, M_PI);
+  std::default_random_engine re;
+
+  std::vector<double> angles((size_t)width * height);
+  for (double &angle : angles) {
+    angle = unifPi(re);
+  }
+  return angles;
+}
+
+void RenderScene(double *frame, int width, int height, int objectSize,
+                 int step) {
+  int objectX = (step * 7) % (width - objectSize);
+  int objectY = (step * 3) % (height - objectSize);
+
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      double value = 128 + 80 * std::sin(x * 0.03) * std::cos(y * 0.02) +
+                     (x / 160 + y / 120) % 3 * 30;
+      if (x >= objectX && x < objectX + objectSize && y >= objectY &&
+          y < objectY + objectSize) {
+        value = 250;
+      }
+      frame[y * width + x] = std::min(255.0, std::max(0.0, value));
+    }
+  }
+}
+
+std::vector<cv::Mat> LoadGrayImages(const std::filesystem::path &directory) {
+  std::vector<std::filesystem::path> paths;
+  for (const auto &p : std::filesystem::directory_iterator(directory)) {
+    paths.push_back(p.path());
+  }
+  std::sort(paths.begin(), paths.end());
+
+  std::vector<cv::Mat> images;
+  for (const std::filesystem::path &path : paths) {
+    cv::Mat image = cv::imread(path.string(), cv::IMREAD_GRAYSCALE);
+    if (image.empty()) {
+      throw std::runtime_error("Could not load image: " + path.string());
+    }
+    images.push_back(image);
+  }
+  return images;
+}
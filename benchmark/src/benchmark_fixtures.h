@@ -0,0 +1,34 @@
+#pragma once
+
+#include <filesystem>
+#include <opencv2/core/mat.hpp>
+#include <vector>
+
+// Parameters every benchmark runs the pipeline with
+#define GAUSSIAN_KERNEL_SIZE 3
+#define GAUSSIAN_KERNEL_SIGMA 0.5
+
+/**
+ * @brief Pixels drawn uniformly from [0, 255], the same on every run
+ */
+std::vector<double> RandomImage(int width, int height);
+
+/**
+ * @brief Gradient directions drawn uniformly from [-pi, pi], the same on every
+ * run
+ */
+std::vector<double> RandomAngles(int width, int height);
+
+/**
+ * @brief Static textured background with a bright square crossing it
+ * diagonally, like a fixed camera watching a single moving object. `step`
+ * moves the square.
+ */
+void RenderScene(double *frame, int width, int height, int objectSize,
+                 int step);
+
+/**
+ * @brief Every image of `directory` as 8-bit grayscale, in name order so runs
+ * see the same sequence
+ */
+std::vector<cv::Mat> LoadGrayImages(const std::filesystem::path &directory);
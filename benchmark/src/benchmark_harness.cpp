@@ -0,0 +1,365 @@
+#include "benchmark_harness.h"
+#include "cpu_dispatch.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <omp.h>
+#include <sstream>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+// Rounds of the TSC calibration and how long each one spins
+#define TSC_CALIBRATION_ROUNDS 5
+#define TSC_CALIBRATION_MILLISECONDS 20
+
+bool ParseBenchmarkOptions(int argc, char *argv[], BenchmarkOptions *options,
+                           std::vector<std::string> *positional) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg.rfind("--", 0) != 0) {
+      positional->push_back(arg);
+      continue;
+    }
+    if (i + 1 == argc) {
+      std::cerr << "Error: " << arg << " needs a value\n";
+      return false;
+    }
+
+    std::string value = argv[++i];
+    if (arg == "--warmup" || arg == "--repetitions") {
+      int count = std::atoi(value.c_str());
+      if (count < (arg == "--warmup" ? 0 : 1)) {
+        std::cerr << "Error: Invalid " << arg << " count: " << value << "\n";
+        return false;
+      }
+      (arg == "--warmup" ? options->warmup : options->repetitions) = count;
+    } else if (arg == "--filter") {
+      options->filter = value;
+    } else if (arg == "--output") {
+      options->outputPath = value;
+    } else if (arg == "--format" && value == "text") {
+      options->format = BenchmarkFormat::Text;
+    } else if (arg == "--format" && value == "json") {
+      options->format = BenchmarkFormat::Json;
+    } else if (arg == "--format" && value == "csv") {
+      options->format = BenchmarkFormat::Csv;
+    } else {
+      std::cerr << "Error: Unknown option " << arg << " " << value << "\n";
+      return false;
+    }
+  }
+  return true;
+}
+
+unsigned long long ReadTsc() { return __rdtsc(); }
+
+static double CalibrateTsc() {
+  using Clock = std::chrono::steady_clock;
+  std::vector<double> rates;
+
+  for (int round = 0; round < TSC_CALIBRATION_ROUNDS; round++) {
+    Clock::time_point start = Clock::now();
+    unsigned long long startTicks = ReadTsc();
+    Clock::time_point end =
+        start + std::chrono::milliseconds(TSC_CALIBRATION_MILLISECONDS);
+    // Spinning keeps the core awake, a sleep could let it change frequency
+    Clock::time_point now = start;
+    while (now < end) {
+      now = Clock::now();
+    }
+    unsigned long long ticks = ReadTsc() - startTicks;
+    rates.push_back(
+        std::chrono::duration<double, std::nano>(now - start).count() / ticks);
+  }
+
+  std::nth_element(rates.begin(), rates.begin() + rates.size() / 2,
+                   rates.end());
+  return rates[rates.size() / 2];
+}
+
+double TscNanosecondsPerTick() {
+  static const double nanosecondsPerTick = CalibrateTsc();
+  return nanosecondsPerTick;
+}
+
+static double Median(std::vector<double> values) {
+  size_t middle = values.size() / 2;
+  std::nth_element(values.begin(), values.begin() + middle, values.end());
+  double median = values[middle];
+  if (values.size() % 2 == 0) {
+    median = (median + *std::max_element(values.begin(),
+                                         values.begin() + middle)) /
+             2;
+  }
+  return median;
+}
+
+BenchmarkHarness::BenchmarkHarness(const BenchmarkOptions &options)
+    : options(options) {}
+
+bool BenchmarkHarness::Selected(const std::string &name) const {
+  return name.find(options.filter) != std::string::npos;
+}
+
+void BenchmarkHarness::Run(const BenchmarkCase &benchmark,
+                           const std::function<void()> &run,
+                           const std::function<void()> &setup) {
+  if (!Selected(benchmark.name)) {
+    return;
+  }
+
+  double nanosecondsPerTick = TscNanosecondsPerTick();
+  std::cerr << "Running " << benchmark.name << " (" << benchmark.implementation
+            << ") " << benchmark.width << "x" << benchmark.height << "\n";
+
+  // One timed call, also the first warmup, tells how many calls make up a
+  // repetition
+  if (setup) {
+    setup();
+  }
+  unsigned long long st = ReadTsc();
+  run();
+  unsigned long long et = ReadTsc();
+  int calls = 1;
+  if (!setup) {
+    double callNanoseconds = std::max(1.0, (et - st) * nanosecondsPerTick);
+    calls = (int)std::min(
+        1e6, std::ceil(options.minRepetitionNanoseconds / callNanoseconds));
+  }
+
+  for (int i = 1; i < options.warmup; i++) {
+    if (setup) {
+      setup();
+    }
+    for (int call = 0; call < calls; call++) {
+      run();
+    }
+  }
+
+  std::vector<double> samples;
+  samples.reserve(options.repetitions);
+  for (int i = 0; i < options.repetitions; i++) {
+    if (setup) {
+      setup();
+    }
+    st = ReadTsc();
+    for (int call = 0; call < calls; call++) {
+      run();
+    }
+    et = ReadTsc();
+    samples.push_back((et - st) * nanosecondsPerTick / calls /
+                      benchmark.images);
+  }
+
+  BenchmarkResult result;
+  result.benchmark = benchmark;
+  result.repetitions = options.repetitions;
+  result.callsPerRepetition = calls;
+  result.medianNanoseconds = Median(samples);
+  result.minNanoseconds = *std::min_element(samples.begin(), samples.end());
+  std::vector<double> deviations;
+  for (double sample : samples) {
+    deviations.push_back(std::abs(sample - result.medianNanoseconds));
+  }
+  result.madNanoseconds = Median(deviations);
+  results.push_back(result);
+}
+
+static double NanosecondsPerPixel(const BenchmarkResult &result) {
+  return result.medianNanoseconds /
+         ((double)result.benchmark.width * result.benchmark.height);
+}
+
+// FLOPs per nanosecond are GFLOP/s
+static double Gflops(const BenchmarkResult &result) {
+  return result.benchmark.flops / result.medianNanoseconds;
+}
+
+static std::string CpuModel() {
+  std::ifstream cpuinfo("/proc/cpuinfo");
+  std::string line;
+  while (std::getline(cpuinfo, line)) {
+    if (line.rfind("model name", 0) == 0 &&
+        line.find(':') != std::string::npos) {
+      return line.substr(line.find(':') + 2);
+    }
+  }
+  return "unknown";
+}
+
+static std::string Compiler() {
+#if defined(__clang__)
+  return "clang " __clang_version__;
+#elif defined(__GNUC__)
+  return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+  return "msvc " + std::to_string(_MSC_FULL_VER);
+#else
+  return "unknown";
+#endif
+}
+
+static std::string Timestamp() {
+  std::time_t now = std::time(nullptr);
+  char text[32];
+  std::strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+  return text;
+}
+
+static std::string JsonString(const std::string &value) {
+  std::ostringstream out;
+  out << '"';
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if ((unsigned char)c < 0x20) {
+      out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c
+          << std::dec;
+    } else {
+      out << c;
+    }
+  }
+  out << '"';
+  return out.str();
+}
+
+// Fields of a CSV row are quoted only when they would break the row
+static std::string CsvField(const std::string &value) {
+  if (value.find_first_of(",\"\n") == std::string::npos) {
+    return value;
+  }
+  std::string quoted = "\"";
+  for (char c : value) {
+    quoted += c == '"' ? std::string("\"\"") : std::string(1, c);
+  }
+  return quoted + "\"";
+}
+
+bool BenchmarkHarness::Report() const {
+  std::ofstream file;
+  if (!options.outputPath.empty()) {
+    file.open(options.outputPath);
+    if (!file) {
+      std::cerr << "Error: Unable to write " << options.outputPath << "\n";
+      return false;
+    }
+  }
+  std::ostream &out = options.outputPath.empty() ? std::cout : file;
+
+  switch (options.format) {
+  case BenchmarkFormat::Json:
+    ReportJson(out);
+    break;
+  case BenchmarkFormat::Csv:
+    ReportCsv(out);
+    break;
+  default:
+    ReportText(out);
+  }
+  out.flush();
+  return (bool)out;
+}
+
+void BenchmarkHarness::ReportText(std::ostream &out) const {
+  out << "CPU: " << CpuModel() << "\n";
+  out << "Kernel ISA level: " << IsaLevelName(ActiveIsaLevel())
+      << ", threads: " << omp_get_max_threads()
+      << ", TSC: " << 1 / TscNanosecondsPerTick() << " GHz\n";
+  out << "Repetitions: " << options.repetitions
+      << ", warmup: " << options.warmup << "\n";
+  out << std::left << std::setw(26) << "case" << std::setw(10)
+      << "variant" << std::setw(11) << "size" << std::right << std::setw(14)
+      << "median ns" << std::setw(12) << "MAD ns" << std::setw(10)
+      << "ns/pixel" << std::setw(9) << "GFLOP/s" << "\n";
+
+  for (const BenchmarkResult &result : results) {
+    std::ostringstream size;
+    size << result.benchmark.width << "x" << result.benchmark.height;
+    out << std::left << std::setw(26) << result.benchmark.name
+        << std::setw(10) << result.benchmark.implementation << std::setw(11)
+        << size.str() << std::right << std::fixed << std::setprecision(0)
+        << std::setw(14) << result.medianNanoseconds << std::setw(12)
+        << result.madNanoseconds << std::setprecision(3) << std::setw(10)
+        << NanosecondsPerPixel(result) << std::setprecision(2)
+        << std::setw(9);
+    if (result.benchmark.flops > 0) {
+      out << Gflops(result);
+    } else {
+      out << "-";
+    }
+    out << "\n";
+    out.unsetf(std::ios::fixed);
+  }
+}
+
+void BenchmarkHarness::ReportJson(std::ostream &out) const {
+  out << std::setprecision(10);
+  out << "{\n  \"host\": {\n";
+  out << "    \"cpu\": " << JsonString(CpuModel()) << ",\n";
+  out << "    \"isa\": " << JsonString(IsaLevelName(ActiveIsaLevel()))
+      << ",\n";
+  out << "    \"threads\": " << omp_get_max_threads() << ",\n";
+  out << "    \"tsc_ghz\": " << 1 / TscNanosecondsPerTick() << ",\n";
+  out << "    \"compiler\": " << JsonString(Compiler()) << ",\n";
+  out << "    \"timestamp\": " << JsonString(Timestamp()) << "\n  },\n";
+  out << "  \"warmup\": " << options.warmup << ",\n";
+  out << "  \"repetitions\": " << options.repetitions << ",\n";
+  out << "  \"results\": [";
+
+  for (size_t i = 0; i < results.size(); i++) {
+    const BenchmarkResult &result = results[i];
+    out << (i == 0 ? "\n" : ",\n") << "    {\"case\": "
+        << JsonString(result.benchmark.name)
+        << ", \"variant\": " << JsonString(result.benchmark.implementation)
+        << ", \"width\": " << result.benchmark.width
+        << ", \"height\": " << result.benchmark.height
+        << ", \"images\": " << result.benchmark.images
+        << ", \"calls_per_repetition\": " << result.callsPerRepetition
+        << ", \"median_ns\": " << result.medianNanoseconds
+        << ", \"mad_ns\": " << result.madNanoseconds
+        << ", \"min_ns\": " << result.minNanoseconds
+        << ", \"ns_per_pixel\": " << NanosecondsPerPixel(result)
+        << ", \"gflops\": ";
+    if (result.benchmark.flops > 0) {
+      out << Gflops(result);
+    } else {
+      out << "null";
+    }
+    out << "}";
+  }
+  out << "\n  ]\n}\n";
+}
+
+void BenchmarkHarness::ReportCsv(std::ostream &out) const {
+  // The host is repeated on every row so files of several hosts concatenate
+  std::string cpu = CsvField(CpuModel());
+  std::string isa = IsaLevelName(ActiveIsaLevel());
+  double tscGhz = 1 / TscNanosecondsPerTick();
+
+  out << std::setprecision(10);
+  out << "case,variant,width,height,images,repetitions,calls_per_repetition,"
+         "median_ns,mad_ns,min_ns,ns_per_pixel,gflops,cpu,isa,threads,"
+         "tsc_ghz\n";
+  for (const BenchmarkResult &result : results) {
+    out << CsvField(result.benchmark.name) << ","
+        << CsvField(result.benchmark.implementation) << ","
+        << result.benchmark.width << "," << result.benchmark.height << ","
+        << result.benchmark.images << "," << result.repetitions << ","
+        << result.callsPerRepetition << "," << result.medianNanoseconds << ","
+        << result.madNanoseconds << "," << result.minNanoseconds << ","
+        << NanosecondsPerPixel(result) << ",";
+    if (result.benchmark.flops > 0) {
+      out << Gflops(result);
+    }
+    out << "," << cpu << "," << isa << "," << omp_get_max_threads() << ","
+        << tscGhz << "\n";
+  }
+}
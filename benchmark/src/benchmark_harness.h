@@ -0,0 +1,107 @@
+#pragma once
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * Shared timing and reporting of the benchmarks. Each case is warmed up, then
+ * timed for a number of repetitions with the TSC, whose rate is measured at
+ * startup against std::chrono::steady_clock instead of being assumed. Results
+ * are summarized by their median and median absolute deviation and written
+ * as text, JSON or CSV together with a description of the host, so runs on
+ * different machines can be compared.
+ */
+
+enum class BenchmarkFormat { Text, Json, Csv };
+
+struct BenchmarkOptions {
+  // Untimed runs before the first repetition
+  int warmup = 3;
+  int repetitions = 30;
+  // Fast cases are called several times per repetition, until one takes at
+  // least this long, so the TSC resolution does not matter
+  double minRepetitionNanoseconds = 100000;
+  // Only cases whose name contains this run
+  std::string filter;
+  BenchmarkFormat format = BenchmarkFormat::Text;
+  // Standard output when empty
+  std::string outputPath;
+};
+
+/**
+ * @brief Parse `--warmup N`, `--repetitions N`, `--filter NAME`,
+ * `--format text|json|csv` and `--output PATH`. Other arguments are returned
+ * through `positional`. Returns false with a message on std::cerr for a bad
+ * option.
+ */
+bool ParseBenchmarkOptions(int argc, char *argv[], BenchmarkOptions *options,
+                           std::vector<std::string> *positional);
+
+unsigned long long ReadTsc();
+
+/**
+ * @brief Nanoseconds per TSC tick, measured on the first call and cached.
+ * Assumes an invariant TSC, which every x86 CPU of the last decade has.
+ */
+double TscNanosecondsPerTick();
+
+/**
+ * @brief What one case measures. `flops` is per image, 0 when the kernel is
+ * not floating point arithmetic worth counting.
+ */
+struct BenchmarkCase {
+  // Stage or pipeline, e.g. "gaussian_filter" or "fast_canny"
+  std::string name;
+  // Variant of it, e.g. "dispatch", "slow", "avx2" or "opencv"
+  std::string implementation;
+  int width = 0;
+  int height = 0;
+  // Images processed by one call
+  int images = 1;
+  double flops = 0;
+};
+
+struct BenchmarkResult {
+  BenchmarkCase benchmark;
+  int repetitions = 0;
+  int callsPerRepetition = 0;
+  // Per image
+  double medianNanoseconds = 0;
+  double madNanoseconds = 0;
+  double minNanoseconds = 0;
+};
+
+class BenchmarkHarness {
+public:
+  explicit BenchmarkHarness(const BenchmarkOptions &options);
+
+  /**
+   * @brief Whether cases named `name` pass the filter, so a caller can skip
+   * preparing and checking them
+   */
+  bool Selected(const std::string &name) const;
+
+  /**
+   * @brief Time `run` and record the result, unless the case is filtered
+   * out. With `setup`, which restores the inputs of a kernel that consumes
+   * them, every call is timed on its own right after an untimed setup.
+   */
+  void Run(const BenchmarkCase &benchmark, const std::function<void()> &run,
+           const std::function<void()> &setup = nullptr);
+
+  /**
+   * @brief Write the results in the chosen format, to the output file if one
+   * was given. Returns false when it cannot be written.
+   */
+  bool Report() const;
+
+private:
+  void ReportText(std::ostream &out) const;
+  void ReportJson(std::ostream &out) const;
+  void ReportCsv(std::ostream &out) const;
+
+  BenchmarkOptions options;
+  std::vector<BenchmarkResult> results;
+};
@@ -0,0 +1,79 @@
+#include "benchmark_cases.h"
+#include "benchmark_harness.h"
+#include <exception>
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+int main(int argc, char *argv[]) {
+  BenchmarkOptions options;
+  std::vector<std::string> positional;
+  if (!ParseBenchmarkOptions(argc, argv, &options, &positional) ||
+      positional.size() > 1) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--format text|json|csv] [--output <path>] [--filter "
+                 "<case>] [--warmup <runs>] [--repetitions <runs>] "
+                 "[<coco_image_path>]\n";
+    return -1;
+  }
+  std::string cocoImagePath = positional.empty() ? "" : positional[0];
+
+  cv::setNumThreads(0);
+  BenchmarkHarness harness(options);
+
+  try {
+    if (harness.Selected("gaussian_filter")) {
+      RunGaussianFilterBenchmarks(harness);
+    }
+    if (harness.Selected("gradient")) {
+      RunGradientBenchmarks(harness);
+    }
+    if (harness.Selected("non_maxima_suppression")) {
+      RunNonMaxSuppressionBenchmarks(harness);
+    }
+    if (harness.Selected("double_threshold")) {
+      RunDoubleThresholdBenchmarks(harness);
+    }
+    if (harness.Selected("hysteresis") ||
+        harness.Selected("hysteresis_snake")) {
+      RunHysteresisBenchmarks(harness);
+    }
+    if (harness.Selected("canny_scene") || harness.Selected("canny_coco")) {
+      RunCannyBenchmarks(harness, cocoImagePath);
+    }
+    if (harness.Selected("canny_streaming")) {
+      RunStreamingCannyBenchmarks(harness);
+    }
+    if (harness.Selected("canny_video")) {
+      RunVideoCannyBenchmarks(harness);
+    }
+    if (harness.Selected("canny_roi")) {
+      RunRoiCannyBenchmarks(harness);
+    }
+    if (harness.Selected("canny_mask")) {
+      RunMaskedCannyBenchmarks(harness);
+    }
+    if (harness.Selected("canny_sweep")) {
+      RunThresholdSweepBenchmarks(harness);
+    }
+    if (harness.Selected("canny_session")) {
+      RunThresholdSessionBenchmarks(harness);
+    }
+    if (harness.Selected("canny_pyramid")) {
+      RunPyramidCannyBenchmarks(harness);
+    }
+    if (harness.Selected("canny_deadline")) {
+      RunDeadlineCannyBenchmarks(harness);
+    }
+    if (harness.Selected("canny_output")) {
+      RunOutputOverloadBenchmarks(harness);
+    }
+  } catch (const std::exception &err) {
+    std::cerr << "[ERROR] " << err.what() << "\n";
+
+    return -1;
+  }
+
+  return harness.Report() ? 0 : -1;
+}
@@ -0,0 +1,696 @@
+#include "benchmark_cases.h"
+#include "benchmark_fixtures.h"
+#include "canny_buffer_pool.h"
+#include "canny_mask.h"
+#include "canny_pipeline.h"
+#include "deadline_canny.h"
+#include "fast_canny.h"
+#include "pyramid_canny.h"
+#include "streaming_canny.h"
+#include "threshold_session.h"
+#include "video_canny.h"
+#include <algorithm>
+#include <functional>
+#include <opencv2/opencv.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Between the steps of the scene's background and its square, so hysteresis
+// has weak edges to follow
+#define CANNY_GRADIENT_LOWER_THRESHOLD 100
+#define CANNY_GRADIENT_UPPER_THRESHOLD 200
+
+// The odd size leaves a tail in every vectorized row
+static const int sceneSizes[][2] = {{640, 480}, {333, 217}};
+// Frames of the moving square VideoCanny is run on
+#define VIDEO_FRAMES 30
+
+// Levels of the pyramid, down to 1/8 of the scene
+#define PYRAMID_LEVELS 4
+// Search radius of the coarse to fine pyramid
+#define PYRAMID_SEARCH_RADIUS 4
+
+// Budget no frame of the scenes gets near, in milliseconds
+#define DEADLINE_GENEROUS_BUDGET 1e6
+
+// Results the pooled overload is called for before checking the pool
+#define POOLED_RESULTS 10
+// Value around the caller's views, which must neither be read nor written
+#define OUTSIDE_VIEW 1000.0
+
+// Threshold pairs of the sweep, wider and narrower than the scene's steps,
+// down to a single value between them
+static const std::vector<std::pair<int, int>> sweepThresholds = {
+    {100, 200}, {50, 100}, {100, 255}, {20, 60}, {150, 151}, {1, 255}};
+
+/**
+ * @brief A synthetic scene and its FastCanny edges, the reference every mode
+ * is checked against
+ */
+struct Scene {
+  int width = 0;
+  int height = 0;
+  std::vector<double> image;
+  std::vector<double> edges;
+};
+
+static std::vector<double> FastCannyEdges(const Scene &scene,
+                                          int lowerThreshold,
+                                          int upperThreshold) {
+  std::vector<double> edges(scene.image.size());
+  FastCanny(ImageView<const double>(scene.image.data(), scene.width,
+                                    scene.height),
+            ImageView<double>(edges.data(), scene.width, scene.height),
+            lowerThreshold, upperThreshold, GAUSSIAN_KERNEL_SIZE,
+            GAUSSIAN_KERNEL_SIGMA);
+  return edges;
+}
+
+static Scene MakeScene(int width, int height, int step = 0) {
+  Scene scene;
+  scene.width = width;
+  scene.height = height;
+  scene.image.resize((size_t)width * height);
+  RenderScene(scene.image.data(), width, height, height / 8, step);
+  scene.edges = FastCannyEdges(scene, CANNY_GRADIENT_LOWER_THRESHOLD,
+                               CANNY_GRADIENT_UPPER_THRESHOLD);
+  return scene;
+}
+
+static void CheckEdges(const std::string &name, const Scene &scene,
+                       const double *edges,
+                       const std::vector<double> &expected) {
+  for (int y = 0; y < scene.height; y++) {
+    for (int x = 0; x < scene.width; x++) {
+      size_t i = (size_t)y * scene.width + x;
+      if (edges[i] != expected[i]) {
+        throw std::runtime_error(
+            name + " failed: " + std::to_string(scene.width) + "x" +
+            std::to_string(scene.height) + " differs from FastCanny at (" +
+            std::to_string(x) + ", " + std::to_string(y) + ")");
+      }
+    }
+  }
+}
+
+static void CheckEdges(const std::string &name, const Scene &scene,
+                       const double *edges) {
+  CheckEdges(name, scene, edges, scene.edges);
+}
+
+/**
+ * @brief The scene's pixels as a CV_64F image, without a copy
+ */
+static cv::Mat SceneMat(Scene &scene) {
+  return cv::Mat(scene.height, scene.width, CV_64F, scene.image.data());
+}
+
+static void CheckEdges(const std::string &name, const Scene &scene,
+                       const cv::Mat &edges) {
+  if (edges.type() != CV_64F || edges.cols != scene.width ||
+      edges.rows != scene.height) {
+    throw std::runtime_error(name + " failed: edges are not a CV_64F " +
+                             std::to_string(scene.width) + "x" +
+                             std::to_string(scene.height) + " image");
+  }
+  std::vector<double> rows(scene.image.size());
+  for (int y = 0; y < scene.height; y++) {
+    std::copy(edges.ptr<double>(y), edges.ptr<double>(y) + scene.width,
+              rows.begin() + (size_t)y * scene.width);
+  }
+  CheckEdges(name, scene, rows.data());
+}
+
+/**
+ * @brief Check the edges of a mode whose hysteresis only follows weak edges
+ * inside `region`, a 0/1 byte per pixel of the scene. Such a mode finds a
+ * subset of FastCanny's edges, all 0 outside the region, and has to find
+ * every 8-connected component of FastCanny's edges that lies wholly inside
+ * the region, since its strong pixels and links are all there.
+ */
+static void CheckRegionEdges(const std::string &name, const Scene &scene,
+                             const std::vector<unsigned char> &region,
+                             const double *edges) {
+  int width = scene.width;
+  int height = scene.height;
+  // Component of every edge pixel of FastCanny, -1 elsewhere
+  std::vector<int> component(scene.edges.size(), -1);
+  std::vector<unsigned char> leavesRegion;
+  std::vector<int> stack;
+  for (size_t seed = 0; seed < scene.edges.size(); seed++) {
+    if (scene.edges[seed] == 0 || component[seed] >= 0) {
+      continue;
+    }
+    int label = (int)leavesRegion.size();
+    leavesRegion.push_back(0);
+    component[seed] = label;
+    stack.push_back((int)seed);
+    while (!stack.empty()) {
+      int i = stack.back();
+      stack.pop_back();
+      leavesRegion[label] |= !region[i];
+      int x = i % width;
+      int y = i / width;
+      for (int ny = std::max(y - 1, 0); ny <= std::min(y + 1, height - 1);
+           ny++) {
+        for (int nx = std::max(x - 1, 0); nx <= std::min(x + 1, width - 1);
+             nx++) {
+          int n = ny * width + nx;
+          if (scene.edges[n] != 0 && component[n] < 0) {
+            component[n] = label;
+            stack.push_back(n);
+          }
+        }
+      }
+    }
+  }
+
+  for (size_t i = 0; i < scene.edges.size(); i++) {
+    bool required = region[i] && component[i] >= 0 &&
+                    !leavesRegion[component[i]];
+    bool allowed = region[i] && component[i] >= 0;
+    if ((edges[i] != 0 && (!allowed || edges[i] != scene.edges[i])) ||
+        (required && edges[i] != scene.edges[i])) {
+      throw std::runtime_error(
+          name + " failed: " + std::to_string(width) + "x" +
+          std::to_string(height) + " disagrees with FastCanny at (" +
+          std::to_string(i % width) + ", " + std::to_string(i / width) + ")");
+    }
+  }
+}
+
+static void TimeFastCanny(BenchmarkHarness &harness, const std::string &name,
+                          const Scene &scene, std::vector<double> &edges) {
+  harness.Run({name, "fast", scene.width, scene.height}, [&] {
+    FastCanny(ImageView<const double>(scene.image.data(), scene.width,
+                                      scene.height),
+              ImageView<double>(edges.data(), scene.width, scene.height),
+              CANNY_GRADIENT_LOWER_THRESHOLD, CANNY_GRADIENT_UPPER_THRESHOLD,
+              GAUSSIAN_KERNEL_SIZE, GAUSSIAN_KERNEL_SIGMA);
+  });
+}
+
+/**
+ * @brief Time FastCanny once per pair of sweepThresholds
+ */
+static void TimeFastCannySweep(BenchmarkHarness &harness,
+                               const std::string &name, const Scene &scene,
+                               std::vector<double> &edges) {
+  int pairs = (int)sweepThresholds.size();
+  harness.Run({name, "fast", scene.width, scene.height, pairs}, [&] {
+    for (const std::pair<int, int> &pair : sweepThresholds) {
+      FastCanny(ImageView<const double>(scene.image.data(), scene.width,
+                                        scene.height),
+                ImageView<double>(edges.data(), scene.width, scene.height),
+                pair.first, pair.second, GAUSSIAN_KERNEL_SIZE,
+                GAUSSIAN_KERNEL_SIGMA);
+    }
+  });
+}
+
+/**
+ * @brief Stream the scene through StreamingCanny in uneven chunks of rows,
+ * checking that the rows come back in order. The lookahead covers the whole
+ * image, so the edges must equal FastCanny's.
+ */
+static void StreamScene(const Scene &scene, int chunkRows, int bandRows,
+                        std::vector<double> &edges) {
+  int emitted = 0;
+  StreamingCanny canny(
+      scene.width, CANNY_GRADIENT_LOWER_THRESHOLD,
+      CANNY_GRADIENT_UPPER_THRESHOLD, GAUSSIAN_KERNEL_SIZE,
+      GAUSSIAN_KERNEL_SIGMA,
+      [&](int row, const double *rowEdges) {
+        if (row != emitted++) {
+          throw std::runtime_error("StreamScene failed: row " +
+                                   std::to_string(row) + " out of order");
+        }
+        std::copy(rowEdges, rowEdges + scene.width,
+                  edges.begin() + (size_t)row * scene.width);
+      },
+      scene.height, bandRows);
+  for (int row = 0; row < scene.height; row += chunkRows) {
+    canny.PushRows(&scene.image[(size_t)row * scene.width],
+                   std::min(chunkRows, scene.height - row));
+  }
+  canny.Finish();
+  if (emitted != scene.height) {
+    throw std::runtime_error("StreamScene failed: " + std::to_string(emitted) +
+                             " of " + std::to_string(scene.height) +
+                             " rows emitted");
+  }
+}
+
+void RunStreamingCannyBenchmarks(BenchmarkHarness &harness) {
+  for (const int *size : sceneSizes) {
+    Scene scene = MakeScene(size[0], size[1]);
+    std::vector<double> edges(scene.image.size());
+
+    // Chunks smaller and larger than a band, none dividing the height
+    for (int chunkRows : {1, 37, 100}) {
+      for (int bandRows : {16, 64}) {
+        std::fill(edges.begin(), edges.end(), -1);
+        StreamScene(scene, chunkRows, bandRows, edges);
+        CheckEdges("StreamingCanny", scene, edges.data());
+      }
+    }
+
+    TimeFastCanny(harness, "canny_streaming", scene, edges);
+    harness.Run({"canny_streaming", "streaming", scene.width, scene.height},
+                [&] { StreamScene(scene, 37, 64, edges); });
+  }
+}
+
+void RunVideoCannyBenchmarks(BenchmarkHarness &harness) {
+  for (const int *size : sceneSizes) {
+    int width = size[0];
+    int height = size[1];
+    std::vector<Scene> frames;
+    for (int i = 0; i < VIDEO_FRAMES; i++) {
+      frames.push_back(MakeScene(width, height, i));
+    }
+
+    VideoCanny video(width, height, CANNY_GRADIENT_LOWER_THRESHOLD,
+                     CANNY_GRADIENT_UPPER_THRESHOLD, GAUSSIAN_KERNEL_SIZE,
+                     GAUSSIAN_KERNEL_SIGMA);
+    // Twice through, so the first frame also follows a changed one
+    for (int pass = 0; pass < 2; pass++) {
+      for (const Scene &frame : frames) {
+        CheckEdges("VideoCanny", frame, video.ProcessFrame(frame.image.data()));
+      }
+    }
+
+    std::vector<double> edges((size_t)width * height);
+    harness.Run({"canny_video", "fast", width, height, VIDEO_FRAMES}, [&] {
+      for (const Scene &frame : frames) {
+        FastCanny(ImageView<const double>(frame.image.data(), width, height),
+                  ImageView<double>(edges.data(), width, height),
+                  CANNY_GRADIENT_LOWER_THRESHOLD,
+                  CANNY_GRADIENT_UPPER_THRESHOLD, GAUSSIAN_KERNEL_SIZE,
+                  GAUSSIAN_KERNEL_SIGMA);
+      }
+    });
+    harness.Run({"canny_video", "video", width, height, VIDEO_FRAMES}, [&] {
+      for (const Scene &frame : frames) {
+        video.ProcessFrame(frame.image.data());
+      }
+    });
+  }
+}
+
+void RunRoiCannyBenchmarks(BenchmarkHarness &harness) {
+  for (const int *size : sceneSizes) {
+    Scene scene = MakeScene(size[0], size[1]);
+    int width = scene.width;
+    int height = scene.height;
+    cv::Mat image = SceneMat(scene);
+
+    // Odd rectangles through the scene, around and across the square in its
+    // top left corner, on the image border, a single column and a single
+    // pixel, processed in one call
+    std::vector<cv::Rect> rects = {
+        cv::Rect(width / 4, height / 4, width / 2 + 1, height / 3),
+        cv::Rect(0, 0, height / 8 + 9, height / 8 + 5),
+        cv::Rect(0, 0, height / 16 + 3, height / 8 + 5),
+        cv::Rect(width - 51, height - 23, 51, 23),
+        cv::Rect(width / 3, 0, 1, height),
+        cv::Rect(width / 2, height / 2, 1, 1),
+        cv::Rect(7, height / 2 - 40, width - 14, 81)};
+
+    // The whole image leaves nothing outside for hysteresis
+    std::vector<std::shared_ptr<cv::Mat>> whole =
+        FastCannyROI(image, {cv::Rect(0, 0, width, height)},
+                     CANNY_GRADIENT_LOWER_THRESHOLD,
+                     CANNY_GRADIENT_UPPER_THRESHOLD, GAUSSIAN_KERNEL_SIZE,
+                     GAUSSIAN_KERNEL_SIGMA);
+    CheckEdges("FastCannyROI", scene, whole[0]->ptr<double>());
+
+    std::vector<std::shared_ptr<cv::Mat>> outputs = FastCannyROI(
+        image, rects, CANNY_GRADIENT_LOWER_THRESHOLD,
+        CANNY_GRADIENT_UPPER_THRESHOLD, GAUSSIAN_KERNEL_SIZE,
+        GAUSSIAN_KERNEL_SIGMA);
+    std::vector<unsigned char> region(scene.image.size());
+    std::vector<double> edges(scene.image.size());
+    for (size_t r = 0; r < rects.size(); r++) {
+      const cv::Rect &rect = rects[r];
+      std::fill(region.begin(), region.end(), 0);
+      std::fill(edges.begin(), edges.end(), 0);
+      for (int y = 0; y < rect.height; y++) {
+        const double *row = outputs[r]->ptr<double>(y);
+        for (int x = 0; x < rect.width; x++) {
+          size_t i = (size_t)(rect.y + y) * width + rect.x + x;
+          region[i] = 1;
+          edges[i] = row[x];
+        }
+      }
+      CheckRegionEdges("FastCannyROI", scene, region, edges.data());
+    }
+
+    TimeFastCanny(harness, "canny_roi", scene, edges);
+    harness.Run({"canny_roi", "roi", width, height}, [&] {
+      FastCannyROI(image, rects, CANNY_GRADIENT_LOWER_THRESHOLD,
+                   CANNY_GRADIENT_UPPER_THRESHOLD, GAUSSIAN_KERNEL_SIZE,
+                   GAUSSIAN_KERNEL_SIGMA);
+    });
+  }
+}
+
+void RunMaskedCannyBenchmarks(BenchmarkHarness &harness) {
+  for (const int *size : sceneSizes) {
+    Scene scene = MakeScene(size[0], size[1]);
+    int width = scene.width;
+    int height = scene.height;
+    cv::Mat image = SceneMat(scene);
+    int center = height / 16;
+    int radius = height / 8;
+
+    // Everything, a disc around the square in the top left corner, and two
+    // thirds of the image with holes, so tiles are full, empty and partial
+    std::vector<std::function<bool(int, int)>> shapes = {
+        [](int, int) { return true; },
+        [&](int x, int y) {
+          return (x - center) * (x - center) + (y - center) * (y - center) <=
+                 radius * radius;
+        },
+        [&](int x, int y) {
+          return x < width * 2 / 3 && (x / 37 + y / 29) % 5 != 0;
+        }};
+
+    std::vector<unsigned char> region(scene.image.size());
+    std::vector<double> edges(scene.image.size());
+    for (size_t s = 0; s < shapes.size(); s++) {
+      for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+          region[(size_t)y * width + x] = shapes[s](x, y);
+        }
+      }
+      for (int tileSize : {16, 64}) {
+        CannyMask mask(region.data(), width, height, width, tileSize);
+        std::shared_ptr<cv::Mat> output =
+            FastCanny(image, mask, CANNY_GRADIENT_LOWER_THRESHOLD,
+                      CANNY_GRADIENT_UPPER_THRESHOLD, GAUSSIAN_KERNEL_SIZE,
+                      GAUSSIAN_KERNEL_SIGMA);
+        if (s == 0) {
+          CheckEdges("MaskedCanny", scene, output->ptr<double>());
+        }
+        CheckRegionEdges("MaskedCanny", scene, region, output->ptr<double>());
+      }
+    }
+
+    // The disc, the typical mask of a region of interest
+    for (int y = 0; y < height; y++) {
+      for (int x = 0; x < width; x++) {
+        region[(size_t)y * width + x] = shapes[1](x, y);
+      }
+    }
+    CannyMask mask(region.data(), width, height, width);
+    TimeFastCanny(harness, "canny_mask", scene, edges);
+    harness.Run({"canny_mask", "masked", width, height}, [&] {
+      MaskedCanny(scene.image.data(), width, mask,
+                  CANNY_GRADIENT_LOWER_THRESHOLD,
+                  CANNY_GRADIENT_UPPER_THRESHOLD, GAUSSIAN_KERNEL_SIZE,
+                  GAUSSIAN_KERNEL_SIGMA, edges.data());
+    });
+  }
+}
+
+void RunThresholdSweepBenchmarks(BenchmarkHarness &harness) {
+  for (const int *size : sceneSizes) {
+    Scene scene = MakeScene(size[0], size[1]);
+    cv::Mat image = SceneMat(scene);
+    int pairs = (int)sweepThresholds.size();
+
+    std::vector<std::vector<double>> expected;
+    for (const std::pair<int, int> &pair : sweepThresholds) {
+      expected.push_back(FastCannyEdges(scene, pair.first, pair.second));
+    }
+    std::vector<std::shared_ptr<cv::Mat>> outputs =
+        FastCannySweep(image, sweepThresholds, GAUSSIAN_KERNEL_SIZE,
+                       GAUSSIAN_KERNEL_SIGMA);
+    for (int i = 0; i < pairs; i++) {
+      CheckEdges("FastCannySweep", scene, outputs[i]->ptr<double>(),
+                 expected[i]);
+    }
+
+    std::vector<double> edges(scene.image.size());
+    TimeFastCannySweep(harness, "canny_sweep", scene, edges);
+    harness.Run({"canny_sweep", "sweep", scene.width, scene.height, pairs},
+                [&] {
+                  FastCannySweep(image, sweepThresholds, GAUSSIAN_KERNEL_SIZE,
+                                 GAUSSIAN_KERNEL_SIGMA);
+                });
+  }
+}
+
+void RunThresholdSessionBenchmarks(BenchmarkHarness &harness) {
+  for (const int *size : sceneSizes) {
+    Scene scene = MakeScene(size[0], size[1]);
+    int pairs = (int)sweepThresholds.size();
+
+    std::vector<std::vector<double>> expected;
+    for (const std::pair<int, int> &pair : sweepThresholds) {
+      expected.push_back(FastCannyEdges(scene, pair.first, pair.second));
+    }
+    ThresholdSession session(scene.image.data(), scene.width, scene.height,
+                             GAUSSIAN_KERNEL_SIZE, GAUSSIAN_KERNEL_SIGMA);
+    // Forward, backward and again, so each pair follows a looser and a
+    // tighter one and the in-place updates add and remove edges
+    std::vector<double> edges(scene.image.size());
+    for (int step = 0; step < 3 * pairs; step++) {
+      int i = step / pairs == 1 ? pairs - 1 - step % pairs : step % pairs;
+      const unsigned char *mask =
+          session.Edges(sweepThresholds[i].first, sweepThresholds[i].second);
+      // 255 in the mask for FastCanny's upper threshold
+      for (size_t p = 0; p < edges.size(); p++) {
+        edges[p] = mask[p] == 255 ? sweepThresholds[i].second
+                                  : mask[p] == 0 ? 0 : -1;
+      }
+      CheckEdges("ThresholdSession", scene, edges.data(), expected[i]);
+    }
+
+    TimeFastCannySweep(harness, "canny_session", scene, edges);
+    harness.Run({"canny_session", "session", scene.width, scene.height, pairs},
+                [&] {
+                  for (const std::pair<int, int> &pair : sweepThresholds) {
+                    session.Edges(pair.first, pair.second);
+                  }
+                });
+  }
+}
+
+static void DetectPyramid(const Scene &scene, int searchRadius,
+                          std::vector<PyramidLevel> &levels) {
+  PyramidCanny(scene.image.data(), scene.width, scene.height, PYRAMID_LEVELS,
+               CANNY_GRADIENT_LOWER_THRESHOLD, CANNY_GRADIENT_UPPER_THRESHOLD,
+               GAUSSIAN_KERNEL_SIZE, GAUSSIAN_KERNEL_SIGMA, searchRadius,
+               levels);
+}
+
+void RunPyramidCannyBenchmarks(BenchmarkHarness &harness) {
+  for (const int *size : sceneSizes) {
+    Scene scene = MakeScene(size[0], size[1]);
+
+    // Every level must be FastCanny of its own image, level 0 of the scene
+    std::vector<PyramidLevel> levels;
+    DetectPyramid(scene, -1, levels);
+    std::vector<Scene> levelScenes = {scene};
+    for (int i = 1; i < PYRAMID_LEVELS; i++) {
+      Scene level;
+      level.width = levels[i].width;
+      level.height = levels[i].height;
+      level.image = levels[i].image;
+      level.edges = FastCannyEdges(level, CANNY_GRADIENT_LOWER_THRESHOLD,
+                                   CANNY_GRADIENT_UPPER_THRESHOLD);
+      levelScenes.push_back(level);
+    }
+    for (int i = 0; i < PYRAMID_LEVELS; i++) {
+      CheckEdges("PyramidCanny level " + std::to_string(i), levelScenes[i],
+                 levels[i].edges.data());
+    }
+
+    // A radius covering the image searches everywhere, a small one finds a
+    // subset of the edges and the coarsest level in full
+    std::vector<PyramidLevel> searched;
+    DetectPyramid(scene, std::max(scene.width, scene.height), searched);
+    for (int i = 0; i < PYRAMID_LEVELS; i++) {
+      CheckEdges("PyramidCanny search level " + std::to_string(i),
+                 levelScenes[i], searched[i].edges.data());
+    }
+    DetectPyramid(scene, PYRAMID_SEARCH_RADIUS, searched);
+    CheckEdges("PyramidCanny search level " +
+                   std::to_string(PYRAMID_LEVELS - 1),
+               levelScenes.back(), searched.back().edges.data());
+    for (int i = 0; i < PYRAMID_LEVELS - 1; i++) {
+      const Scene &level = levelScenes[i];
+      const std::vector<double> &edges = searched[i].edges;
+      for (size_t p = 0; p < edges.size(); p++) {
+        if (edges[p] != 0 && edges[p] != level.edges[p]) {
+          throw std::runtime_error(
+              "PyramidCanny search failed: level " + std::to_string(i) +
+              " has an edge FastCanny does not at index " + std::to_string(p));
+        }
+      }
+    }
+
+    // FastCanny on every level image, the pyramid without sharing a schedule
+    std::vector<double> edges(scene.image.size());
+    harness.Run({"canny_pyramid", "fast", scene.width, scene.height}, [&] {
+      for (const Scene &level : levelScenes) {
+        FastCanny(ImageView<const double>(level.image.data(), level.width,
+                                          level.height),
+                  ImageView<double>(edges.data(), level.width, level.height),
+                  CANNY_GRADIENT_LOWER_THRESHOLD,
+                  CANNY_GRADIENT_UPPER_THRESHOLD, GAUSSIAN_KERNEL_SIZE,
+                  GAUSSIAN_KERNEL_SIGMA);
+      }
+    });
+    harness.Run({"canny_pyramid", "pyramid", scene.width, scene.height},
+                [&] { DetectPyramid(scene, -1, levels); });
+    harness.Run({"canny_pyramid", "search", scene.width, scene.height},
+                [&] { DetectPyramid(scene, PYRAMID_SEARCH_RADIUS, searched); });
+  }
+}
+
+static CannyDeadlineStatus DetectWithDeadline(DeadlineCanny &canny,
+                                              const Scene &scene,
+                                              double budgetMs,
+                                              std::vector<double> &edges) {
+  return canny.Detect(scene.image.data(), scene.width, scene.height, budgetMs,
+                      edges.data());
+}
+
+void RunDeadlineCannyBenchmarks(BenchmarkHarness &harness) {
+  for (const int *size : sceneSizes) {
+    Scene scene = MakeScene(size[0], size[1]);
+    std::vector<double> edges(scene.image.size());
+    DeadlineCanny canny(CANNY_GRADIENT_LOWER_THRESHOLD,
+                        CANNY_GRADIENT_UPPER_THRESHOLD, GAUSSIAN_KERNEL_SIZE,
+                        GAUSSIAN_KERNEL_SIGMA);
+
+    // With time to spare nothing is degraded, on the first frame and once
+    // the stage costs are known
+    for (int frame = 0; frame < 3; frame++) {
+      CannyDeadlineStatus status =
+          DetectWithDeadline(canny, scene, DEADLINE_GENEROUS_BUDGET, edges);
+      if (status.degradations != CANNY_DEGRADE_NONE || !status.deadlineMet) {
+        throw std::runtime_error("DeadlineCanny failed: degraded with a "
+                                 "generous budget");
+      }
+      CheckEdges("DeadlineCanny", scene, edges.data());
+    }
+
+    // Without any time every stage that can fall back does, and the edges
+    // keep FastCanny's values
+    CannyDeadlineStatus status = DetectWithDeadline(canny, scene, 0, edges);
+    unsigned fallbacks = CANNY_DEGRADE_SKIPPED_BLUR | CANNY_DEGRADE_L1_GRADIENT;
+    unsigned hysteresis =
+        CANNY_DEGRADE_PARTIAL_HYSTERESIS | CANNY_DEGRADE_NO_HYSTERESIS;
+    if ((status.degradations & fallbacks) != fallbacks ||
+        !(status.degradations & hysteresis) || status.deadlineMet) {
+      throw std::runtime_error("DeadlineCanny failed: degradations " +
+                               std::to_string(status.degradations) +
+                               " without a budget");
+    }
+    for (size_t i = 0; i < edges.size(); i++) {
+      if (edges[i] != 0 && edges[i] != CANNY_GRADIENT_UPPER_THRESHOLD) {
+        throw std::runtime_error("DeadlineCanny failed: edge value " +
+                                 std::to_string(edges[i]) + " at index " +
+                                 std::to_string(i));
+      }
+    }
+
+    TimeFastCanny(harness, "canny_deadline", scene, edges);
+    harness.Run({"canny_deadline", "deadline", scene.width, scene.height}, [&] {
+      DetectWithDeadline(canny, scene, DEADLINE_GENEROUS_BUDGET, edges);
+    });
+    harness.Run({"canny_deadline", "degraded", scene.width, scene.height},
+                [&] { DetectWithDeadline(canny, scene, 0, edges); });
+  }
+}
+
+void RunOutputOverloadBenchmarks(BenchmarkHarness &harness) {
+  for (const int *size : sceneSizes) {
+    Scene scene = MakeScene(size[0], size[1]);
+    int width = scene.width;
+    int height = scene.height;
+    cv::Mat image = SceneMat(scene);
+
+    CheckEdges("FastCanny", scene,
+               *FastCanny(image, CANNY_GRADIENT_LOWER_THRESHOLD,
+                          CANNY_GRADIENT_UPPER_THRESHOLD, GAUSSIAN_KERNEL_SIZE,
+                          GAUSSIAN_KERNEL_SIGMA));
+
+    // Input and output as views into larger images, whose pixels around the
+    // views are out of range so reading them would throw
+    cv::Mat inputCanvas(height + 5, width + 9, CV_64F,
+                        cv::Scalar(OUTSIDE_VIEW));
+    cv::Mat input = inputCanvas(cv::Rect(4, 2, width, height));
+    image.copyTo(input);
+    cv::Mat outputCanvas(height + 6, width + 10, CV_64F,
+                         cv::Scalar(OUTSIDE_VIEW));
+    cv::Mat output = outputCanvas(cv::Rect(5, 3, width, height));
+    const double *outputData = output.ptr<double>();
+    for (RangeCheck check : {RangeCheck::Validate, RangeCheck::Skip}) {
+      FastCanny(input, output, CANNY_GRADIENT_LOWER_THRESHOLD,
+                CANNY_GRADIENT_UPPER_THRESHOLD, GAUSSIAN_KERNEL_SIZE,
+                GAUSSIAN_KERNEL_SIGMA, check);
+      if (output.ptr<double>() != outputData) {
+        throw std::runtime_error("FastCanny failed: output view reallocated");
+      }
+      CheckEdges("FastCanny into a view", scene, output);
+    }
+    for (int y = 0; y < outputCanvas.rows; y++) {
+      for (int x = 0; x < outputCanvas.cols; x++) {
+        bool inView = x >= 5 && x < width + 5 && y >= 3 && y < height + 3;
+        if (!inView && outputCanvas.ptr<double>(y)[x] != OUTSIDE_VIEW) {
+          throw std::runtime_error(
+              "FastCanny failed: wrote outside the output view at (" +
+              std::to_string(x) + ", " + std::to_string(y) + ")");
+        }
+      }
+    }
+
+    // Results released one at a time reuse a single buffer, and one still
+    // held forces a second
+    CannyBufferPool pool;
+    for (int i = 0; i < POOLED_RESULTS; i++) {
+      PooledEdges edges =
+          FastCanny(input, pool, CANNY_GRADIENT_LOWER_THRESHOLD,
+                    CANNY_GRADIENT_UPPER_THRESHOLD, GAUSSIAN_KERNEL_SIZE,
+                    GAUSSIAN_KERNEL_SIGMA);
+      CheckEdges("Pooled FastCanny", scene, edges.Mat());
+    }
+    PooledEdges held = FastCanny(image, pool, CANNY_GRADIENT_LOWER_THRESHOLD,
+                                 CANNY_GRADIENT_UPPER_THRESHOLD,
+                                 GAUSSIAN_KERNEL_SIZE, GAUSSIAN_KERNEL_SIGMA);
+    PooledEdges second = FastCanny(image, pool, CANNY_GRADIENT_LOWER_THRESHOLD,
+                                   CANNY_GRADIENT_UPPER_THRESHOLD,
+                                   GAUSSIAN_KERNEL_SIZE, GAUSSIAN_KERNEL_SIGMA);
+    CheckEdges("Pooled FastCanny", scene, held.Mat());
+    CheckEdges("Pooled FastCanny", scene, second.Mat());
+    if (pool.Allocated() != 2) {
+      throw std::runtime_error("CannyBufferPool failed: " +
+                               std::to_string(pool.Allocated()) +
+                               " buffers allocated for at most 2 results");
+    }
+    held.Release();
+    second.Release();
+
+    harness.Run({"canny_output", "shared", width, height}, [&] {
+      FastCanny(image, CANNY_GRADIENT_LOWER_THRESHOLD,
+                CANNY_GRADIENT_UPPER_THRESHOLD, GAUSSIAN_KERNEL_SIZE,
+                GAUSSIAN_KERNEL_SIGMA);
+    });
+    harness.Run({"canny_output", "view", width, height}, [&] {
+      FastCanny(input, output, CANNY_GRADIENT_LOWER_THRESHOLD,
+                CANNY_GRADIENT_UPPER_THRESHOLD, GAUSSIAN_KERNEL_SIZE,
+                GAUSSIAN_KERNEL_SIGMA);
+    });
+    harness.Run({"canny_output", "pooled", width, height}, [&] {
+      FastCanny(image, pool, CANNY_GRADIENT_LOWER_THRESHOLD,
+                CANNY_GRADIENT_UPPER_THRESHOLD, GAUSSIAN_KERNEL_SIZE,
+                GAUSSIAN_KERNEL_SIGMA);
+    });
+  }
+}
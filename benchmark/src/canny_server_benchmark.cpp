@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <canny_client.h>
+#include <canny_server.h>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <double_threshold.h>
+#include <gaussian_filter.h>
+#include <gradient.h>
+#include <hysteresis.h>
+#include <iostream>
+#include <memory>
+#include <non_maxima_suppression.h>
+#include <stdexcept>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#define GAUSSIAN_KERNEL_SIZE 3
+#define GAUSSIAN_KERNEL_SIGMA 0.5
+#define CANNY_GRADIENT_LOWER_THRESHOLD 100
+#define CANNY_GRADIENT_UPPER_THRESHOLD 200
+
+using BenchmarkClock = std::chrono::steady_clock;
+
+static CannyServer *runningServer = nullptr;
+
+static void StopServer(int) { runningServer->Stop(); }
+
+// Run a server in a child process, like a daemon on the same host
+static pid_t StartServer(const std::string &socketPath) {
+  pid_t pid = fork();
+  if (pid < 0) {
+    throw std::runtime_error("fork failed");
+  }
+  if (pid == 0) {
+    try {
+      CannyServer server(socketPath);
+      runningServer = &server;
+      std::signal(SIGTERM, StopServer);
+      server.Serve();
+    } catch (const std::exception &err) {
+      std::cerr << "[ERROR] " << err.what() << "\n";
+      _exit(1);
+    }
+    _exit(0);
+  }
+  return pid;
+}
+
+// The server binds its socket after the fork, retry until it does
+static std::unique_ptr<CannyClient> Connect(const std::string &socketPath) {
+  for (int attempt = 0;; attempt++) {
+    try {
+      return std::unique_ptr<CannyClient>(new CannyClient(socketPath));
+    } catch (const std::runtime_error &) {
+      if (attempt == 200) {
+        throw;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+}
+
+void RenderImage(unsigned char *image, int width, int height) {
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      double value = 128 + 80 * std::sin(x * 0.03) * std::cos(y * 0.02) +
+                     (x / 160 + y / 120) % 3 * 30;
+      image[y * width + x] =
+          (unsigned char)std::min(255.0, std::max(0.0, value));
+    }
+  }
+}
+
+// The same pipeline run in this process
+void DetectLocally(const unsigned char *image, unsigned char *edges, int width,
+                   int height) {
+  int size = width * height;
+  std::vector<double> buffers(5 * size, 0.0);
+  double *input = buffers.data();
+  double *blurred = input + size;
+  double *gradient = blurred + size;
+  double *theta = gradient + size;
+  double *suppressed = theta + size;
+
+  std::copy(image, image + size, input);
+  GaussianFilter(input, blurred, GAUSSIAN_KERNEL_SIZE, width, height,
+                 GAUSSIAN_KERNEL_SIGMA);
+  Gradient(blurred, gradient, theta, width, height);
+  NonMaxSuppression(gradient, suppressed, theta, 3, width, height);
+  DoubleThreshold(suppressed, blurred, width, height,
+                  CANNY_GRADIENT_LOWER_THRESHOLD,
+                  CANNY_GRADIENT_UPPER_THRESHOLD);
+  Hysteresis(blurred, input, width, height, CANNY_GRADIENT_LOWER_THRESHOLD,
+             CANNY_GRADIENT_UPPER_THRESHOLD);
+
+  for (int i = 0; i < size; i++) {
+    edges[i] = input[i] != 0.0 ? 255 : 0;
+  }
+}
+
+void BenchmarkLatency(const std::string &socketPath, int width, int height,
+                      int frames) {
+  int size = width * height;
+  std::vector<unsigned char> image(size);
+  std::vector<unsigned char> expected(size);
+  RenderImage(image.data(), width, height);
+  DetectLocally(image.data(), expected.data(), width, height);
+
+  std::unique_ptr<CannyClient> client = Connect(socketPath);
+  std::vector<double> roundTrips;
+  std::vector<double> detections;
+
+  for (int i = 0; i < frames; i++) {
+    BenchmarkClock::time_point st = BenchmarkClock::now();
+    // Zero-copy path: render straight into the shared input
+    unsigned char *input = client->Input(width, height);
+    std::copy(image.begin(), image.end(), input);
+    const unsigned char *edges = client->Detect(
+        CANNY_GRADIENT_LOWER_THRESHOLD, CANNY_GRADIENT_UPPER_THRESHOLD,
+        GAUSSIAN_KERNEL_SIZE, GAUSSIAN_KERNEL_SIGMA);
+    BenchmarkClock::time_point et = BenchmarkClock::now();
+
+    roundTrips.push_back(
+        std::chrono::duration<double, std::micro>(et - st).count());
+    detections.push_back(client->LastDetectMs() * 1000);
+
+    for (int idx = 0; idx < size; idx++) {
+      if (edges[idx] != expected[idx]) {
+        std::cout << "Invalid value at index " << idx << ", expected "
+                  << (int)expected[idx] << ", get " << (int)edges[idx] << "\n";
+        throw std::runtime_error("Invalid canny_server result");
+      }
+    }
+  }
+
+  std::sort(roundTrips.begin(), roundTrips.end());
+  std::sort(detections.begin(), detections.end());
+  double median = roundTrips[frames / 2];
+  double p99 = roundTrips[std::min(frames - 1, frames * 99 / 100)];
+  double detectMedian = detections[frames / 2];
+
+  std::cout << "Benchmarking " << frames << " requests of " << width << "x"
+            << height << " from one client\n";
+  std::cout << "Median round trip (us): " << median << ", p99: " << p99
+            << "\n";
+  std::cout << "Median server detection (us): " << detectMedian << "\n";
+  std::cout << "Median overhead of the round trip (us): "
+            << median - detectMedian << "\n";
+}
+
+void BenchmarkThroughput(const std::string &socketPath, int width, int height,
+                         int clients, int framesPerClient) {
+  std::vector<unsigned char> image(width * height);
+  RenderImage(image.data(), width, height);
+
+  BenchmarkClock::time_point st = BenchmarkClock::now();
+  std::vector<std::thread> threads;
+  std::vector<std::string> errors(clients);
+  for (int c = 0; c < clients; c++) {
+    threads.emplace_back([&, c] {
+      try {
+        std::unique_ptr<CannyClient> client = Connect(socketPath);
+        for (int i = 0; i < framesPerClient; i++) {
+          client->Detect(image.data(), width, height,
+                         CANNY_GRADIENT_LOWER_THRESHOLD,
+                         CANNY_GRADIENT_UPPER_THRESHOLD, GAUSSIAN_KERNEL_SIZE,
+                         GAUSSIAN_KERNEL_SIGMA);
+        }
+      } catch (const std::exception &err) {
+        errors[c] = err.what();
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  double seconds =
+      std::chrono::duration<double>(BenchmarkClock::now() - st).count();
+
+  for (const std::string &error : errors) {
+    if (!error.empty()) {
+      throw std::runtime_error(error);
+    }
+  }
+
+  std::cout << "Benchmarking " << clients << " clients x " << framesPerClient
+            << " requests of " << width << "x" << height << "\n";
+  std::cout << "Frames per second: " << clients * framesPerClient / seconds
+            << "\n";
+}
+
+int main() {
+  std::string socketPath =
+      "/tmp/canny_server_benchmark." + std::to_string(getpid()) + ".sock";
+  // Fork before this process starts any OpenMP threads
+  pid_t server = StartServer(socketPath);
+  int result = 0;
+
+  try {
+    BenchmarkLatency(socketPath, 640, 480, 200);
+    BenchmarkLatency(socketPath, 1920, 1080, 50);
+    BenchmarkThroughput(socketPath, 640, 480, 4, 100);
+
+    std::cout << "All tests passed" << "\n";
+  } catch (const std::exception &err) {
+    std::cerr << "[ERROR] " << err.what() << "\n";
+
+    result = -1;
+  }
+
+  kill(server, SIGTERM);
+  waitpid(server, nullptr, 0);
+  return result;
+}
@@ -1,49 +1,26 @@
+#include "benchmark_cases.h"
+#include "benchmark_fixtures.h"
+#include "cpu_dispatch.h"
 #include "double_threshold.h"
-#include "opencv2/core/base.hpp"
-#include "opencv2/core/mat.hpp"
-#include <exception>
+#include <cmath>
 #include <iostream>
-#include <opencv2/opencv.hpp>
-#include <random>
 #include <stdexcept>
+#include <string>
 
-#define MAX_FREQ 3.4
-#define BASE_FREQ 2.4
+#define DOUBLE_THRESHOLD_LOW 50
+#define DOUBLE_THRESHOLD_HIGH 100
 
-static inline unsigned long long rdtsc(void) {
-  unsigned hi, lo;
-  asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
-  return ((unsigned long long)lo) | (((unsigned long long)hi) << 32);
-}
-
-void BenchmarkDoubleThreshold(int width, int height) {
-  unsigned long long st;
-  unsigned long long et;
-  unsigned long long total = 0;
-  unsigned long long referenceTotal = 0;
-  int repeat = 1000;
+static void BenchmarkDoubleThreshold(BenchmarkHarness &harness, int width,
+                                     int height) {
   int matrixSize = width * height;
+  std::vector<double> input = RandomImage(width, height);
+  std::vector<double> output(matrixSize);
+  std::vector<double> expected(matrixSize);
 
-  int lower_bound = 0;
-  int upper_bound = 256;
-  double low_thres = 50;
-  double high_thres = 100;
-
-  std::uniform_int_distribution<int> unif(lower_bound, upper_bound);
-  std::default_random_engine re;
-
-  double *input = new double[matrixSize]();
-  double *output = new double[matrixSize]();
-  double *expected = new double[matrixSize]();
-  // Generate a random input matrix
-  for (int i = 0; i < matrixSize; i++) {
-    input[i] = unif(re);
-    output[i] = 0.0;
-    expected[i] = 0.0;
-  }
-
-  DoubleThreshold(input, output, width, height, low_thres, high_thres);
-  DoubleThresholdSlow(input, expected, width, height, low_thres, high_thres);
+  DoubleThreshold(input.data(), output.data(), width, height,
+                  DOUBLE_THRESHOLD_LOW, DOUBLE_THRESHOLD_HIGH);
+  DoubleThresholdSlow(input.data(), expected.data(), width, height,
+                      DOUBLE_THRESHOLD_LOW, DOUBLE_THRESHOLD_HIGH);
 
   // Check if the output is correct
   for (int i = 0; i < matrixSize; i++) {
@@ -51,63 +28,70 @@ void BenchmarkDoubleThreshold(int width, int height) {
       std::cout << "output[" << i << "] = " << output[i]
                 << " expected: " << expected[i] << "\n";
       throw std::runtime_error("BenchmarkDoubleThreshold failed: incorrect "
-                               "output from GaussianFilter");
+                               "output from DoubleThreshold");
     }
   }
 
-  for (int i = 0; i != repeat; ++i) {
-    st = rdtsc();
-    DoubleThreshold(input, output, width, height, low_thres, high_thres);
-    ;
-    et = rdtsc();
-
-    total += (et - st);
-  }
-
-  for (int i = 0; i != repeat; ++i) {
-    st = rdtsc();
-    DoubleThresholdSlow(input, expected, width, height, low_thres, high_thres);
-    et = rdtsc();
+  harness.Run({"double_threshold", "dispatch", width, height}, [&] {
+    DoubleThreshold(input.data(), output.data(), width, height,
+                    DOUBLE_THRESHOLD_LOW, DOUBLE_THRESHOLD_HIGH);
+  });
+  harness.Run({"double_threshold", "slow", width, height}, [&] {
+    DoubleThresholdSlow(input.data(), expected.data(), width, height,
+                        DOUBLE_THRESHOLD_LOW, DOUBLE_THRESHOLD_HIGH);
+  });
+}
 
-    referenceTotal += (et - st);
-  }
+static void BenchmarkDoubleThresholdIsaLevels(BenchmarkHarness &harness,
+                                              int width, int height) {
+  struct Kernel {
+    IsaLevel level;
+    void (*run)(double *, double *, int, int, double, double);
+  };
+  const Kernel kernels[] = {{IsaLevel::Scalar, DoubleThresholdScalar},
+                            {IsaLevel::AVX2, DoubleThresholdAVX2},
+                            {IsaLevel::AVX512, DoubleThresholdAVX512}};
 
-  unsigned long long createFilterFLOPSPS = (4 + 6 + 1 + 1 + 1) * 9;
-  unsigned long long kernalFLOPSPS =
-      2 * 9 * width * height + createFilterFLOPSPS;
+  int matrixSize = width * height;
+  std::vector<double> input = RandomImage(width, height);
+  std::vector<double> output(matrixSize);
+  std::vector<double> expected(matrixSize);
 
-  std::cout << "Benchmarking matrix size: " << width << "x" << height << "\n";
-  std::cout << "RDTSC Cycles Taken for double threshold: " << total << "\n";
-  std::cout << "RDTSC Cycles Taken for slow double threshold: "
-            << referenceTotal << "\n";
-  std::cout << "FLOPS Per Cycle for double threshold: "
-            << repeat * kernalFLOPSPS / (total * MAX_FREQ / BASE_FREQ) << "\n";
-  std::cout << "FLOPS Per Cycle for slow double threshol: "
-            << repeat * kernalFLOPSPS / (referenceTotal * MAX_FREQ / BASE_FREQ)
-            << "\n";
-}
+  DoubleThresholdSlow(input.data(), expected.data(), width, height,
+                      DOUBLE_THRESHOLD_LOW, DOUBLE_THRESHOLD_HIGH);
 
-int main(int argc, char *argv[]) {
-  cv::setNumThreads(0);
-  try {
-    std::cout << "Running tests...\n";
+  for (const Kernel &kernel : kernels) {
+    if (kernel.level > DetectIsaLevel()) {
+      continue;
+    }
 
-    std::cout << "...Benchmarking double threshold...\n";
-    BenchmarkDoubleThreshold(8, 8);
-    BenchmarkDoubleThreshold(16, 16);
-    BenchmarkDoubleThreshold(32, 32);
-    BenchmarkDoubleThreshold(64, 64);
-    BenchmarkDoubleThreshold(128, 128);
-    BenchmarkDoubleThreshold(256, 256);
-    BenchmarkDoubleThreshold(512, 512);
-    BenchmarkDoubleThreshold(1024, 1024);
+    kernel.run(input.data(), output.data(), width, height,
+               DOUBLE_THRESHOLD_LOW, DOUBLE_THRESHOLD_HIGH);
+    for (int i = 0; i < matrixSize; i++) {
+      if (output[i] != expected[i]) {
+        std::cout << "output[" << i << "] = " << output[i]
+                  << " expected: " << expected[i] << "\n";
+        throw std::runtime_error(
+            std::string("BenchmarkDoubleThresholdIsaLevels failed: incorrect "
+                        "output from the ") +
+            IsaLevelName(kernel.level) + " kernel");
+      }
+    }
 
-    std::cout << "All tests passed\n";
-  } catch (const std::exception &err) {
-    std::cerr << "[ERROR] " << err.what() << "\n";
+    harness.Run(
+        {"double_threshold", IsaLevelName(kernel.level), width, height}, [&] {
+          kernel.run(input.data(), output.data(), width, height,
+                     DOUBLE_THRESHOLD_LOW, DOUBLE_THRESHOLD_HIGH);
+        });
+  }
+}
 
-    return -1;
+void RunDoubleThresholdBenchmarks(BenchmarkHarness &harness) {
+  for (int size : {8, 16, 32, 64, 128, 256, 512, 1024}) {
+    BenchmarkDoubleThreshold(harness, size, size);
   }
 
-  return 0;
+  BenchmarkDoubleThresholdIsaLevels(harness, 37, 19);
+  BenchmarkDoubleThresholdIsaLevels(harness, 256, 256);
+  BenchmarkDoubleThresholdIsaLevels(harness, 1024, 1024);
 }
@@ -1,62 +1,33 @@
+#include "benchmark_cases.h"
+#include "benchmark_fixtures.h"
+#include "cpu_dispatch.h"
 #include "gradient.h"
 #include "opencv2/core.hpp"
 #include "opencv2/core/base.hpp"
 #include "opencv2/core/mat.hpp"
-#include <cstdlib>
-#include <exception>
 #include <iostream>
 #include <opencv2/opencv.hpp>
-#include <random>
 #include <stdexcept>
+#include <string>
 
-#define MAX_FREQ 3.4
-#define BASE_FREQ 2.4
-#define NUM_IMAGES_PER_SIZE 10
-#define GAUSSIAN_KERNEL_SIZE 3
-#define GAUSSIAN_KERNEL_SIGMA 0.5
-#define CANNY_GRADIENT_LOWER_THRESHOLD 100
-#define CANNY_GRADIENT_UPPER_THRESHOLD 200
-
-static inline unsigned long long rdtsc(void) {
-  unsigned hi, lo;
-  asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
-  return ((unsigned long long)lo) | (((unsigned long long)hi) << 32);
-};
-
-void BenchmarkGradientSlow(int width, int height) {
-  unsigned long long st;
-  unsigned long long et;
-  unsigned long long total = 0;
-  unsigned long long referenceTotal = 0;
-  int repeat = 1000;
-  int matrixSize = width * height;
-
-  int lower_bound = 0;
-  int upper_bound = 256;
-
-  std::uniform_int_distribution<int> unif(lower_bound, upper_bound);
-
-  std::default_random_engine re;
-
-  double *input = new double[matrixSize]();
-  double *output = new double[matrixSize]();
-  double *theta = new double[matrixSize]();
-
-  for (int i = 0; i < matrixSize; i++) {
-    input[i] = unif(re);
-    output[i] = 0.0;
-  }
+// Both 3x3 Sobel kernels per pixel, and generating a kernel
+static double GradientFlops(int width, int height) {
+  double createFilterFLOPS = (4 + 6 + 1 + 1 + 1) * 9;
+  return 2 * 9 * (double)width * height + createFilterFLOPS;
+}
 
-  // initialize arrays
-  cv::Mat expected, grad_x, grad_y, absGradX, absGradY;
+/**
+ * @brief Sobel magnitude and direction with OpenCV, directions in [-pi, pi)
+ * like the kernels
+ */
+static void ReferenceGradient(double *input, int width, int height,
+                              cv::Mat &magnitude, cv::Mat &angle) {
+  cv::Mat gradX, gradY;
   cv::Mat src(height, width, CV_64F, input);
 
-  // calculate magnitude
-  cv::Sobel(src, grad_x, CV_64F, 1, 0, 3, 1, 0, cv::BORDER_CONSTANT);
-  cv::Sobel(src, grad_y, CV_64F, 0, 1, 3, 1, 0, cv::BORDER_CONSTANT);
-
-  cv::Mat magnitude, angle;
-  cv::cartToPolar(grad_x, grad_y, magnitude, angle, false);
+  cv::Sobel(src, gradX, CV_64F, 1, 0, 3, 1, 0, cv::BORDER_CONSTANT);
+  cv::Sobel(src, gradY, CV_64F, 0, 1, 3, 1, 0, cv::BORDER_CONSTANT);
+  cv::cartToPolar(gradX, gradY, magnitude, angle, false);
 
   for (int y = 0; y < angle.rows; y++) {
     for (int x = 0; x < angle.cols; x++) {
@@ -66,332 +37,149 @@ void BenchmarkGradientSlow(int width, int height) {
       }
     }
   }
-
-  GradientSlow(input, output, theta, width, height);
-
-  for (int i = 0; i < matrixSize; i++) {
-    if (std::abs(output[i] - magnitude.at<double>(i)) > 1e-4) {
-      std::cout << "output[" << i << "] = " << output[i]
-                << " expected: " << magnitude.at<double>(i) << "\n";
-      throw std::runtime_error("BenchmarkGradientSlow  failed: incorrect "
-                               "output from GradientSlow");
-    }
-  }
-
-  for (int i = 0; i != repeat; ++i) {
-    st = rdtsc();
-    cv::Mat expected, grad_x, grad_y, absGradX, absGradY;
-    cv::Mat src(height, width, CV_64F, input);
-
-    // calculate magnitude
-    cv::Sobel(src, grad_x, CV_64F, 1, 0, 3, 1, 0, cv::BORDER_CONSTANT);
-    cv::Sobel(src, grad_y, CV_64F, 0, 1, 3, 1, 0, cv::BORDER_CONSTANT);
-
-    cv::Mat magnitude, angle;
-    cv::cartToPolar(grad_x, grad_y, magnitude, angle, false);
-
-    for (int y = 0; y < angle.rows; y++) {
-      for (int x = 0; x < angle.cols; x++) {
-        double currentAngle = angle.at<double>(y, x);
-        if (currentAngle >= CV_PI) {
-          angle.at<double>(y, x) -= 2 * CV_PI;
-        }
-      }
-    }
-    et = rdtsc();
-
-    referenceTotal += (et - st);
-  }
-
-  for (int i = 0; i != repeat; ++i) {
-    st = rdtsc();
-    GradientSlow(input, output, theta, width, height);
-    et = rdtsc();
-
-    total += (et - st);
-  }
-
-  unsigned long long createFilterFLOPSPS = (4 + 6 + 1 + 1 + 1) * 9;
-  unsigned long long kernalFLOPSPS =
-      2 * 9 * width * height + createFilterFLOPSPS;
-
-  std::cout << "Benchmarking matrix size: " << width << "x" << height << "\n";
-  std::cout << "RDTSC Cycles Taken for GradientSlow: " << total << "\n";
-  std::cout << "RDTSC Cycles Taken for cv::Sobel: " << referenceTotal << "\n";
-  std::cout << "FLOPS Per Cycle for GradientSlow: "
-            << repeat * kernalFLOPSPS / (total * MAX_FREQ / BASE_FREQ) << "\n";
-  std::cout << "FLOPS Per Cycle for cv::Sobel: "
-            << repeat * kernalFLOPSPS / (referenceTotal * MAX_FREQ / BASE_FREQ)
-            << "\n";
-
-  delete[] input;
-  delete[] output;
-  delete[] theta;
 }
 
-void BenchmarkGradient(int width, int height) {
-  unsigned long long st;
-  unsigned long long et;
-  unsigned long long total = 0;
-  unsigned long long referenceTotal = 0;
-  int repeat = 1000;
-  int matrixSize = width * height;
-
-  int lower_bound = 0;
-  int upper_bound = 256;
-
-  std::uniform_int_distribution<int> unif(lower_bound, upper_bound);
-  std::default_random_engine re;
-
-  double *input = new double[matrixSize]();
-  double *output = new double[matrixSize]();
-  double *theta = new double[matrixSize]();
+using GradientKernel = void (*)(const double *, double *, double *, int, int);
 
-  // Generate a random input matrix
-  for (int i = 0; i < matrixSize; i++) {
-    input[i] = unif(re);
-    output[i] = 0.0;
-  }
-
-  // initialize arrays
-  cv::Mat expected, grad_x, grad_y, absGradX, absGradY;
-  cv::Mat src(height, width, CV_64F, input);
-
-  // calculate magnitude
-  cv::Sobel(src, grad_x, CV_64F, 1, 0, 3, 1, 0, cv::BORDER_CONSTANT);
-  cv::Sobel(src, grad_y, CV_64F, 0, 1, 3, 1, 0, cv::BORDER_CONSTANT);
-
-  cv::Mat magnitude, angle;
-  cv::cartToPolar(grad_x, grad_y, magnitude, angle, false);
-
-  for (int y = 0; y < angle.rows; y++) {
-    for (int x = 0; x < angle.cols; x++) {
-      double currentAngle = angle.at<double>(y, x);
-      if (currentAngle >= CV_PI) {
-        angle.at<double>(y, x) -= 2 * CV_PI;
-      }
-    }
-  }
+static void SlowGradient(const double *input, double *output, double *theta,
+                         int width, int height) {
+  GradientSlow(input, output, theta, width, height);
+}
 
-  // TODO: change this to fast call
+static void DispatchedGradient(const double *input, double *output,
+                               double *theta, int width, int height) {
   Gradient(input, output, theta, width, height);
+}
 
-  // Check if the output is correct
-  for (int i = 0; i < matrixSize; i++) {
-    if (std::abs(output[i] - magnitude.at<double>(i)) > 1e-3) {
-      std::cout << "output[" << i << "] = " << output[i]
-                << " expected: " << magnitude.at<double>(i) << "\n";
-
-      std::cout << "width: " << width << " height: " << height << "\n";
-      throw std::runtime_error("BenchmarkGradient failed: incorrect "
-                               "output from Gradient");
-    }
-  }
-
-  for (int i = 0; i != repeat; ++i) {
-    st = rdtsc();
-    Gradient(input, output, theta, width, height);
-    et = rdtsc();
-
-    total += (et - st);
-  }
-
-  for (int i = 0; i != repeat; ++i) {
-    st = rdtsc();
-    // initialize arrays
-    cv::Mat expected, grad_x, grad_y, absGradX, absGradY;
-    cv::Mat src(height, width, CV_64F, input);
-
-    // calculate magnitude
-    cv::Sobel(src, grad_x, CV_64F, 1, 0, 3, 1, 0, cv::BORDER_CONSTANT);
-    cv::Sobel(src, grad_y, CV_64F, 0, 1, 3, 1, 0, cv::BORDER_CONSTANT);
-
-    cv::Mat magnitude, angle;
-    cv::cartToPolar(grad_x, grad_y, magnitude, angle, false);
-
-    for (int y = 0; y < angle.rows; y++) {
-      for (int x = 0; x < angle.cols; x++) {
-        double currentAngle = angle.at<double>(y, x);
-        if (currentAngle >= CV_PI) {
-          angle.at<double>(y, x) -= 2 * CV_PI;
-        }
-      }
-    }
-    et = rdtsc();
-
-    referenceTotal += (et - st);
-  }
-
-  unsigned long long createFilterFLOPSPS = (4 + 6 + 1 + 1 + 1) * 9;
-  unsigned long long kernalFLOPSPS =
-      2 * 9 * width * height + createFilterFLOPSPS;
+static void ScalarGradient(const double *input, double *output, double *theta,
+                           int width, int height) {
+  GradientScalar(input, output, theta, width, height);
+}
 
-  std::cout << "Benchmarking matrix size: " << width << "x" << height << "\n";
-  std::cout << "RDTSC Cycles Taken for Gradient: " << total << "\n";
-  std::cout << "RDTSC Cycles Taken for cv::Sobel: " << referenceTotal << "\n";
-  std::cout << "FLOPS Per Cycle for Gradient: "
-            << repeat * kernalFLOPSPS / (total * MAX_FREQ / BASE_FREQ) << "\n";
-  std::cout << "FLOPS Per Cycle for cv::Sobel: "
-            << repeat * kernalFLOPSPS / (referenceTotal * MAX_FREQ / BASE_FREQ)
-            << "\n";
+static void Avx2Gradient(const double *input, double *output, double *theta,
+                         int width, int height) {
+  GradientAVX2(input, output, theta, width, height);
+}
 
-  delete[] input;
-  delete[] output;
-  delete[] theta;
+static void Avx512Gradient(const double *input, double *output, double *theta,
+                           int width, int height) {
+  GradientAVX512(input, output, theta, width, height);
 }
 
-void TestGradientSlowCorrectness(int width, int height) {
+/**
+ * @brief Compare `gradient` with OpenCV on a random image, the magnitude
+ * within `tolerance` and, when `checkTheta`, the direction within 1e-3
+ */
+static void TestGradientCorrectness(GradientKernel gradient, const char *name,
+                                    int width, int height, double tolerance,
+                                    bool checkTheta) {
   int matrixSize = width * height;
-  double *input = new double[matrixSize]();
-  double *output = new double[matrixSize]();
-  double *theta = new double[matrixSize]();
-
-  int lower_bound = 0;
-  int upper_bound = 256;
-
-  std::uniform_int_distribution<int> unif(lower_bound, upper_bound);
-  std::default_random_engine re;
-
-  for (int i = 0; i < matrixSize; i++) {
-    input[i] = unif(re);
-    output[i] = 0.0;
-  }
-
-  // initialize arrays
-  cv::Mat expected, grad_x, grad_y, absGradX, absGradY;
-  cv::Mat src(height, width, CV_64F, input);
-
-  cv::Sobel(src, grad_x, CV_64F, 1, 0, 3, 1, 0, cv::BORDER_CONSTANT);
-  cv::Sobel(src, grad_y, CV_64F, 0, 1, 3, 1, 0, cv::BORDER_CONSTANT);
+  std::vector<double> input = RandomImage(width, height);
+  std::vector<double> output(matrixSize);
+  std::vector<double> theta(matrixSize);
 
   cv::Mat magnitude, angle;
-  cv::cartToPolar(grad_x, grad_y, magnitude, angle, false);
-
-  for (int y = 0; y < angle.rows; y++) {
-    for (int x = 0; x < angle.cols; x++) {
-      double currentAngle = angle.at<double>(y, x);
-      if (currentAngle >= CV_PI) {
-        angle.at<double>(y, x) -= 2 * CV_PI;
-      }
-    }
-  }
-
-  GradientSlow(input, output, theta, width, height);
+  ReferenceGradient(input.data(), width, height, magnitude, angle);
+  gradient(input.data(), output.data(), theta.data(), width, height);
 
   for (int i = 0; i < matrixSize; i++) {
-    if (std::abs(output[i] - magnitude.at<double>(i)) > 1e-3) {
+    if (std::abs(output[i] - magnitude.at<double>(i)) > tolerance) {
       std::cout << "output[" << i << "] = " << output[i]
-                << " expected: " << magnitude.at<double>(i)
-                << "diff: " << std::abs(output[i] - magnitude.at<double>(i))
-                << "\n";
+                << " expected: " << magnitude.at<double>(i) << "\n";
       std::cout << "width: " << width << " height: " << height << "\n";
-      throw std::runtime_error("TestGradientSlowCorrectness failed");
+      throw std::runtime_error(std::string("TestGradientCorrectness failed "
+                                           "for ") +
+                               name);
     }
-
-    if (std::abs(theta[i] - angle.at<double>(i)) > 1e-3) {
+    if (checkTheta && std::abs(theta[i] - angle.at<double>(i)) > 1e-3) {
       std::cout << "theta[" << i << "] = " << theta[i]
                 << " expected: " << angle.at<double>(i) << "\n";
       std::cout << "width: " << width << " height: " << height << "\n";
-      throw std::runtime_error("TestGradientSlowCorrectness failed");
+      throw std::runtime_error(std::string("TestGradientCorrectness failed "
+                                           "for ") +
+                               name);
     }
   }
-
-  delete[] input;
-  delete[] output;
-  delete[] theta;
 }
 
-void TestGradientCorrectness(int width, int height) {
-  int matrixSize = width * height;
-  double *input = new double[matrixSize]();
-  double *output = new double[matrixSize]();
-  double *theta = new double[matrixSize]();
-
-  int lower_bound = 0;
-  int upper_bound = 256;
-
-  std::uniform_int_distribution<int> unif(lower_bound, upper_bound);
-  std::default_random_engine re;
-
-  for (int i = 0; i < matrixSize; i++) {
-    input[i] = unif(re);
-    output[i] = 0.0;
-  }
-
-  // initialize arrays
-  cv::Mat expected, grad_x, grad_y, absGradX, absGradY;
-  cv::Mat src(height, width, CV_64F, input);
-
-  // calculate magnitude
-  cv::Sobel(src, grad_x, CV_64F, 1, 0, 3, 1, 0, cv::BORDER_CONSTANT);
-  cv::Sobel(src, grad_y, CV_64F, 0, 1, 3, 1, 0, cv::BORDER_CONSTANT);
+static void BenchmarkGradient(BenchmarkHarness &harness,
+                              GradientKernel gradient,
+                              const char *implementation, int width,
+                              int height) {
+  std::vector<double> input = RandomImage(width, height);
+  std::vector<double> output(width * height);
+  std::vector<double> theta(width * height);
+
+  harness.Run({"gradient", implementation, width, height, 1,
+               GradientFlops(width, height)},
+              [&] {
+                gradient(input.data(), output.data(), theta.data(), width,
+                         height);
+              });
+}
 
+static void BenchmarkReferenceGradient(BenchmarkHarness &harness, int width,
+                                       int height) {
+  std::vector<double> input = RandomImage(width, height);
   cv::Mat magnitude, angle;
-  cv::cartToPolar(grad_x, grad_y, magnitude, angle, false);
-
-  for (int y = 0; y < angle.rows; y++) {
-    for (int x = 0; x < angle.cols; x++) {
-      double currentAngle = angle.at<double>(y, x);
-      if (currentAngle >= CV_PI) {
-        angle.at<double>(y, x) -= 2 * CV_PI;
-      }
-    }
-  }
 
-  Gradient(input, output, theta, width, height);
+  harness.Run(
+      {"gradient", "opencv", width, height, 1, GradientFlops(width, height)},
+      [&] {
+        ReferenceGradient(input.data(), width, height, magnitude, angle);
+      });
+}
 
-  for (int i = 0; i < matrixSize; i++) {
-    if (std::abs(output[i] - magnitude.at<double>(i)) > 1e-4) {
-      std::cout << "output[" << i << "] = " << output[i]
-                << " expected: " << magnitude.at<double>(i) << "\n";
-      std::cout << "width: " << width << " height: " << height << "\n";
-      throw std::runtime_error("TestGradientCorrectness failed");
+/**
+ * @brief Check every kernel the CPU supports against OpenCV, then time it.
+ * Odd widths cover the end of the rows
+ */
+static void BenchmarkGradientIsaLevels(BenchmarkHarness &harness, int width,
+                                       int height) {
+  struct Kernel {
+    IsaLevel level;
+    GradientKernel run;
+  };
+  const Kernel kernels[] = {{IsaLevel::Scalar, ScalarGradient},
+                            {IsaLevel::AVX2, Avx2Gradient},
+                            {IsaLevel::AVX512, Avx512Gradient}};
+
+  for (const Kernel &kernel : kernels) {
+    if (kernel.level > DetectIsaLevel()) {
+      continue;
     }
-  }
 
-  delete[] input;
-  delete[] output;
-  delete[] theta;
+    TestGradientCorrectness(kernel.run, IsaLevelName(kernel.level), width,
+                            height, 1e-4, false);
+    BenchmarkGradient(harness, kernel.run, IsaLevelName(kernel.level), width,
+                      height);
+  }
 }
 
-int main(int argc, char *argv[]) {
-  cv::setNumThreads(0);
-  try {
-    std::cout << "Running tests...\n";
-
-    std::cout << "...Testing GradientSlow correctness...\n";
-    TestGradientSlowCorrectness(3, 3);
-    TestGradientSlowCorrectness(8, 8);
-    TestGradientSlowCorrectness(32, 32);
-    TestGradientSlowCorrectness(1024, 1024);
-    std::cout << "GradientSlow correctness passed\n";
-
-    std::cout << "...Benchmarking GradientSlow...\n";
-    BenchmarkGradientSlow(8, 8);
-    BenchmarkGradientSlow(16, 16);
-    BenchmarkGradientSlow(32, 32);
-    BenchmarkGradientSlow(64, 64);
-
-    std::cout << "...Testing Gradient correctness...\n";
-    TestGradientCorrectness(4, 4);
-    TestGradientCorrectness(8, 8);
-    TestGradientCorrectness(32, 32);
-    TestGradientCorrectness(64, 64);
-    std::cout << "Gradient correctness passed\n";
-
-    std::cout << "...Benchmarking Gradient...\n";
-    BenchmarkGradient(4, 4);
-    BenchmarkGradient(8, 8);
-    BenchmarkGradient(16, 16);
-    BenchmarkGradient(32, 32);
-    BenchmarkGradient(64, 64);
-
-    std::cout << "All tests passed\n";
-  } catch (const std::exception &err) {
-    std::cerr << "[ERROR] " << err.what() << "\n";
+void RunGradientBenchmarks(BenchmarkHarness &harness) {
+  for (int size : {3, 8, 32, 1024}) {
+    TestGradientCorrectness(SlowGradient, "GradientSlow", size, size, 1e-3,
+                            true);
+  }
+  for (int size : {8, 16, 32, 64}) {
+    TestGradientCorrectness(SlowGradient, "GradientSlow", size, size, 1e-4,
+                            false);
+    BenchmarkGradient(harness, SlowGradient, "slow", size, size);
+  }
 
-    return -1;
+  for (int size : {4, 8, 32, 64}) {
+    TestGradientCorrectness(DispatchedGradient, "Gradient", size, size, 1e-4,
+                            false);
+  }
+  for (int size : {4, 8, 16, 32, 64}) {
+    TestGradientCorrectness(DispatchedGradient, "Gradient", size, size, 1e-3,
+                            false);
+    BenchmarkGradient(harness, DispatchedGradient, "dispatch", size, size);
+    BenchmarkReferenceGradient(harness, size, size);
   }
 
-  return 0;
+  BenchmarkGradientIsaLevels(harness, 3, 5);
+  BenchmarkGradientIsaLevels(harness, 67, 53);
+  BenchmarkGradientIsaLevels(harness, 101, 37);
+  BenchmarkGradientIsaLevels(harness, 1024, 1024);
 }
@@ -1,31 +1,23 @@
-
-#include <hysteresis.h>
+#include "benchmark_cases.h"
+#include "cpu_dispatch.h"
+#include "hysteresis.h"
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
-#define MAX_FREQ 3.4
-#define BASE_FREQ 2.4
-
-static inline unsigned long long rdtsc(void) {
-  unsigned hi, lo;
-  asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
-  return ((unsigned long long)lo) | (((unsigned long long)hi) << 32);
-}
+#define HYSTERESIS_LOW 50
+#define HYSTERESIS_HIGH 100
 
-void TestHysteresisFilledWithEdges(int width, int height) {
+static void TestHysteresisFilledWithEdges(int width, int height) {
   int size = width * height;
-  double *input = new double[size];
-  double *output = new double[(width + 1) * (height + 1)];
-  int low = 50;
-  int high = 100;
-
-  for (int i = 0; i < size; i++) {
-    input[i] = 50;
-  }
-
-  input[0] = 100;
+  std::vector<double> input(size, HYSTERESIS_LOW);
+  std::vector<double> output((width + 1) * (height + 1));
+  input[0] = HYSTERESIS_HIGH;
 
-  HysteresisQueue(input, output, width, height, low, high);
+  HysteresisQueue(input.data(), output.data(), width, height, HYSTERESIS_LOW,
+                  HYSTERESIS_HIGH);
 
   for (int i = 0; i < size; i++) {
     if (output[i] != 255) {
@@ -36,91 +28,122 @@ void TestHysteresisFilledWithEdges(int width, int height) {
   }
 }
 
-void TestHysteresisOneEdge(int width, int height) {
+static void TestHysteresisOneEdge(int width, int height) {
   int size = width * height;
-  double *input = new double[size];
-  double *output = new double[(width + 1) * (height + 1)];
-  int low = 50;
-  int high = 100;
+  std::vector<double> input(size, 0);
+  std::vector<double> output((width + 1) * (height + 1));
+  input[0] = HYSTERESIS_HIGH;
+  input[1] = HYSTERESIS_LOW;
+  input[2] = HYSTERESIS_LOW;
+  input[3] = HYSTERESIS_LOW;
 
-  for (int i = 0; i < size; i++) {
-    input[i] = 0;
-  }
-
-  input[0] = high;
-  input[1] = low;
-  input[2] = low;
-  input[3] = low;
-
-  HysteresisQueue(input, output, width, height, low, high);
+  HysteresisQueue(input.data(), output.data(), width, height, HYSTERESIS_LOW,
+                  HYSTERESIS_HIGH);
 
   if (output[0] != 255 || output[1] != 255 || output[2] != 255 ||
       output[3] != 255) {
     throw std::runtime_error("Edge not connected");
   }
-
   for (int i = 4; i < size; i++) {
     if (output[i] != 0) {
-      std::cout << "Invalid value at index " << i << ", expected " << 255
+      std::cout << "Invalid value at index " << i << ", expected " << 0
                 << ", get " << output[i] << "\n";
       throw std::runtime_error("Invalid hysteresis result");
     }
   }
 }
 
-void BenchmarkHysteresisFilledWithEdges(int width, int height) {
+static void BenchmarkHysteresisFilledWithEdges(BenchmarkHarness &harness,
+                                               int width, int height) {
   int size = width * height;
-  double *input = new double[size];
-  double *output = new double[(width + 1) * (height + 1)];
-  int low = 50;
-  int high = 100;
-  int repeat = 1000;
-  unsigned long long st;
-  unsigned long long et;
-  unsigned long long total = 0;
-
-  for (int i = 0; i != repeat; i++) {
-    for (int i = 0; i < size; i++) {
-      input[i] = low;
-    }
-
-    input[0] = high;
-
-    st = rdtsc();
-
-    Hysteresis(input, output, width, height, low, high);
+  std::vector<double> input(size);
+  std::vector<double> output((width + 1) * (height + 1));
+
+  harness.Run(
+      {"hysteresis", "dispatch", width, height},
+      [&] {
+        Hysteresis(input.data(), output.data(), width, height, HYSTERESIS_LOW,
+                   HYSTERESIS_HIGH);
+      },
+      [&] {
+        std::fill(input.begin(), input.end(), HYSTERESIS_LOW);
+        input[0] = HYSTERESIS_HIGH;
+      });
+}
 
-    et = rdtsc();
+// A weak edge snaking through the whole image, seeded by one strong pixel. This
+// is the worst case for the sweeping kernels.
+static void BenchmarkHysteresisIsaLevels(BenchmarkHarness &harness, int width,
+                                         int height) {
+  struct Kernel {
+    IsaLevel level;
+    void (*run)(double *, double *, int, int, double, double);
+  };
+  const Kernel kernels[] = {{IsaLevel::Scalar, HysteresisScalar},
+                            {IsaLevel::AVX2, HysteresisAVX2},
+                            {IsaLevel::AVX512, HysteresisAVX512}};
 
-    total += (et - st);
+  int size = width * height;
+  std::vector<double> thresholded(size);
+  std::vector<double> input(size);
+  std::vector<double> output(size);
+  std::vector<double> expected(size);
+
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      bool onPath = (y % 4 == 0) || (y % 8 < 4 && x == width - 1) ||
+                    (y % 8 >= 4 && x == 0);
+      thresholded[y * width + x] = onPath ? HYSTERESIS_LOW : 0;
+    }
   }
+  thresholded[0] = HYSTERESIS_HIGH;
 
-  // TODO: need to confirm if it is the right way to meansure performance
-  // It is assuming for each pixel, it needs to compare with 8 neighbors
-  unsigned long long kernalFLOPS = width * height * 8;
+  input = thresholded;
+  HysteresisScalar(input.data(), expected.data(), width, height,
+                   HYSTERESIS_LOW, HYSTERESIS_HIGH);
 
-  std::cout << "Benchmarking matrix size: " << width << "x" << height << "\n";
-  std::cout << "RDTSC Cycles Taken for Hysteresis: " << total << "\n";
-  std::cout << "FLOPS Per Cycle for Hysteresis: "
-            << repeat * kernalFLOPS / (total * MAX_FREQ / BASE_FREQ) << "\n";
-}
+  for (const Kernel &kernel : kernels) {
+    if (kernel.level > DetectIsaLevel()) {
+      continue;
+    }
 
-int main() {
-  try {
-    TestHysteresisFilledWithEdges(8, 8);
-    TestHysteresisOneEdge(8, 8);
+    // The AVX2 kernel updates its input in place
+    input = thresholded;
+    kernel.run(input.data(), output.data(), width, height, HYSTERESIS_LOW,
+               HYSTERESIS_HIGH);
+    for (int i = 0; i < size; i++) {
+      if (output[i] != expected[i]) {
+        std::cout << "Invalid value at index " << i << ", expected "
+                  << expected[i] << ", get " << output[i] << "\n";
+        throw std::runtime_error(std::string("Invalid hysteresis result from "
+                                             "the ") +
+                                 IsaLevelName(kernel.level) + " kernel");
+      }
+    }
 
-    BenchmarkHysteresisFilledWithEdges(32, 32);
-    BenchmarkHysteresisFilledWithEdges(64, 64);
-    BenchmarkHysteresisFilledWithEdges(128, 128);
-    BenchmarkHysteresisFilledWithEdges(256, 256);
-    BenchmarkHysteresisFilledWithEdges(512, 512);
-    BenchmarkHysteresisFilledWithEdges(1024, 1024);
+    harness.Run(
+        {"hysteresis_snake", IsaLevelName(kernel.level), width, height},
+        [&] {
+          kernel.run(input.data(), output.data(), width, height,
+                     HYSTERESIS_LOW, HYSTERESIS_HIGH);
+        },
+        [&] {
+          std::copy(thresholded.begin(), thresholded.end(), input.begin());
+        });
+  }
+}
 
-    std::cout << "All tests passed" << "\n";
-  } catch (const std::exception &err) {
-    std::cerr << "[ERROR] " << err.what() << "\n";
+void RunHysteresisBenchmarks(BenchmarkHarness &harness) {
+  TestHysteresisFilledWithEdges(8, 8);
+  TestHysteresisOneEdge(8, 8);
 
-    return -1;
+  for (int size : {32, 64, 128, 256, 512, 1024}) {
+    BenchmarkHysteresisFilledWithEdges(harness, size, size);
   }
+
+  BenchmarkHysteresisIsaLevels(harness, 64, 64);
+  BenchmarkHysteresisIsaLevels(harness, 256, 256);
+  // Widths that leave a tail after the vector loops
+  BenchmarkHysteresisIsaLevels(harness, 67, 53);
+  BenchmarkHysteresisIsaLevels(harness, 100, 37);
 }
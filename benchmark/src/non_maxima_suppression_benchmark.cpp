@@ -1,52 +1,24 @@
+#include "benchmark_cases.h"
+#include "benchmark_fixtures.h"
+#include "cpu_dispatch.h"
 #include "non_maxima_suppression.h"
-#include "opencv2/opencv.hpp"
-#include <exception>
+#include <cmath>
 #include <iostream>
-#include <opencv2/opencv.hpp>
-#include <random>
 #include <stdexcept>
+#include <string>
 
-#define MAX_FREQ 3.4
-#define BASE_FREQ 2.4
-#define GAUSSIAN_KERNEL_SIZE 3
-
-static inline unsigned long long rdtsc(void) {
-  unsigned hi, lo;
-  asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
-  return ((unsigned long long)lo) | (((unsigned long long)hi) << 32);
-}
-
-void BenchmarkNonMaxSupp(int width, int height) {
-  unsigned long long st;
-  unsigned long long et;
-  unsigned long long total = 0;
-  unsigned long long referenceTotal = 0;
-  int repeat = 1000;
+static void BenchmarkNonMaxSupp(BenchmarkHarness &harness, int width,
+                                int height) {
   int matrixSize = width * height;
+  std::vector<double> input = RandomImage(width, height);
+  std::vector<double> theta = RandomAngles(width, height);
+  std::vector<double> output(matrixSize);
+  std::vector<double> expected(matrixSize);
 
-  int lower_bound = 0;
-  int upper_bound = 256;
-  double low_thres = 50;
-  double high_thres = 100;
-
-  std::uniform_int_distribution<int> unif(lower_bound, upper_bound);
-  std::uniform_real_distribution<double> unifPi(-CV_PI, CV_PI);
-  std::default_random_engine re;
-
-  double *input = new double[matrixSize]();
-  double *output = new double[matrixSize]();
-  double *expected = new double[matrixSize]();
-  double *theta = new double[matrixSize]();
-  // Generate a random input matrix
-  for (int i = 0; i < matrixSize; i++) {
-    input[i] = unif(re);
-    theta[i] = unifPi(re);
-    output[i] = 0.0;
-    expected[i] = 0.0;
-  }
-
-  NonMaxSuppression(input, output, theta, 3, width, height);
-  NonMaxSuppressionSlow(input, expected, theta, 3, width, height);
+  NonMaxSuppression(input.data(), output.data(), theta.data(), 3, width,
+                    height);
+  NonMaxSuppressionSlow(input.data(), expected.data(), theta.data(), 3, width,
+                        height);
 
   // Check if the output is correct
   for (int i = 0; i < matrixSize; i++) {
@@ -58,59 +30,70 @@ void BenchmarkNonMaxSupp(int width, int height) {
     }
   }
 
-  for (int i = 0; i != repeat; ++i) {
-    st = rdtsc();
-    NonMaxSuppression(input, output, theta, 3, width, height);
-    et = rdtsc();
+  harness.Run({"non_maxima_suppression", "dispatch", width, height}, [&] {
+    NonMaxSuppression(input.data(), output.data(), theta.data(), 3, width,
+                      height);
+  });
+  harness.Run({"non_maxima_suppression", "slow", width, height}, [&] {
+    NonMaxSuppressionSlow(input.data(), expected.data(), theta.data(), 3,
+                          width, height);
+  });
+}
 
-    total += (et - st);
-  }
+static void BenchmarkNonMaxSuppIsaLevels(BenchmarkHarness &harness, int width,
+                                         int height) {
+  struct Kernel {
+    IsaLevel level;
+    void (*run)(double *, double *, double *, int, int, int);
+  };
+  const Kernel kernels[] = {{IsaLevel::Scalar, NonMaxSuppressionScalar},
+                            {IsaLevel::AVX2, NonMaxSuppressionAVX2},
+                            {IsaLevel::AVX512, NonMaxSuppressionAVX512}};
+
+  std::vector<double> input = RandomImage(width, height);
+  std::vector<double> theta = RandomAngles(width, height);
+  std::vector<double> output(width * height);
+  std::vector<double> expected(width * height);
+
+  NonMaxSuppressionSlow(input.data(), expected.data(), theta.data(), 3, width,
+                        height);
+
+  for (const Kernel &kernel : kernels) {
+    if (kernel.level > DetectIsaLevel()) {
+      continue;
+    }
 
-  for (int i = 0; i != repeat; ++i) {
-    st = rdtsc();
-    NonMaxSuppressionSlow(input, expected, theta, 3, width, height);
-    et = rdtsc();
+    kernel.run(input.data(), output.data(), theta.data(), 3, width, height);
+    // Border pixels are not written by the kernels, only compare the inside
+    for (int y = 1; y < height - 1; y++) {
+      for (int x = 1; x < width - 1; x++) {
+        int i = y * width + x;
+        if (std::abs(output[i] - expected[i]) > 1e-6) {
+          std::cout << "output[" << i << "] = " << output[i]
+                    << " expected: " << expected[i] << "\n";
+          throw std::runtime_error(
+              std::string("BenchmarkNonMaxSuppIsaLevels failed: incorrect "
+                          "output from the ") +
+              IsaLevelName(kernel.level) + " kernel");
+        }
+      }
+    }
 
-    referenceTotal += (et - st);
+    harness.Run({"non_maxima_suppression", IsaLevelName(kernel.level), width,
+                 height},
+                [&] {
+                  kernel.run(input.data(), output.data(), theta.data(), 3,
+                             width, height);
+                });
   }
-
-  unsigned long long createFilterFLOPSPS = (4 + 6 + 1 + 1 + 1) * 9;
-  unsigned long long kernalFLOPSPS =
-      2 * 9 * width * height + createFilterFLOPSPS;
-
-  std::cout << "Benchmarking matrix size: " << width << "x" << height << "\n";
-  std::cout << "RDTSC Cycles Taken for Non Maxima Suppresion: " << total
-            << "\n";
-  std::cout << "RDTSC Cycles Taken for slow Non Maxima Suppresion: "
-            << referenceTotal << "\n";
-  std::cout << "FLOPS Per Cycle for Non Maxima Suppresion: "
-            << repeat * kernalFLOPSPS / (total * MAX_FREQ / BASE_FREQ) << "\n";
-  std::cout << "FLOPS Per Cycle for slow Non Maxima Suppresion: "
-            << repeat * kernalFLOPSPS / (referenceTotal * MAX_FREQ / BASE_FREQ)
-            << "\n";
 }
 
-int main(int argc, char *argv[]) {
-  cv::setNumThreads(0);
-  try {
-    std::cout << "Running tests...\n";
-
-    std::cout << "...Benchmarking double threshold...\n";
-    BenchmarkNonMaxSupp(8, 8);
-    BenchmarkNonMaxSupp(16, 16);
-    BenchmarkNonMaxSupp(32, 32);
-    BenchmarkNonMaxSupp(64, 64);
-    BenchmarkNonMaxSupp(128, 128);
-    BenchmarkNonMaxSupp(256, 256);
-    BenchmarkNonMaxSupp(512, 512);
-    BenchmarkNonMaxSupp(1024, 1024);
-
-    std::cout << "All tests passed\n";
-  } catch (const std::exception &err) {
-    std::cerr << "[ERROR] " << err.what() << "\n";
-
-    return -1;
+void RunNonMaxSuppressionBenchmarks(BenchmarkHarness &harness) {
+  for (int size : {8, 16, 32, 64, 128, 256, 512, 1024}) {
+    BenchmarkNonMaxSupp(harness, size, size);
   }
 
-  return 0;
+  BenchmarkNonMaxSuppIsaLevels(harness, 37, 19);
+  BenchmarkNonMaxSuppIsaLevels(harness, 256, 256);
+  BenchmarkNonMaxSuppIsaLevels(harness, 1024, 1024);
 }
@@ -0,0 +1,94 @@
+#include "benchmark_fixtures.h"
+#include "benchmark_harness.h"
+#include <canny_pipeline.h>
+#include <cpu_dispatch.h>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <video_canny.h>
+
+#define CANNY_GRADIENT_LOWER_THRESHOLD 100
+#define CANNY_GRADIENT_UPPER_THRESHOLD 200
+
+void BenchmarkMovingObject(int width, int height, int objectSize,
+                           int frames) {
+  int size = width * height;
+  std::vector<std::vector<double>> sequence(frames, std::vector<double>(size));
+  std::vector<double> expected(size);
+  unsigned long long st;
+  unsigned long long et;
+  unsigned long long fullTotal = 0;
+  unsigned long long incrementalTotal = 0;
+  long long recomputedTiles = 0;
+
+  for (int i = 0; i < frames; i++) {
+    RenderScene(sequence[i].data(), width, height, objectSize, i);
+  }
+
+  VideoCanny session(width, height, CANNY_GRADIENT_LOWER_THRESHOLD,
+                     CANNY_GRADIENT_UPPER_THRESHOLD, GAUSSIAN_KERNEL_SIZE,
+                     GAUSSIAN_KERNEL_SIGMA);
+
+  for (int i = 0; i < frames; i++) {
+    st = ReadTsc();
+    // The reference, FastCanny on every frame
+    FastCanny(ImageView<const double>(sequence[i].data(), width, height),
+              ImageView<double>(expected.data(), width, height),
+              CANNY_GRADIENT_LOWER_THRESHOLD, CANNY_GRADIENT_UPPER_THRESHOLD,
+              GAUSSIAN_KERNEL_SIZE, GAUSSIAN_KERNEL_SIGMA);
+    et = ReadTsc();
+    fullTotal += (et - st);
+
+    st = ReadTsc();
+    const double *edges = session.ProcessFrame(sequence[i].data());
+    et = ReadTsc();
+    // The first frame is always computed in full
+    if (i > 0) {
+      incrementalTotal += (et - st);
+      recomputedTiles += session.RecomputedTiles();
+    }
+
+    for (int idx = 0; idx < size; idx++) {
+      if (edges[idx] != expected[idx]) {
+        std::cout << "Invalid value in frame " << i << " at index " << idx
+                  << ", expected " << expected[idx] << ", get " << edges[idx]
+                  << "\n";
+        throw std::runtime_error("Invalid video session result");
+      }
+    }
+  }
+
+  // The full pipeline average includes the first frame as well
+  unsigned long long fullPerFrame = fullTotal / frames;
+  unsigned long long incrementalPerFrame = incrementalTotal / (frames - 1);
+
+  std::cout << "Benchmarking " << frames << " frames of " << width << "x"
+            << height << " with a " << objectSize << "x" << objectSize
+            << " moving object\n";
+  std::cout << "Average recomputed tiles: "
+            << recomputedTiles / (frames - 1) << "/" << session.TileCount()
+            << "\n";
+  std::cout << "Microseconds Per Frame for full Canny: "
+            << fullPerFrame * TscNanosecondsPerTick() / 1000 << "\n";
+  std::cout << "Microseconds Per Frame for VideoCanny: "
+            << incrementalPerFrame * TscNanosecondsPerTick() / 1000 << "\n";
+  std::cout << "Speedup: " << (double)fullPerFrame / incrementalPerFrame
+            << "\n";
+}
+
+int main() {
+  std::cout << "Kernel ISA level: " << IsaLevelName(ActiveIsaLevel()) << "\n";
+
+  try {
+    BenchmarkMovingObject(640, 480, 32, 60);
+    // Partial tiles on the right and bottom edges
+    BenchmarkMovingObject(333, 217, 24, 60);
+    BenchmarkMovingObject(1920, 1080, 64, 60);
+
+    std::cout << "All tests passed" << "\n";
+  } catch (const std::exception &err) {
+    std::cerr << "[ERROR] " << err.what() << "\n";
+
+    return -1;
+  }
+}
@@ -0,0 +1,195 @@
+#include "fast_canny_c.h"
+#include "canny_pipeline.h"
+#include "canny_workspace.h"
+#include "image_view.h"
+#include <exception>
+#include <new>
+#include <string>
+
+struct fc_context {
+  fc_params params;
+  CannyWorkspace workspace;
+  // Reserved so that short messages do not allocate
+  std::string lastError;
+};
+
+/**
+ * @brief Record `message` as the context's last error and return `status`
+ */
+static fc_status Fail(fc_context *context, fc_status status,
+                      const char *message) {
+  try {
+    context->lastError = message;
+  } catch (...) {
+    context->lastError.clear();
+  }
+  return status;
+}
+
+static bool ValidParams(const fc_params *params) {
+  return params->kernel_size > 0 && params->kernel_size % 2 == 1 &&
+         params->sigma > 0;
+}
+
+static bool ValidImage(const void *input, size_t inputStride, void *output,
+                       size_t outputStride, int width, int height) {
+  return input != nullptr && output != nullptr && width > 0 && height > 0 &&
+         inputStride >= (size_t)width && outputStride >= (size_t)width;
+}
+
+/**
+ * @brief Run `detect` on the context's workspace, turning exceptions into
+ * statuses
+ */
+template <class Detect>
+static fc_status Run(fc_context *context, Detect detect) {
+  try {
+    detect();
+  } catch (const PixelRangeError &e) {
+    // Names the first pixel outside the range
+    return Fail(context, FC_ERROR_OUT_OF_RANGE, e.what());
+  } catch (const std::bad_alloc &) {
+    return Fail(context, FC_ERROR_OUT_OF_MEMORY, "out of memory");
+  } catch (const std::exception &e) {
+    return Fail(context, FC_ERROR_INTERNAL, e.what());
+  } catch (...) {
+    return Fail(context, FC_ERROR_INTERNAL, "unknown error");
+  }
+  context->lastError.clear();
+  return FC_OK;
+}
+
+int fc_api_version(void) { return FC_API_VERSION; }
+
+void fc_default_params(fc_params *params) {
+  if (params == nullptr) {
+    return;
+  }
+  params->lower_threshold = 100;
+  params->upper_threshold = 200;
+  params->kernel_size = 3;
+  params->sigma = 0.5;
+}
+
+const char *fc_status_string(fc_status status) {
+  switch (status) {
+  case FC_OK:
+    return "ok";
+  case FC_ERROR_INVALID_ARGUMENT:
+    return "invalid argument";
+  case FC_ERROR_OUT_OF_RANGE:
+    return "pixel value outside [0, 255]";
+  case FC_ERROR_OUT_OF_MEMORY:
+    return "out of memory";
+  case FC_ERROR_INTERNAL:
+    return "internal error";
+  }
+  return "unknown status";
+}
+
+fc_status fc_context_create(const fc_params *params, fc_context **context) {
+  if (context == nullptr) {
+    return FC_ERROR_INVALID_ARGUMENT;
+  }
+  *context = nullptr;
+  fc_params chosen;
+  fc_default_params(&chosen);
+  if (params != nullptr) {
+    if (!ValidParams(params)) {
+      return FC_ERROR_INVALID_ARGUMENT;
+    }
+    chosen = *params;
+  }
+
+  fc_context *created = new (std::nothrow) fc_context();
+  if (created == nullptr) {
+    return FC_ERROR_OUT_OF_MEMORY;
+  }
+  created->params = chosen;
+  try {
+    created->lastError.reserve(128);
+  } catch (...) {
+    delete created;
+    return FC_ERROR_OUT_OF_MEMORY;
+  }
+  *context = created;
+  return FC_OK;
+}
+
+void fc_context_destroy(fc_context *context) { delete context; }
+
+fc_status fc_context_set_params(fc_context *context,
+                                const fc_params *params) {
+  if (context == nullptr) {
+    return FC_ERROR_INVALID_ARGUMENT;
+  }
+  if (params == nullptr || !ValidParams(params)) {
+    return Fail(context, FC_ERROR_INVALID_ARGUMENT,
+                "kernel size must be odd and positive, sigma positive");
+  }
+  context->params = *params;
+  context->lastError.clear();
+  return FC_OK;
+}
+
+fc_status fc_context_reserve(fc_context *context, int width, int height) {
+  if (context == nullptr) {
+    return FC_ERROR_INVALID_ARGUMENT;
+  }
+  if (width <= 0 || height <= 0) {
+    return Fail(context, FC_ERROR_INVALID_ARGUMENT,
+                "image size must be positive");
+  }
+  return Run(context, [&] { context->workspace.Reserve(width, height); });
+}
+
+const char *fc_context_last_error(const fc_context *context) {
+  return context != nullptr ? context->lastError.c_str() : "";
+}
+
+fc_status fc_detect_u8(fc_context *context, const uint8_t *input,
+                       size_t input_stride, uint8_t *output,
+                       size_t output_stride, int width, int height) {
+  if (context == nullptr) {
+    return FC_ERROR_INVALID_ARGUMENT;
+  }
+  if (!ValidImage(input, input_stride, output, output_stride, width,
+                  height)) {
+    return Fail(context, FC_ERROR_INVALID_ARGUMENT,
+                "images must be non-null with a positive size and strides "
+                "of at least a row");
+  }
+
+  const fc_params &params = context->params;
+  return Run(context, [&] {
+    context->workspace.Detect(
+        ImageView<const unsigned char>(input, width, height, input_stride),
+        ImageView<unsigned char>(output, width, height, output_stride),
+        params.lower_threshold, params.upper_threshold, params.kernel_size,
+        params.sigma);
+  });
+}
+
+fc_status fc_detect_f64(fc_context *context, const double *input,
+                        size_t input_stride, double *output,
+                        size_t output_stride, int width, int height) {
+  if (context == nullptr) {
+    return FC_ERROR_INVALID_ARGUMENT;
+  }
+  if (!ValidImage(input, input_stride, output, output_stride, width,
+                  height)) {
+    return Fail(context, FC_ERROR_INVALID_ARGUMENT,
+                "images must be non-null with a positive size and strides "
+                "of at least a row");
+  }
+
+  const fc_params &params = context->params;
+  return Run(context, [&] {
+    // The range is checked by the blur, which throws PixelRangeError
+    context->workspace.Detect(
+        ImageView<const double>(input, width, height, input_stride),
+        ImageView<double>(output, width, height, output_stride),
+        params.lower_threshold, params.upper_threshold, params.kernel_size,
+        params.sigma);
+  });
+}
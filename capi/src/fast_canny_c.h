@@ -0,0 +1,103 @@
+#ifndef FAST_CANNY_C_H
+#define FAST_CANNY_C_H
+
+/*
+ * Plain C interface of FastCanny, for embedding through FFI.
+ *
+ * The caller owns every image buffer. A context keeps the intermediate images
+ * of the pipeline from one call to the next, so once it has seen, or
+ * reserved, a frame size, they are not allocated again.
+ * A context must only be used by one thread at a time. No C++ exception
+ * crosses this interface, every failure is reported as an fc_status.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#define FC_API __declspec(dllexport)
+#else
+#define FC_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Incremented whenever a declaration below changes incompatibly */
+#define FC_API_VERSION 1
+
+typedef struct fc_context fc_context;
+
+typedef enum fc_status {
+  FC_OK = 0,
+  /* A null pointer, a non-positive size or a stride shorter than a row */
+  FC_ERROR_INVALID_ARGUMENT = 1,
+  /* A pixel of a double image outside [0, 255] */
+  FC_ERROR_OUT_OF_RANGE = 2,
+  FC_ERROR_OUT_OF_MEMORY = 3,
+  FC_ERROR_INTERNAL = 4
+} fc_status;
+
+typedef struct fc_params {
+  int lower_threshold;
+  int upper_threshold;
+  /* Gaussian kernel size and sigma of the blur */
+  int kernel_size;
+  double sigma;
+} fc_params;
+
+/* FC_API_VERSION of the library actually loaded */
+FC_API int fc_api_version(void);
+
+/* The defaults of detect_edge: thresholds 100/200, a 3x3 kernel, sigma 0.5 */
+FC_API void fc_default_params(fc_params *params);
+
+/* Static description of a status, never null */
+FC_API const char *fc_status_string(fc_status status);
+
+/*
+ * Create a context in *context using `params`, or the defaults when null.
+ * Destroy it with fc_context_destroy.
+ */
+FC_API fc_status fc_context_create(const fc_params *params,
+                                   fc_context **context);
+
+/* Free a context and its buffers. Null is ignored. */
+FC_API void fc_context_destroy(fc_context *context);
+
+FC_API fc_status fc_context_set_params(fc_context *context,
+                                       const fc_params *params);
+
+/* Allocate the buffers for `width` x `height` frames ahead of the first one */
+FC_API fc_status fc_context_reserve(fc_context *context, int width,
+                                    int height);
+
+/*
+ * Message of the last failed call on the context, empty after a successful
+ * one. Valid until the next call on the context.
+ */
+FC_API const char *fc_context_last_error(const fc_context *context);
+
+/*
+ * Edges of an 8-bit `width` x `height` image as 255 for edges and 0
+ * elsewhere. Strides are the distance between the starts of two rows in
+ * bytes, at least `width`.
+ */
+FC_API fc_status fc_detect_u8(fc_context *context, const uint8_t *input,
+                              size_t input_stride, uint8_t *output,
+                              size_t output_stride, int width, int height);
+
+/*
+ * Edges of a double image with pixels in [0, 255], the output of FastCanny.
+ * Strides are in doubles, at least `width`.
+ */
+FC_API fc_status fc_detect_f64(fc_context *context, const double *input,
+                               size_t input_stride, double *output,
+                               size_t output_stride, int width, int height);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FAST_CANNY_C_H */
@@ -0,0 +1,71 @@
+#include "auto_threshold.h"
+#include "gradient.h"
+#include <algorithm>
+
+static CannyThresholds MedianThresholds(const unsigned int *histogram,
+                                        unsigned long long total) {
+  unsigned long long count = 0;
+  int bin = 1;
+  for (; bin < GRADIENT_HISTOGRAM_BINS; bin++) {
+    count += histogram[bin];
+    if (2 * count >= total) {
+      break;
+    }
+  }
+
+  // Bins hold [bin, bin + 1), take the middle of the median bin
+  double median = bin + 0.5;
+  int lower = std::max(1, (int)(0.67 * median));
+  int upper = std::max(lower + 1, (int)(1.33 * median));
+  return {lower, upper};
+}
+
+static CannyThresholds OtsuThresholds(const unsigned int *histogram,
+                                      unsigned long long total) {
+  double sum = 0;
+  for (int bin = 1; bin < GRADIENT_HISTOGRAM_BINS; bin++) {
+    sum += (double)bin * histogram[bin];
+  }
+
+  // Pick the split maximizing the variance between the two classes
+  double sumBelow = 0;
+  unsigned long long countBelow = 0;
+  double bestVariance = -1;
+  int split = 1;
+  for (int bin = 1; bin < GRADIENT_HISTOGRAM_BINS; bin++) {
+    countBelow += histogram[bin];
+    sumBelow += (double)bin * histogram[bin];
+    unsigned long long countAbove = total - countBelow;
+    if (countBelow == 0 || countAbove == 0) {
+      continue;
+    }
+
+    double meanBelow = sumBelow / countBelow;
+    double meanAbove = (sum - sumBelow) / countAbove;
+    double variance = (double)countBelow * countAbove *
+                      (meanBelow - meanAbove) * (meanBelow - meanAbove);
+    if (variance > bestVariance) {
+      bestVariance = variance;
+      split = bin;
+    }
+  }
+
+  // Magnitudes above the split bin are the edge class
+  int upper = split + 1;
+  return {std::max(1, upper / 2), upper};
+}
+
+CannyThresholds SelectThresholds(const unsigned int *histogram,
+                                 ThresholdMethod method) {
+  unsigned long long total = 0;
+  for (int bin = 1; bin < GRADIENT_HISTOGRAM_BINS; bin++) {
+    total += histogram[bin];
+  }
+
+  if (total == 0) {
+    return {GRADIENT_HISTOGRAM_BINS, GRADIENT_HISTOGRAM_BINS + 1};
+  }
+
+  return method == ThresholdMethod::Otsu ? OtsuThresholds(histogram, total)
+                                         : MedianThresholds(histogram, total);
+}
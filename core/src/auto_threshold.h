@@ -0,0 +1,22 @@
+#pragma once
+
+enum class ThresholdMethod {
+  // Thresholds at 0.67 and 1.33 times the median magnitude
+  Median,
+  // Upper threshold at the Otsu split of the magnitudes, lower at half of it
+  Otsu
+};
+
+struct CannyThresholds {
+  int lower;
+  int upper;
+};
+
+/**
+ * @brief Derive Canny thresholds from a gradient magnitude histogram of
+ * GRADIENT_HISTOGRAM_BINS bins, as filled by Gradient(). Bin 0, the flat
+ * pixels that dominate most images, is ignored. An image without any gradient
+ * gets thresholds no magnitude reaches.
+ */
+CannyThresholds SelectThresholds(const unsigned int *histogram,
+                                 ThresholdMethod method);
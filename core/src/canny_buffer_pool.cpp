@@ -0,0 +1,77 @@
+#include "canny_buffer_pool.h"
+#include <utility>
+
+PooledEdges::~PooledEdges() { Release(); }
+
+PooledEdges::PooledEdges(PooledEdges &&other) noexcept
+    : pool(std::move(other.pool)), buffer(std::move(other.buffer)),
+      mat(other.mat) {
+  other.mat = cv::Mat();
+}
+
+PooledEdges &PooledEdges::operator=(PooledEdges &&other) noexcept {
+  if (this != &other) {
+    Release();
+    pool = std::move(other.pool);
+    buffer = std::move(other.buffer);
+    mat = other.mat;
+    other.mat = cv::Mat();
+  }
+  return *this;
+}
+
+void PooledEdges::Release() {
+  mat = cv::Mat();
+  if (pool == nullptr) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    // The free list was reserved up front, so this does not allocate
+    if (pool->buffers.size() < pool->maxBuffers) {
+      pool->buffers.push_back(std::move(buffer));
+    }
+  }
+  // Frees the buffer when the pool already had enough
+  buffer = std::vector<double>();
+  pool.reset();
+}
+
+CannyBufferPool::CannyBufferPool(size_t maxBuffers)
+    : state(std::make_shared<CannyBufferPoolState>()) {
+  state->maxBuffers = maxBuffers;
+  state->buffers.reserve(maxBuffers);
+}
+
+PooledEdges CannyBufferPool::Acquire(int rows, int cols) {
+  size_t size = (size_t)rows * cols;
+  PooledEdges edges;
+  bool reused = false;
+
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    for (size_t i = state->buffers.size(); i-- > 0;) {
+      if (state->buffers[i].capacity() >= size) {
+        edges.buffer = std::move(state->buffers[i]);
+        state->buffers.erase(state->buffers.begin() + i);
+        reused = true;
+        break;
+      }
+    }
+    if (!reused) {
+      state->allocated++;
+    }
+  }
+
+  // Within the capacity of a reused buffer, so only new buffers allocate
+  edges.buffer.resize(size);
+  edges.pool = state;
+  edges.mat = cv::Mat(rows, cols, CV_64F, edges.buffer.data());
+  return edges;
+}
+
+size_t CannyBufferPool::Allocated() const {
+  std::lock_guard<std::mutex> lock(state->mutex);
+  return state->allocated;
+}
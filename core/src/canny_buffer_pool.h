@@ -0,0 +1,76 @@
+#pragma once
+
+#include "opencv2/core/mat.hpp"
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Free buffers of a pool, shared with the results still holding one so they
+// may outlive the pool
+struct CannyBufferPoolState {
+  std::mutex mutex;
+  std::vector<std::vector<double>> buffers;
+  size_t maxBuffers = 0;
+  size_t allocated = 0;
+};
+
+/**
+ * @brief Edges in a buffer borrowed from a CannyBufferPool. The buffer goes
+ * back to the pool when the result is released or destroyed, so the Mat must
+ * not be used after that. Move-only.
+ */
+class PooledEdges {
+public:
+  PooledEdges() = default;
+  ~PooledEdges();
+
+  PooledEdges(PooledEdges &&other) noexcept;
+  PooledEdges &operator=(PooledEdges &&other) noexcept;
+  PooledEdges(const PooledEdges &) = delete;
+  PooledEdges &operator=(const PooledEdges &) = delete;
+
+  /**
+   * @brief CV_64F header over the pooled buffer, empty once released
+   */
+  cv::Mat &Mat() { return mat; }
+  const cv::Mat &Mat() const { return mat; }
+
+  /**
+   * @brief Hand the buffer back to its pool early
+   */
+  void Release();
+
+private:
+  friend class CannyBufferPool;
+
+  std::shared_ptr<CannyBufferPoolState> pool;
+  std::vector<double> buffer;
+  cv::Mat mat;
+};
+
+/**
+ * @brief Recycles the buffers of edge images, for services that return a
+ * result per frame without allocating one per frame.
+ *
+ * A released buffer is kept for the next result unless `maxBuffers` are
+ * already waiting, and is reused for any image that fits in it. Thread-safe.
+ */
+class CannyBufferPool {
+public:
+  explicit CannyBufferPool(size_t maxBuffers = 8);
+
+  /**
+   * @brief A `rows` x `cols` CV_64F image in a pooled buffer, with undefined
+   * pixels. Only allocates when no waiting buffer is large enough.
+   */
+  PooledEdges Acquire(int rows, int cols);
+
+  /**
+   * @brief Number of buffers the pool allocated so far
+   */
+  size_t Allocated() const;
+
+private:
+  std::shared_ptr<CannyBufferPoolState> state;
+};
@@ -0,0 +1,93 @@
+#include "canny_executor.h"
+#include <algorithm>
+#include <stdexcept>
+
+CannyExecutor::CannyExecutor(int workers, size_t queueDepth)
+    : queueDepth(std::max<size_t>(1, queueDepth)) {
+  if (workers <= 0) {
+    throw std::runtime_error("CannyExecutor failed: worker count must be "
+                             "positive");
+  }
+
+  for (int i = 0; i < workers; i++) {
+    this->workers.emplace_back(&CannyExecutor::Run, this);
+  }
+}
+
+CannyExecutor::~CannyExecutor() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  jobQueued.notify_all();
+
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+}
+
+void CannyExecutor::Submit(std::function<void()> job) {
+  std::unique_lock<std::mutex> lock(mutex);
+  jobTaken.wait(lock, [this] { return jobs.size() < queueDepth; });
+  jobs.push_back(std::move(job));
+  lock.unlock();
+  jobQueued.notify_one();
+}
+
+bool CannyExecutor::TrySubmit(std::function<void()> job) {
+  std::unique_lock<std::mutex> lock(mutex);
+  if (jobs.size() >= queueDepth) {
+    return false;
+  }
+  jobs.push_back(std::move(job));
+  lock.unlock();
+  jobQueued.notify_one();
+  return true;
+}
+
+void CannyExecutor::Wait() {
+  std::unique_lock<std::mutex> lock(mutex);
+  jobDone.wait(lock, [this] { return jobs.empty() && running == 0; });
+}
+
+size_t CannyExecutor::Pending() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return jobs.size() + running;
+}
+
+void CannyExecutor::Run() {
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while (true) {
+    jobQueued.wait(lock, [this] { return stopping || !jobs.empty(); });
+    if (jobs.empty()) {
+      // Stopping, and everything queued has been taken
+      return;
+    }
+
+    std::function<void()> job = std::move(jobs.front());
+    jobs.pop_front();
+    running++;
+    lock.unlock();
+    jobTaken.notify_one();
+
+    try {
+      job();
+    } catch (...) {
+      // Keep the worker alive, see Submit()
+    }
+    // Release what the job captured before taking the lock again
+    job = nullptr;
+
+    lock.lock();
+    running--;
+    if (jobs.empty() && running == 0) {
+      jobDone.notify_all();
+    }
+  }
+}
+
+CannyExecutor &DefaultCannyExecutor() {
+  static CannyExecutor executor;
+  return executor;
+}
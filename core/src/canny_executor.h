@@ -0,0 +1,71 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Worker threads running queued jobs in submission order, behind the
+ * asynchronous FastCanny entry points.
+ *
+ * The queue holds at most `queueDepth` jobs that have not started. Submit()
+ * blocks while it is full, which pushes back on producers that outpace the
+ * detector, and TrySubmit() reports it instead. Every job already runs on the
+ * whole OpenMP team, so one worker is usually enough; more workers only help
+ * when jobs are too small to keep the team busy.
+ */
+class CannyExecutor {
+public:
+  explicit CannyExecutor(int workers = 1, size_t queueDepth = 16);
+
+  /**
+   * @brief Finish the queued jobs and stop the workers
+   */
+  ~CannyExecutor();
+
+  CannyExecutor(const CannyExecutor &) = delete;
+  CannyExecutor &operator=(const CannyExecutor &) = delete;
+
+  /**
+   * @brief Queue a job, waiting for room if the queue is full. Jobs report
+   * their own errors, an exception escaping one is dropped.
+   */
+  void Submit(std::function<void()> job);
+
+  /**
+   * @brief Queue a job unless the queue is full. Returns whether it was
+   * queued.
+   */
+  bool TrySubmit(std::function<void()> job);
+
+  /**
+   * @brief Wait until every submitted job has finished
+   */
+  void Wait();
+
+  // Jobs queued or running
+  size_t Pending();
+
+private:
+  void Run();
+
+  size_t queueDepth;
+  std::mutex mutex;
+  std::condition_variable jobQueued;
+  std::condition_variable jobTaken;
+  std::condition_variable jobDone;
+  std::deque<std::function<void()>> jobs;
+  size_t running = 0;
+  bool stopping = false;
+  std::vector<std::thread> workers;
+};
+
+/**
+ * @brief Executor used by the asynchronous entry points when none is given,
+ * created on first use with one worker and a queue of 16 jobs
+ */
+CannyExecutor &DefaultCannyExecutor();
@@ -0,0 +1,155 @@
+#include "canny_mask.h"
+#include "suppressed_region.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#define LABEL_NON_EDGE 0
+#define LABEL_WEAK_EDGE 1
+#define LABEL_STRONG_EDGE 2
+
+CannyMask::CannyMask(const unsigned char *mask, int width, int height,
+                     size_t stride, int tileSize)
+    : width(width), height(height), tileSize(std::max(1, tileSize)) {
+  if (width <= 0 || height <= 0) {
+    throw std::runtime_error("CannyMask failed: mask size must be positive");
+  }
+
+  tilesX = (width + this->tileSize - 1) / this->tileSize;
+  tilesY = (height + this->tileSize - 1) / this->tileSize;
+  coverage.resize((size_t)tilesX * tilesY);
+  pixels.resize((size_t)width * height);
+
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      pixels[(size_t)y * width + x] = mask[y * stride + x] != 0;
+    }
+  }
+
+  for (int tile = 0; tile < tilesX * tilesY; tile++) {
+    int x0 = (tile % tilesX) * this->tileSize;
+    int y0 = (tile / tilesX) * this->tileSize;
+    int x1 = std::min(width, x0 + this->tileSize);
+    int y1 = std::min(height, y0 + this->tileSize);
+    int selected = 0;
+
+    for (int y = y0; y < y1; y++) {
+      for (int x = x0; x < x1; x++) {
+        selected += pixels[(size_t)y * width + x];
+      }
+    }
+
+    coverage[tile] = selected == 0                         ? Coverage::Empty
+                     : selected == (x1 - x0) * (y1 - y0) ? Coverage::Full
+                                                           : Coverage::Partial;
+    if (coverage[tile] != Coverage::Empty) {
+      activeTiles.push_back(tile);
+    }
+  }
+}
+
+/**
+ * @brief Run blur, gradient, suppression and thresholding on every active
+ * tile, each from its own halo, then follow weak edges from the strong pixels
+ * found. Empty tiles are only cleared.
+ */
+void MaskedCanny(const double *input, size_t stride, const CannyMask &mask,
+                 int lowerThreshold, int upperThreshold, int kernelSize,
+                 double sigma, double *output) {
+  int width = mask.Width();
+  int height = mask.Height();
+  int tileSize = mask.TileSize();
+  int tilesX = mask.TilesX();
+  const std::vector<int> &activeTiles = mask.ActiveTiles();
+
+  // Unselected pixels keep the non-edge label, so the flood fill stops there
+  std::vector<unsigned char> labels((size_t)width * height, LABEL_NON_EDGE);
+  std::vector<int> stack;
+  // First active tile with a pixel out of range, if any
+  size_t outOfRange = activeTiles.size();
+
+#pragma omp parallel reduction(min : outOfRange)
+  {
+    std::vector<double> scratch;
+    std::vector<double> suppressed;
+    std::vector<int> seeds;
+
+#pragma omp for schedule(dynamic) nowait
+    for (size_t i = 0; i < activeTiles.size(); i++) {
+      int tile = activeTiles[i];
+      int x0 = (tile % tilesX) * tileSize;
+      int y0 = (tile / tilesX) * tileSize;
+      int x1 = std::min(width, x0 + tileSize);
+      int y1 = std::min(height, y0 + tileSize);
+      bool partial = mask.TileCoverage(tile) == CannyMask::Coverage::Partial;
+
+      suppressed.resize((size_t)(x1 - x0) * (y1 - y0));
+      if (!SuppressedGradientRegion(input, width, height, stride, x0, y0, x1,
+                                    y1, kernelSize, sigma, scratch,
+                                    suppressed.data())) {
+        outOfRange = std::min(outOfRange, i);
+        continue;
+      }
+
+      for (int y = y0; y < y1; y++) {
+        const double *nmsRow = &suppressed[(size_t)(y - y0) * (x1 - x0)];
+        for (int x = x0; x < x1; x++) {
+          if (partial && !mask.Selected(x, y)) {
+            continue;
+          }
+
+          double value = nmsRow[x - x0];
+          int idx = y * width + x;
+          if (value >= upperThreshold) {
+            labels[idx] = LABEL_STRONG_EDGE;
+            seeds.push_back(idx);
+          } else if (value >= lowerThreshold) {
+            labels[idx] = LABEL_WEAK_EDGE;
+          }
+        }
+      }
+    }
+
+#pragma omp critical
+    stack.insert(stack.end(), seeds.begin(), seeds.end());
+  }
+
+  if (outOfRange < activeTiles.size()) {
+    int tile = activeTiles[outOfRange];
+    int x0 = (tile % tilesX) * tileSize;
+    int y0 = (tile / tilesX) * tileSize;
+    ThrowRegionRangeError(input, width, height, stride, x0, y0,
+                          std::min(width, x0 + tileSize),
+                          std::min(height, y0 + tileSize), kernelSize,
+                          "MaskedCanny");
+  }
+
+  // Everything but the edges found below is 0
+#pragma omp parallel for schedule(static)
+  for (int y = 0; y < height; y++) {
+    std::memset(&output[(size_t)y * width], 0, width * sizeof(double));
+  }
+
+  for (int idx : stack) {
+    output[idx] = upperThreshold;
+  }
+
+  while (!stack.empty()) {
+    int idx = stack.back();
+    stack.pop_back();
+    int y = idx / width;
+    int x = idx % width;
+
+    for (int ny = std::max(0, y - 1); ny <= std::min(height - 1, y + 1); ny++) {
+      for (int nx = std::max(0, x - 1); nx <= std::min(width - 1, x + 1);
+           nx++) {
+        int nidx = ny * width + nx;
+        if (labels[nidx] == LABEL_WEAK_EDGE) {
+          labels[nidx] = LABEL_STRONG_EDGE;
+          output[nidx] = upperThreshold;
+          stack.push_back(nidx);
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Binary mask of the pixels whose edges are needed, analyzed once into
+ * a tile bitmap so it can be reused for every frame.
+ *
+ * Tiles entirely outside the mask are skipped by every stage, tiles entirely
+ * inside it run without any per-pixel check, and only tiles crossing the mask
+ * boundary test each pixel.
+ */
+class CannyMask {
+public:
+  enum class Coverage : unsigned char { Empty, Partial, Full };
+
+  /**
+   * @brief Build from `height` rows of `width` bytes, `stride` bytes apart.
+   * Non-zero bytes select a pixel.
+   */
+  CannyMask(const unsigned char *mask, int width, int height, size_t stride,
+            int tileSize = 64);
+
+  int Width() const { return width; }
+  int Height() const { return height; }
+  int TileSize() const { return tileSize; }
+  int TilesX() const { return tilesX; }
+  int TilesY() const { return tilesY; }
+  Coverage TileCoverage(int tile) const { return coverage[tile]; }
+  // Tiles that are not Empty, in row-major order
+  const std::vector<int> &ActiveTiles() const { return activeTiles; }
+  bool Selected(int x, int y) const {
+    return pixels[(size_t)y * width + x] != 0;
+  }
+
+private:
+  int width;
+  int height;
+  int tileSize;
+  int tilesX;
+  int tilesY;
+  std::vector<Coverage> coverage;
+  std::vector<int> activeTiles;
+  std::vector<unsigned char> pixels;
+};
+
+/**
+ * @brief Canny edges of the pixels selected by `mask`, with the same values as
+ * FastCanny (upperThreshold or 0). The filters read real pixels around the
+ * mask, weak edges are only followed through selected pixels, and everything
+ * outside the mask is 0. `input` has `stride` doubles per row, `output` is
+ * width * height and contiguous.
+ */
+void MaskedCanny(const double *input, size_t stride, const CannyMask &mask,
+                 int lowerThreshold, int upperThreshold, int kernelSize,
+                 double sigma, double *output);
@@ -0,0 +1,50 @@
+#include "canny_pipeline.h"
+#include "canny_workspace.h"
+#include <sstream>
+
+/**
+ * @brief Scratch images of FastCanny, kept for the life of the calling thread
+ */
+static CannyWorkspace &ThreadWorkspace() {
+  thread_local CannyWorkspace workspace;
+  return workspace;
+}
+
+static std::string PixelRangeMessage(const std::string &caller, int x, int y,
+                                     double value) {
+  std::ostringstream message;
+  message << caller << " failed: input image must have pixel values in the "
+          << "range [0, 255], pixel (" << x << ", " << y << ") is " << value;
+  return message.str();
+}
+
+PixelRangeError::PixelRangeError(const std::string &caller, int x, int y,
+                                 double value)
+    : std::runtime_error(PixelRangeMessage(caller, x, y, value)), x(x), y(y),
+      value(value) {}
+
+void ThrowPixelRangeError(ImageView<const double> image, const char *caller,
+                          int originX, int originY) {
+  for (int i = 0; i < image.height; i++) {
+    const double *row = image.Row(i);
+    for (int j = 0; j < image.width; j++) {
+      // NaN fails both compares
+      if (!(row[j] >= 0 && row[j] <= 255)) {
+        throw PixelRangeError(caller, originX + j, originY + i, row[j]);
+      }
+    }
+  }
+  throw std::logic_error(std::string(caller) +
+                         " failed: no pixel out of range found");
+}
+
+void FastCanny(ImageView<const double> input, ImageView<double> output,
+               int lowerThreshold, int upperThreshold, int kernelSize,
+               double sigma, RangeCheck check) {
+  if (input.width == 0 || input.height == 0) {
+    return;
+  }
+
+  ThreadWorkspace().Detect(input, output, lowerThreshold, upperThreshold,
+                           kernelSize, sigma, check);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "image_view.h"
+#include <stdexcept>
+#include <string>
+
+/**
+ * @brief Whether FastCanny checks that the pixels are in [0, 255], the range
+ * the thresholds of the pipeline are meant for. The check is fused into the
+ * padding of the first blur, so it costs no pass of its own; Skip is for
+ * inputs known to be in range, such as images converted from 8 bits.
+ */
+enum class RangeCheck { Validate, Skip };
+
+/**
+ * @brief Thrown for an input with a pixel outside [0, 255] or NaN, naming the
+ * first such pixel in row order
+ */
+class PixelRangeError : public std::runtime_error {
+public:
+  PixelRangeError(const std::string &caller, int x, int y, double value);
+
+  int x;
+  int y;
+  double value;
+};
+
+/**
+ * @brief Throw the PixelRangeError of `image`, once the range check of the
+ * blur found a pixel outside [0, 255]. Only this error path scans the image
+ * for it. `image` can be part of a larger one starting at (originX, originY),
+ * which the reported position is counted from.
+ */
+[[noreturn]] void ThrowPixelRangeError(ImageView<const double> image,
+                                       const char *caller, int originX = 0,
+                                       int originY = 0);
+
+/**
+ * @brief FastCanny from and into caller memory of the same size, e.g. a
+ * pitched camera buffer or a sub-view of a larger image, see image_view.h.
+ * The intermediate images are kept per calling thread, so repeated calls on
+ * one size do not allocate. Needs no OpenCV, fast_canny.h has the cv::Mat
+ * entry points.
+ */
+void FastCanny(ImageView<const double> input, ImageView<double> output,
+               int lowerThreshold, int upperThreshold, int kernelSize,
+               double sigma, RangeCheck check = RangeCheck::Validate);
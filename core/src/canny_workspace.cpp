@@ -0,0 +1,121 @@
+#include "canny_workspace.h"
+#include "double_threshold.h"
+#include "gaussian_filter.h"
+#include "gradient.h"
+#include "hysteresis.h"
+#include "non_maxima_suppression.h"
+#include <algorithm>
+#include <stdexcept>
+
+/**
+ * @brief Throw unless input and output have the same, non-empty size
+ */
+static void CheckSizes(int inputWidth, int inputHeight, int outputWidth,
+                       int outputHeight) {
+  if (inputWidth <= 0 || inputHeight <= 0 || inputWidth != outputWidth ||
+      inputHeight != outputHeight) {
+    throw std::runtime_error("CannyWorkspace failed: input and output must "
+                             "have the same positive size");
+  }
+}
+
+void CannyWorkspace::Detect(ImageView<const unsigned char> input,
+                            ImageView<unsigned char> output,
+                            int lowerThreshold, int upperThreshold,
+                            int kernelSize, double sigma) {
+  CheckSizes(input.width, input.height, output.width, output.height);
+
+  int width = input.width;
+  int height = input.height;
+  // Only grows, frames of a stream usually all have the same size
+  buffers.resize(5 * (size_t)width * height);
+  double *image = buffers.data();
+
+#pragma omp parallel for schedule(static)
+  for (int i = 0; i < height; i++) {
+    const unsigned char *in = input.Row(i);
+    double *out = image + (size_t)i * width;
+    for (int j = 0; j < width; j++) {
+      out[j] = in[j];
+    }
+  }
+
+  // The image is not read anymore once the blur is done
+  Edges(ImageView<const double>(image, width, height), image, lowerThreshold,
+        upperThreshold, kernelSize, sigma, RangeCheck::Skip);
+
+#pragma omp parallel for schedule(static)
+  for (int i = 0; i < height; i++) {
+    const double *in = image + (size_t)i * width;
+    unsigned char *out = output.Row(i);
+    for (int j = 0; j < width; j++) {
+      out[j] = in[j] != 0.0 ? 255 : 0;
+    }
+  }
+}
+
+void CannyWorkspace::Detect(ImageView<const double> input,
+                            ImageView<double> output, int lowerThreshold,
+                            int upperThreshold, int kernelSize, double sigma,
+                            RangeCheck check) {
+  CheckSizes(input.width, input.height, output.width, output.height);
+
+  int width = input.width;
+  int height = input.height;
+  buffers.resize(5 * (size_t)width * height);
+
+  if (output.Continuous()) {
+    Edges(input, output.data, lowerThreshold, upperThreshold, kernelSize,
+          sigma, check);
+    return;
+  }
+
+  // Hysteresis needs continuous rows, padded outputs get a copy
+  double *edges = buffers.data();
+  Edges(input, edges, lowerThreshold, upperThreshold, kernelSize, sigma,
+        check);
+
+#pragma omp parallel for schedule(static)
+  for (int i = 0; i < height; i++) {
+    std::copy(edges + (size_t)i * width, edges + (size_t)(i + 1) * width,
+              output.Row(i));
+  }
+}
+
+void CannyWorkspace::Reserve(int width, int height) {
+  if (width > 0 && height > 0) {
+    buffers.resize(std::max(buffers.size(), 5 * (size_t)width * height));
+  }
+}
+
+void CannyWorkspace::Edges(ImageView<const double> image, double *edges,
+                           int lowerThreshold, int upperThreshold,
+                           int kernelSize, double sigma, RangeCheck check) {
+  int width = image.width;
+  int height = image.height;
+  int size = width * height;
+  double *blurred = buffers.data() + size;
+  double *gradient = blurred + size;
+  double *theta = gradient + size;
+  double *suppressed = theta + size;
+
+  // Suppression leaves the border alone
+#pragma omp parallel for schedule(static)
+  for (int i = 0; i < size; i++) {
+    suppressed[i] = 0.0;
+  }
+
+  // Gathers the rows of a strided input while padding it, and checks them
+  bool inRange = true;
+  GaussianFilter(image, blurred, kernelSize, sigma,
+                 check == RangeCheck::Validate ? &inRange : nullptr);
+  if (!inRange) {
+    ThrowPixelRangeError(image, "FastCanny");
+  }
+  Gradient(blurred, gradient, theta, width, height);
+  NonMaxSuppression(gradient, suppressed, theta, 3, width, height);
+  // The blurred buffer is free again
+  DoubleThreshold(suppressed, blurred, width, height, lowerThreshold,
+                  upperThreshold);
+  Hysteresis(blurred, edges, width, height, lowerThreshold, upperThreshold);
+}
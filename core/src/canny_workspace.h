@@ -0,0 +1,53 @@
+#pragma once
+
+#include "canny_pipeline.h"
+#include "image_view.h"
+#include <vector>
+
+/**
+ * @brief The FastCanny pipeline with its intermediate images kept from one
+ * frame to the next, for streams of frames that would otherwise allocate and
+ * free them every time.
+ *
+ * Input and output are views of the same size, so ROIs and pitched buffers
+ * are read and written in place. A workspace is not thread-safe, use one per
+ * thread.
+ */
+class CannyWorkspace {
+public:
+  /**
+   * @brief Edges of an 8-bit image as 255 for edges and 0 elsewhere, the same
+   * edges as FastCanny on the image. 8-bit pixels are always in [0, 255], so
+   * no range check is needed.
+   */
+  void Detect(ImageView<const unsigned char> input,
+              ImageView<unsigned char> output, int lowerThreshold,
+              int upperThreshold, int kernelSize, double sigma);
+
+  /**
+   * @brief FastCanny on an image with pixels in [0, 255]. Throws a
+   * PixelRangeError after the blur otherwise, unless `check` is Skip.
+   */
+  void Detect(ImageView<const double> input, ImageView<double> output,
+              int lowerThreshold, int upperThreshold, int kernelSize,
+              double sigma, RangeCheck check = RangeCheck::Validate);
+
+  /**
+   * @brief Allocate the buffers for `width` x `height` frames up front, so
+   * not even the first frame allocates
+   */
+  void Reserve(int width, int height);
+
+private:
+  /**
+   * @brief Blur to hysteresis from `image` into the continuous `edges`, using
+   * every buffer but the first, checking the range of the image on the way
+   * when `check` is Validate
+   */
+  void Edges(ImageView<const double> image, double *edges, int lowerThreshold,
+             int upperThreshold, int kernelSize, double sigma,
+             RangeCheck check);
+
+  // Image, blurred, gradient, theta and suppressed, one after the other
+  std::vector<double> buffers;
+};
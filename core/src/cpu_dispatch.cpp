@@ -0,0 +1,123 @@
+#include "cpu_dispatch.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+static void Cpuid(unsigned leaf, unsigned subleaf, unsigned regs[4]) {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuidex(info, (int)leaf, (int)subleaf);
+  for (int i = 0; i < 4; i++) {
+    regs[i] = (unsigned)info[i];
+  }
+#else
+  if (!__get_cpuid_count(leaf, subleaf, &regs[0], &regs[1], &regs[2],
+                         &regs[3])) {
+    regs[0] = regs[1] = regs[2] = regs[3] = 0;
+  }
+#endif
+}
+
+static unsigned long long Xgetbv() {
+#if defined(_MSC_VER)
+  return _xgetbv(0);
+#else
+  unsigned lo, hi;
+  asm volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+  return ((unsigned long long)hi << 32) | lo;
+#endif
+}
+
+IsaLevel DetectIsaLevel() {
+  unsigned leaf1[4], leaf7[4];
+  Cpuid(0, 0, leaf1);
+  unsigned maxLeaf = leaf1[0];
+
+  Cpuid(1, 0, leaf1);
+  bool osxsave = leaf1[2] & (1u << 27);
+  bool avx = leaf1[2] & (1u << 28);
+  bool fma = leaf1[2] & (1u << 12);
+
+  // The OS has to save the wide registers on context switch, otherwise the
+  // instructions are available but unusable
+  if (!osxsave || !avx || maxLeaf < 7) {
+    return IsaLevel::Scalar;
+  }
+  unsigned long long xcr0 = Xgetbv();
+  bool ymmState = (xcr0 & 0x6) == 0x6;
+  bool zmmState = (xcr0 & 0xe6) == 0xe6;
+
+  Cpuid(7, 0, leaf7);
+  bool avx2 = leaf7[1] & (1u << 5);
+  bool avx512f = leaf7[1] & (1u << 16);
+  bool avx512dq = leaf7[1] & (1u << 17);
+  bool avx512bw = leaf7[1] & (1u << 30);
+  bool avx512vl = leaf7[1] & (1u << 31);
+
+  if (!ymmState || !avx2 || !fma) {
+    return IsaLevel::Scalar;
+  }
+  if (zmmState && avx512f && avx512dq && avx512bw && avx512vl) {
+    return IsaLevel::AVX512;
+  }
+  return IsaLevel::AVX2;
+}
+
+static bool ParseIsaLevel(const char *name, IsaLevel *level) {
+  if (!strcmp(name, "scalar") || !strcmp(name, "sse") ||
+      !strcmp(name, "sse2")) {
+    *level = IsaLevel::Scalar;
+  } else if (!strcmp(name, "avx2")) {
+    *level = IsaLevel::AVX2;
+  } else if (!strcmp(name, "avx512")) {
+    *level = IsaLevel::AVX512;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+static IsaLevel SelectIsaLevel() {
+  IsaLevel detected = DetectIsaLevel();
+  const char *requested = std::getenv("FAST_CANNY_ISA");
+
+  if (requested == nullptr || requested[0] == '\0') {
+    return detected;
+  }
+
+  IsaLevel level;
+  if (!ParseIsaLevel(requested, &level)) {
+    std::cerr << "FastCanny: ignoring unknown FAST_CANNY_ISA=" << requested
+              << ", using " << IsaLevelName(detected) << "\n";
+    return detected;
+  }
+  if (level > detected) {
+    std::cerr << "FastCanny: FAST_CANNY_ISA=" << requested
+              << " is not supported on this CPU, using "
+              << IsaLevelName(detected) << "\n";
+    return detected;
+  }
+  return level;
+}
+
+IsaLevel ActiveIsaLevel() {
+  static const IsaLevel level = SelectIsaLevel();
+  return level;
+}
+
+const char *IsaLevelName(IsaLevel level) {
+  switch (level) {
+  case IsaLevel::AVX512:
+    return "avx512";
+  case IsaLevel::AVX2:
+    return "avx2";
+  default:
+    return "scalar";
+  }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+/**
+ * Each kernel is compiled once per ISA level in its own translation unit
+ * (e.g. gradient.cpp, gradient_avx2.cpp, gradient_avx512.cpp) and the public
+ * entry point picks one the first time it is called.
+ *
+ * The ISA translation units are built with -mavx2/-mavx512*, so they must only
+ * expose plain functions and keep their helpers static. Inline templates
+ * instantiated there (STL containers, etc.) could be merged by the linker with
+ * the baseline copies and leak wide instructions into the scalar path.
+ */
+enum class IsaLevel { Scalar = 0, AVX2 = 1, AVX512 = 2 };
+
+/**
+ * @brief Highest ISA level supported by both the CPU and the OS (cpuid/xgetbv)
+ */
+IsaLevel DetectIsaLevel();
+
+/**
+ * @brief ISA level the kernels dispatch to. This is the detected level, lowered
+ * by the FAST_CANNY_ISA environment variable (scalar, avx2 or avx512) when set.
+ * Computed once and cached for the lifetime of the process.
+ */
+IsaLevel ActiveIsaLevel();
+
+const char *IsaLevelName(IsaLevel level);
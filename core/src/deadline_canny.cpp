@@ -0,0 +1,133 @@
+#include "deadline_canny.h"
+#include "canny_pipeline.h"
+#include "double_threshold.h"
+#include "gaussian_filter.h"
+#include "gradient.h"
+#include "non_maxima_suppression.h"
+#include "padding.h"
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+// Weight of the newest measurement in the smoothed stage costs
+#define DEADLINE_COST_SMOOTHING 0.25
+// Flood fill steps between two looks at the clock
+#define DEADLINE_CHECK_INTERVAL 4096
+
+using DeadlineClock = std::chrono::steady_clock;
+
+static double ElapsedNs(DeadlineClock::time_point start) {
+  return std::chrono::duration<double, std::nano>(DeadlineClock::now() - start)
+      .count();
+}
+
+static void UpdateCost(double &cost, double elapsedNs, int pixels) {
+  double measured = elapsedNs / pixels;
+  cost = cost == 0 ? measured
+                   : cost + DEADLINE_COST_SMOOTHING * (measured - cost);
+}
+
+DeadlineCanny::DeadlineCanny(int lowerThreshold, int upperThreshold,
+                             int kernelSize, double sigma)
+    : lowerThreshold(lowerThreshold), upperThreshold(upperThreshold),
+      kernelSize(kernelSize), sigma(sigma) {}
+
+CannyDeadlineStatus DeadlineCanny::Detect(const double *input, int width,
+                                          int height, double budgetMs,
+                                          double *output) {
+  DeadlineClock::time_point start = DeadlineClock::now();
+  double budgetNs = budgetMs * 1e6;
+  int size = width * height;
+  unsigned degradations = CANNY_DEGRADE_NONE;
+
+  ImageView<const double> view(input, width, height);
+
+  blurred.resize(size);
+  gradient.resize(size);
+  theta.resize(size);
+
+  // Each stage runs in full only if the cheapest version of the stages
+  // after it still fits in the budget. An L1 gradient that was never timed
+  // is taken to cost as much as the full one.
+  double cheapestGradient = gradientL1Cost > 0 ? gradientL1Cost : gradientCost;
+  double mandatoryNs = suppressionCost * size;
+  double stageStart = ElapsedNs(start);
+  // The range check rides on the copy that pads the blur's input, or on a
+  // plain copy when the blur is skipped
+  bool inRange = true;
+  if (stageStart + (blurCost + cheapestGradient) * size + mandatoryNs <=
+      budgetNs) {
+    GaussianFilter(view, blurred.data(), kernelSize, sigma, &inRange);
+    UpdateCost(blurCost, ElapsedNs(start) - stageStart, size);
+  } else {
+    inRange = PadMatrixInRange(view, blurred.data(), 0);
+    degradations |= CANNY_DEGRADE_SKIPPED_BLUR;
+  }
+  if (!inRange) {
+    ThrowPixelRangeError(view, "DeadlineCanny");
+  }
+  const double *blurOutput = blurred.data();
+
+  stageStart = ElapsedNs(start);
+  if (stageStart + gradientCost * size + mandatoryNs <= budgetNs) {
+    Gradient(blurOutput, gradient.data(), theta.data(), width, height);
+    UpdateCost(gradientCost, ElapsedNs(start) - stageStart, size);
+  } else {
+    GradientL1(blurOutput, gradient.data(), theta.data(), width, height);
+    UpdateCost(gradientL1Cost, ElapsedNs(start) - stageStart, size);
+    degradations |= CANNY_DEGRADE_L1_GRADIENT;
+  }
+
+  // The blurred image is not needed anymore and holds the suppression output,
+  // whose border the kernel does not write
+  stageStart = ElapsedNs(start);
+  std::fill(blurred.begin(), blurred.end(), 0.0);
+  NonMaxSuppression(gradient.data(), blurred.data(), theta.data(), 3, width,
+                    height);
+  DoubleThreshold(blurred.data(), gradient.data(), width, height,
+                  lowerThreshold, upperThreshold);
+
+  // Strong edges first, then weak ones connected to them for as long as the
+  // budget allows
+  stack.clear();
+  for (int i = 0; i < size; i++) {
+    if (gradient[i] == upperThreshold) {
+      output[i] = upperThreshold;
+      stack.push_back(i);
+    } else {
+      output[i] = 0.0;
+    }
+  }
+  UpdateCost(suppressionCost, ElapsedNs(start) - stageStart, size);
+
+  if (ElapsedNs(start) >= budgetNs) {
+    degradations |= CANNY_DEGRADE_NO_HYSTERESIS;
+    stack.clear();
+  }
+
+  for (int steps = 1; !stack.empty(); steps++) {
+    if (steps % DEADLINE_CHECK_INTERVAL == 0 && ElapsedNs(start) >= budgetNs) {
+      degradations |= CANNY_DEGRADE_PARTIAL_HYSTERESIS;
+      break;
+    }
+
+    int idx = stack.back();
+    stack.pop_back();
+    int y = idx / width;
+    int x = idx % width;
+
+    for (int ny = std::max(0, y - 1); ny <= std::min(height - 1, y + 1); ny++) {
+      for (int nx = std::max(0, x - 1); nx <= std::min(width - 1, x + 1);
+           nx++) {
+        int nidx = ny * width + nx;
+        if (output[nidx] == 0.0 && gradient[nidx] == lowerThreshold) {
+          output[nidx] = upperThreshold;
+          stack.push_back(nidx);
+        }
+      }
+    }
+  }
+
+  double elapsedNs = ElapsedNs(start);
+  return {degradations, elapsedNs / 1e6, elapsedNs <= budgetNs};
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vector>
+
+// Degradations DeadlineCanny may apply, combined in CannyDeadlineStatus
+enum CannyDegradation : unsigned {
+  CANNY_DEGRADE_NONE = 0,
+  // The image went to the gradient without the Gaussian blur
+  CANNY_DEGRADE_SKIPPED_BLUR = 1 << 0,
+  // GradientL1 replaced Gradient
+  CANNY_DEGRADE_L1_GRADIENT = 1 << 1,
+  // Hysteresis stopped at the deadline, some weak edges were not followed
+  CANNY_DEGRADE_PARTIAL_HYSTERESIS = 1 << 2,
+  // No time was left for hysteresis, only strong edges are reported
+  CANNY_DEGRADE_NO_HYSTERESIS = 1 << 3,
+};
+
+/**
+ * @brief Outcome of one DeadlineCanny::Detect call
+ */
+struct CannyDeadlineStatus {
+  // CannyDegradation flags
+  unsigned degradations;
+  double elapsedMs;
+  // False when the stages that cannot be degraded alone overran the budget
+  bool deadlineMet;
+};
+
+/**
+ * @brief FastCanny with a time budget per image, for frames with a hard
+ * latency limit.
+ *
+ * Before each stage the time left is compared with what the stage cost on
+ * earlier images (per pixel, smoothed), and the stage falls back to a cheaper
+ * path when it would not fit: the blur is skipped, the gradient uses the L1
+ * magnitude, and hysteresis checks the clock as it goes and stops at the
+ * deadline. Suppression and thresholding always run. The first image has no
+ * history and runs in full, so the session should live as long as the stream.
+ */
+class DeadlineCanny {
+public:
+  DeadlineCanny(int lowerThreshold, int upperThreshold, int kernelSize,
+                double sigma);
+
+  /**
+   * @brief Detect the edges of `width * height` pixels in [0, 255] into
+   * `output`, with the same values as FastCanny, within `budgetMs`
+   * milliseconds if possible. Other pixels throw a PixelRangeError.
+   */
+  CannyDeadlineStatus Detect(const double *input, int width, int height,
+                             double budgetMs, double *output);
+
+private:
+  int lowerThreshold;
+  int upperThreshold;
+  int kernelSize;
+  double sigma;
+
+  // Smoothed cost of each stage in nanoseconds per pixel, 0 until measured
+  double blurCost = 0;
+  double gradientCost = 0;
+  double gradientL1Cost = 0;
+  double suppressionCost = 0;
+
+  std::vector<double> blurred;
+  std::vector<double> gradient;
+  std::vector<double> theta;
+  std::vector<int> stack;
+};
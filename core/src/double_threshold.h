@@ -6,4 +6,12 @@ void DoubleThresholdSlow(double *input, double *output, int width, int height,
 void DoubleThreshold(double *input, double *output, int width, int height,
                      double low_thres = 50, double high_thres = 100);
 
+// Per-ISA kernels behind DoubleThreshold(), see cpu_dispatch.h
+void DoubleThresholdScalar(double *input, double *output, int width,
+                           int height, double low_thres, double high_thres);
+void DoubleThresholdAVX2(double *input, double *output, int width, int height,
+                         double low_thres, double high_thres);
+void DoubleThresholdAVX512(double *input, double *output, int width,
+                           int height, double low_thres, double high_thres);
+
 #endif // DOUBLE_THRESHOLD_H
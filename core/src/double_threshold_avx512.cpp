@@ -0,0 +1,51 @@
+#include "double_threshold.h"
+#include <immintrin.h>
+
+static inline __m512d Classify(__m512d values, __m512d low_vals,
+                               __m512d high_vals) {
+  __mmask8 high_mask = _mm512_cmp_pd_mask(values, high_vals, _CMP_GE_OS);
+  __mmask8 low_mask =
+      _mm512_cmp_pd_mask(values, low_vals, _CMP_GE_OS) & ~high_mask;
+
+  __m512d result = _mm512_maskz_mov_pd(high_mask, high_vals);
+  return _mm512_mask_mov_pd(result, low_mask, low_vals);
+}
+
+/**
+ * @brief Classify pixels as strong/weak/non edges using AVX-512 compare masks,
+ * 32 at a time. The remainder is one masked block instead of a scalar loop.
+ */
+void DoubleThresholdAVX512(double *input, double *output, int width,
+                           int height, double low_thres, double high_thres) {
+  int size = width * height;
+  int blocks = size / 32;
+
+  const __m512d low_vals = _mm512_set1_pd(low_thres);
+  const __m512d high_vals = _mm512_set1_pd(high_thres);
+
+#pragma omp parallel for schedule(static)
+  for (int b = 0; b < blocks; b++) {
+    int i = b * 32;
+    __m512d result_0 =
+        Classify(_mm512_loadu_pd(&input[i]), low_vals, high_vals);
+    __m512d result_1 =
+        Classify(_mm512_loadu_pd(&input[i + 8]), low_vals, high_vals);
+    __m512d result_2 =
+        Classify(_mm512_loadu_pd(&input[i + 16]), low_vals, high_vals);
+    __m512d result_3 =
+        Classify(_mm512_loadu_pd(&input[i + 24]), low_vals, high_vals);
+
+    _mm512_storeu_pd(&output[i], result_0);
+    _mm512_storeu_pd(&output[i + 8], result_1);
+    _mm512_storeu_pd(&output[i + 16], result_2);
+    _mm512_storeu_pd(&output[i + 24], result_3);
+  }
+
+  for (int i = blocks * 32; i < size; i += 8) {
+    __mmask8 lanes = size - i >= 8 ? (__mmask8)0xFF
+                                   : (__mmask8)((1u << (size - i)) - 1);
+    __m512d result = Classify(_mm512_maskz_loadu_pd(lanes, &input[i]),
+                              low_vals, high_vals);
+    _mm512_mask_storeu_pd(&output[i], lanes, result);
+  }
+}
@@ -4,58 +4,331 @@
 #include "gradient.h"
 #include "hysteresis.h"
 #include "non_maxima_suppression.h"
+#include "pyramid_canny.h"
 #include "opencv2/core/mat.hpp"
+#include "suppressed_region.h"
+#include "threshold_sweep.h"
+#include <algorithm>
 #include <iostream>
 #include <memory>
+#include <string>
+#include <vector>
 
 std::shared_ptr<cv::Mat> FastCanny(const cv::Mat &input, int lowerThreshold,
                                    int upperThreshold, int kernelSize,
-                                   double sigma) {
+                                   double sigma, RangeCheck check) {
+  std::shared_ptr<cv::Mat> output =
+      std::make_shared<cv::Mat>(input.rows, input.cols, CV_64F);
+  FastCanny(input, *output, lowerThreshold, upperThreshold, kernelSize, sigma,
+            check);
+  return output;
+}
+
+/**
+ * @brief View of a CV_64F image, which may be a ROI with padded rows
+ */
+static ImageView<const double> InputView(const cv::Mat &input,
+                                         const std::string &caller) {
+  if (!input.empty() && input.type() != CV_64F) {
+    throw std::runtime_error(caller + " failed: input image must be CV_64F");
+  }
+  return ImageView<const double>(input.ptr<double>(), input.cols, input.rows,
+                                 input.step1());
+}
+
+void FastCanny(const cv::Mat &input, cv::Mat &output, int lowerThreshold,
+               int upperThreshold, int kernelSize, double sigma,
+               RangeCheck check) {
+  ImageView<const double> view = InputView(input, "FastCanny");
+  // Keeps the buffer, and a view its parent, when the size already matches
+  output.create(input.rows, input.cols, CV_64F);
+  FastCanny(view,
+            ImageView<double>(output.ptr<double>(), output.cols, output.rows,
+                              output.step1()),
+            lowerThreshold, upperThreshold, kernelSize, sigma, check);
+}
+
+PooledEdges FastCanny(const cv::Mat &input, CannyBufferPool &pool,
+                      int lowerThreshold, int upperThreshold, int kernelSize,
+                      double sigma, RangeCheck check) {
+  PooledEdges edges = pool.Acquire(input.rows, input.cols);
+  FastCanny(input, edges.Mat(), lowerThreshold, upperThreshold, kernelSize,
+            sigma, check);
+  return edges;
+}
+
+std::vector<std::shared_ptr<cv::Mat>>
+FastCannyROI(const cv::Mat &input, const std::vector<cv::Rect> &rects,
+             int lowerThreshold, int upperThreshold, int kernelSize,
+             double sigma) {
+  if (input.type() != CV_64F) {
+    throw std::runtime_error("FastCannyROI failed: input image must be CV_64F");
+  }
 
-  for (int i = 0; i < input.rows * input.cols; i++) {
-    if (input.at<double>(i) < 0 || input.at<double>(i) > 255) {
-      throw std::runtime_error("FastCanny failed: input image must have pixel "
-                               "values in the range [0, 255]");
+  cv::Rect bounds(0, 0, input.cols, input.rows);
+  std::vector<std::shared_ptr<cv::Mat>> outputs(rects.size());
+  for (size_t i = 0; i < rects.size(); i++) {
+    if ((rects[i] & bounds) != rects[i]) {
+      throw std::runtime_error("FastCannyROI failed: rectangle outside of the "
+                               "image");
     }
+    outputs[i] = std::make_shared<cv::Mat>(rects[i].height, rects[i].width,
+                                           CV_64F);
   }
 
-  double *blurredImage = new double[input.rows * input.cols];
-  GaussianFilter(input.ptr<double>(), blurredImage, kernelSize, input.cols,
-                 input.rows, sigma);
+  // Rows of the input may be padded when it is itself a view of a larger Mat
+  size_t stride = input.step1();
+  // First rectangle with a pixel out of range, if any
+  size_t outOfRange = rects.size();
 
-  // Apply Sobel filter
+  // A single rectangle is better served by the kernels' own parallel loops
+#pragma omp parallel if (rects.size() > 1) reduction(min : outOfRange)
+  {
+    std::vector<double> scratch;
+    std::vector<double> suppressed;
+    std::vector<double> thresholded;
 
-  double *gradientOutput = new double[input.rows * input.cols];
-  double *thetaOutput = new double[input.rows * input.cols];
+#pragma omp for schedule(dynamic)
+    for (size_t i = 0; i < rects.size(); i++) {
+      const cv::Rect &rect = rects[i];
+      if (rect.empty()) {
+        continue;
+      }
 
-  Gradient(blurredImage, gradientOutput, thetaOutput, input.cols, input.rows);
+      size_t size = (size_t)rect.width * rect.height;
+      suppressed.resize(size);
+      thresholded.resize(size);
 
-  // Apply non-maximum suppression
+      if (!SuppressedGradientRegion(input.ptr<double>(), input.cols,
+                                    input.rows, stride, rect.x, rect.y,
+                                    rect.x + rect.width, rect.y + rect.height,
+                                    kernelSize, sigma, scratch,
+                                    suppressed.data())) {
+        outOfRange = std::min(outOfRange, i);
+        continue;
+      }
 
-  double *nonMaxSuppressionOutput = new double[input.rows * input.cols];
-  NonMaxSuppression(gradientOutput, nonMaxSuppressionOutput, thetaOutput, 3,
-                    input.cols, input.rows);
+      DoubleThreshold(suppressed.data(), thresholded.data(), rect.width,
+                      rect.height, lowerThreshold, upperThreshold);
+      Hysteresis(thresholded.data(), outputs[i]->ptr<double>(), rect.width,
+                 rect.height, lowerThreshold, upperThreshold);
+    }
+  }
 
-  // Apply hysteresis thresholding
+  if (outOfRange < rects.size()) {
+    const cv::Rect &rect = rects[outOfRange];
+    ThrowRegionRangeError(input.ptr<double>(), input.cols, input.rows, stride,
+                          rect.x, rect.y, rect.x + rect.width,
+                          rect.y + rect.height, kernelSize, "FastCannyROI");
+  }
 
-  double *doubleThresholdOutput = new double[input.rows * input.cols];
-  DoubleThreshold(nonMaxSuppressionOutput, doubleThresholdOutput, input.cols,
-                  input.rows, lowerThreshold, upperThreshold);
+  return outputs;
+}
+
+std::shared_ptr<cv::Mat> FastCanny(const cv::Mat &input, const CannyMask &mask,
+                                   int lowerThreshold, int upperThreshold,
+                                   int kernelSize, double sigma) {
+  if (input.type() != CV_64F || input.cols != mask.Width() ||
+      input.rows != mask.Height()) {
+    throw std::runtime_error("FastCanny failed: input image must be CV_64F "
+                             "and the size of the mask");
+  }
+
+  std::shared_ptr<cv::Mat> output =
+      std::make_shared<cv::Mat>(input.rows, input.cols, CV_64F);
+  MaskedCanny(input.ptr<double>(), input.step1(), mask, lowerThreshold,
+              upperThreshold, kernelSize, sigma, output->ptr<double>());
 
-  double *hysteresisOutput = new double[input.rows * input.cols];
-  Hysteresis(doubleThresholdOutput, hysteresisOutput, input.cols, input.rows,
-             lowerThreshold, upperThreshold);
+  return output;
+}
+
+std::shared_ptr<cv::Mat> FastCanny(const cv::Mat &input, ThresholdMethod method,
+                                   int kernelSize, double sigma,
+                                   int *lowerThreshold, int *upperThreshold) {
+  ImageView<const double> view = InputView(input, "FastCanny");
 
-  // Copy the output to the output image
+  int size = input.rows * input.cols;
+  std::vector<double> blurredImage(size);
+  std::vector<double> gradientOutput(size);
+  std::vector<double> thetaOutput(size);
+  std::vector<unsigned int> histogram(GRADIENT_HISTOGRAM_BINS, 0);
+
+  // The blur checks the range of the pixels as it pads them
+  bool inRange = true;
+  GaussianFilter(view, blurredImage.data(), kernelSize, sigma, &inRange);
+  if (!inRange) {
+    ThrowPixelRangeError(view, "FastCanny");
+  }
+  Gradient(blurredImage.data(), gradientOutput.data(), thetaOutput.data(),
+           input.cols, input.rows, histogram.data());
+
+  CannyThresholds thresholds = SelectThresholds(histogram.data(), method);
+  if (lowerThreshold != nullptr) {
+    *lowerThreshold = thresholds.lower;
+  }
+  if (upperThreshold != nullptr) {
+    *upperThreshold = thresholds.upper;
+  }
 
-  std::shared_ptr<cv::Mat> output = std::make_shared<cv::Mat>(
-      input.rows, input.cols, CV_64F, hysteresisOutput);
+  // The blurred image is not needed anymore and holds the suppression output,
+  // whose border the kernel does not write
+  std::fill(blurredImage.begin(), blurredImage.end(), 0.0);
+  NonMaxSuppression(gradientOutput.data(), blurredImage.data(),
+                    thetaOutput.data(), 3, input.cols, input.rows);
+  DoubleThreshold(blurredImage.data(), gradientOutput.data(), input.cols,
+                  input.rows, thresholds.lower, thresholds.upper);
 
-  delete[] blurredImage;
-  delete[] gradientOutput;
-  delete[] thetaOutput;
-  delete[] nonMaxSuppressionOutput;
-  delete[] doubleThresholdOutput;
+  std::shared_ptr<cv::Mat> output =
+      std::make_shared<cv::Mat>(input.rows, input.cols, CV_64F);
+  Hysteresis(gradientOutput.data(), output->ptr<double>(), input.cols,
+             input.rows, thresholds.lower, thresholds.upper);
 
   return output;
-};
+}
+
+std::vector<std::shared_ptr<cv::Mat>>
+FastCannySweep(const cv::Mat &input,
+               const std::vector<std::pair<int, int>> &thresholds,
+               int kernelSize, double sigma) {
+  ImageView<const double> view = InputView(input, "FastCannySweep");
+
+  int size = input.rows * input.cols;
+  std::vector<double> blurredImage(size);
+  std::vector<double> gradientOutput(size);
+  std::vector<double> thetaOutput(size);
+
+  bool inRange = true;
+  GaussianFilter(view, blurredImage.data(), kernelSize, sigma, &inRange);
+  if (!inRange) {
+    ThrowPixelRangeError(view, "FastCannySweep");
+  }
+  Gradient(blurredImage.data(), gradientOutput.data(), thetaOutput.data(),
+           input.cols, input.rows);
+
+  // The blurred image is reused for the suppression output, whose border the
+  // kernel does not write
+  std::fill(blurredImage.begin(), blurredImage.end(), 0.0);
+  NonMaxSuppression(gradientOutput.data(), blurredImage.data(),
+                    thetaOutput.data(), 3, input.cols, input.rows);
+
+  // Only pixels above the lowest threshold in use go into the tree
+  int minLowerThreshold = 0;
+  if (!thresholds.empty()) {
+    minLowerThreshold = std::min(thresholds[0].first, thresholds[0].second);
+  }
+  for (const auto &pair : thresholds) {
+    minLowerThreshold =
+        std::min(minLowerThreshold, std::min(pair.first, pair.second));
+  }
+  ThresholdSweep sweep(blurredImage.data(), input.cols, input.rows,
+                       minLowerThreshold);
+
+  std::vector<std::shared_ptr<cv::Mat>> outputs(thresholds.size());
+  for (size_t i = 0; i < thresholds.size(); i++) {
+    outputs[i] = std::make_shared<cv::Mat>(input.rows, input.cols, CV_64F);
+  }
+
+#pragma omp parallel for schedule(dynamic)
+  for (size_t i = 0; i < thresholds.size(); i++) {
+    sweep.Edges(thresholds[i].first, thresholds[i].second,
+                outputs[i]->ptr<double>());
+  }
+
+  return outputs;
+}
+
+std::shared_ptr<cv::Mat> FastCannyBGR(const cv::Mat &input, int lowerThreshold,
+                                      int upperThreshold, int kernelSize,
+                                      double sigma) {
+  if (input.type() != CV_8UC3) {
+    throw std::runtime_error("FastCannyBGR failed: input image must be "
+                             "CV_8UC3");
+  }
+
+  // 8-bit pixels are always in range, so there is nothing to validate
+  int size = input.rows * input.cols;
+  std::vector<double> blurredImage(size);
+  std::vector<double> gradientOutput(size);
+  std::vector<double> thetaOutput(size);
+
+  GaussianFilterBGR(input.ptr<unsigned char>(), input.step1(),
+                    blurredImage.data(), kernelSize, input.cols, input.rows,
+                    sigma);
+  Gradient(blurredImage.data(), gradientOutput.data(), thetaOutput.data(),
+           input.cols, input.rows);
+
+  // The blurred image is reused for the suppression output, whose border the
+  // kernel does not write
+  std::fill(blurredImage.begin(), blurredImage.end(), 0.0);
+  NonMaxSuppression(gradientOutput.data(), blurredImage.data(),
+                    thetaOutput.data(), 3, input.cols, input.rows);
+  DoubleThreshold(blurredImage.data(), gradientOutput.data(), input.cols,
+                  input.rows, lowerThreshold, upperThreshold);
+
+  std::shared_ptr<cv::Mat> output =
+      std::make_shared<cv::Mat>(input.rows, input.cols, CV_64F);
+  Hysteresis(gradientOutput.data(), output->ptr<double>(), input.cols,
+             input.rows, lowerThreshold, upperThreshold);
+
+  return output;
+}
+
+std::vector<std::shared_ptr<cv::Mat>>
+FastCannyPyramid(const cv::Mat &input, int levelCount, int lowerThreshold,
+                 int upperThreshold, int kernelSize, double sigma,
+                 int searchRadius) {
+  if (input.type() != CV_64F || input.step1() != (size_t)input.cols) {
+    throw std::runtime_error("FastCannyPyramid failed: input image must be a "
+                             "continuous CV_64F image");
+  }
+
+  std::vector<PyramidLevel> levels;
+  PyramidCanny(input.ptr<double>(), input.cols, input.rows, levelCount,
+               lowerThreshold, upperThreshold, kernelSize, sigma, searchRadius,
+               levels);
+
+  std::vector<std::shared_ptr<cv::Mat>> outputs(levels.size());
+  for (size_t l = 0; l < levels.size(); l++) {
+    outputs[l] = std::make_shared<cv::Mat>(levels[l].height, levels[l].width,
+                                           CV_64F);
+    std::copy(levels[l].edges.begin(), levels[l].edges.end(),
+              outputs[l]->ptr<double>());
+  }
+
+  return outputs;
+}
+
+std::future<std::shared_ptr<cv::Mat>>
+FastCannyAsync(const cv::Mat &input, int lowerThreshold, int upperThreshold,
+               int kernelSize, double sigma, CannyExecutor &executor) {
+  // std::function needs a copyable job, so the promise is shared
+  auto promise = std::make_shared<std::promise<std::shared_ptr<cv::Mat>>>();
+  std::future<std::shared_ptr<cv::Mat>> result = promise->get_future();
+
+  executor.Submit([=] {
+    try {
+      promise->set_value(FastCanny(input, lowerThreshold, upperThreshold,
+                                   kernelSize, sigma));
+    } catch (...) {
+      promise->set_exception(std::current_exception());
+    }
+  });
+
+  return result;
+}
+
+void FastCannyAsync(const cv::Mat &input, int lowerThreshold,
+                    int upperThreshold, int kernelSize, double sigma,
+                    FastCannyCallback done, CannyExecutor &executor) {
+  executor.Submit([=] {
+    std::shared_ptr<cv::Mat> edges;
+    std::exception_ptr error;
+    try {
+      edges = FastCanny(input, lowerThreshold, upperThreshold, kernelSize,
+                        sigma);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    done(edges, error);
+  });
+}
@@ -1,6 +1,131 @@
 
+#include "auto_threshold.h"
+#include "canny_buffer_pool.h"
+#include "canny_executor.h"
+#include "canny_mask.h"
+#include "canny_pipeline.h"
 #include "opencv2/opencv.hpp"
+#include <exception>
+#include <functional>
+#include <future>
 
+// The cv::Mat entry points, built as core_opencv. The pipeline itself needs
+// no OpenCV, see canny_pipeline.h.
+
+/**
+ * @brief FastCanny on a CV_64F image with pixels in [0, 255]. Throws a
+ * PixelRangeError naming the first pixel outside the range, see RangeCheck
+ * in canny_pipeline.h for skipping the check.
+ */
 std::shared_ptr<cv::Mat> FastCanny(const cv::Mat &input, int lowerThreshold,
                                    int upperThreshold, int kernelSize,
-                                   double sigma);
+                                   double sigma,
+                                   RangeCheck check = RangeCheck::Validate);
+
+/**
+ * @brief FastCanny writing into `output`, which is created as a CV_64F image
+ * of the input's size unless it already is one, so a view into a larger
+ * image is filled in place. The input may be a view as well. The
+ * intermediate images are kept per calling thread, so repeated calls on one
+ * size do not allocate.
+ */
+void FastCanny(const cv::Mat &input, cv::Mat &output, int lowerThreshold,
+               int upperThreshold, int kernelSize, double sigma,
+               RangeCheck check = RangeCheck::Validate);
+
+/**
+ * @brief FastCanny into a buffer of `pool`, which gets it back when the
+ * result is released, see canny_buffer_pool.h
+ */
+PooledEdges FastCanny(const cv::Mat &input, CannyBufferPool &pool,
+                      int lowerThreshold, int upperThreshold, int kernelSize,
+                      double sigma, RangeCheck check = RangeCheck::Validate);
+
+/**
+ * @brief Canny edges inside each rectangle of a CV_64F image, without copying
+ * the frame. Blur, gradient and suppression read the real pixels around each
+ * rectangle, so edges match FastCanny on the whole image; hysteresis only
+ * follows weak edges within the rectangle. Rectangles are processed in
+ * parallel and must lie inside the image.
+ */
+std::vector<std::shared_ptr<cv::Mat>>
+FastCannyROI(const cv::Mat &input, const std::vector<cv::Rect> &rects,
+             int lowerThreshold, int upperThreshold, int kernelSize,
+             double sigma);
+
+/**
+ * @brief FastCanny restricted to the pixels selected by a precomputed mask of
+ * the same size, see canny_mask.h. Pixels outside the mask are 0.
+ */
+std::shared_ptr<cv::Mat> FastCanny(const cv::Mat &input, const CannyMask &mask,
+                                   int lowerThreshold, int upperThreshold,
+                                   int kernelSize, double sigma);
+
+/**
+ * @brief FastCanny with thresholds derived from the gradient magnitude
+ * histogram, which the gradient stage builds as it goes, so adapting to the
+ * image costs no extra pass. The chosen thresholds are returned through
+ * `lowerThreshold`/`upperThreshold` when not null; edges are set to the upper
+ * one.
+ */
+std::shared_ptr<cv::Mat> FastCanny(const cv::Mat &input, ThresholdMethod method,
+                                   int kernelSize, double sigma,
+                                   int *lowerThreshold = nullptr,
+                                   int *upperThreshold = nullptr);
+
+/**
+ * @brief FastCanny for many (lower, upper) threshold pairs at once. Blur,
+ * gradient and suppression run once and every pair is derived from a single
+ * component tree, see threshold_sweep.h. Returns one edge map per pair.
+ */
+std::vector<std::shared_ptr<cv::Mat>>
+FastCannySweep(const cv::Mat &input,
+               const std::vector<std::pair<int, int>> &thresholds,
+               int kernelSize, double sigma);
+
+/**
+ * @brief FastCanny on an interleaved 8-bit BGR image (CV_8UC3), as delivered
+ * by color cameras and cv::imread. The grayscale conversion is fused into the
+ * padding of the first blur, so neither a gray nor a double copy of the image
+ * is made; edges match FastCanny on cv::cvtColor(COLOR_BGR2GRAY).
+ */
+std::shared_ptr<cv::Mat> FastCannyBGR(const cv::Mat &input, int lowerThreshold,
+                                      int upperThreshold, int kernelSize,
+                                      double sigma);
+
+/**
+ * @brief FastCanny on `levelCount` pyramid levels of the image, level 0 first
+ * at full resolution and each next one half the size, see pyramid_canny.h.
+ * All levels run in one parallel schedule. With `searchRadius` >= 0, edges
+ * are only looked for within that many pixels of the edges of the next
+ * coarser level.
+ */
+std::vector<std::shared_ptr<cv::Mat>>
+FastCannyPyramid(const cv::Mat &input, int levelCount, int lowerThreshold,
+                 int upperThreshold, int kernelSize, double sigma,
+                 int searchRadius = -1);
+
+/**
+ * @brief FastCanny run by `executor`, returning at once. The image shares its
+ * pixels with `input`, which must not be modified until the result is ready.
+ * Blocks only while the executor's queue is full.
+ */
+std::future<std::shared_ptr<cv::Mat>>
+FastCannyAsync(const cv::Mat &input, int lowerThreshold, int upperThreshold,
+               int kernelSize, double sigma,
+               CannyExecutor &executor = DefaultCannyExecutor());
+
+/**
+ * @brief Completion callback of FastCannyAsync, called on an executor thread
+ * with the edges, or with a null result and the exception FastCanny threw
+ */
+using FastCannyCallback =
+    std::function<void(std::shared_ptr<cv::Mat>, std::exception_ptr)>;
+
+/**
+ * @brief FastCannyAsync reporting through `done` instead of a future
+ */
+void FastCannyAsync(const cv::Mat &input, int lowerThreshold,
+                    int upperThreshold, int kernelSize, double sigma,
+                    FastCannyCallback done,
+                    CannyExecutor &executor = DefaultCannyExecutor());
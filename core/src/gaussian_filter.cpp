@@ -1,158 +1,207 @@
 #include "gaussian_filter.h"
+#include "cpu_dispatch.h"
 #include "padding.h"
 #include <cassert>
 #include <cmath>
 #include <cstring>
-#include <immintrin.h>
 #include <omp.h>
 
+using GaussianFilterFn = void (*)(const double *, double *, int, int, int,
+                                  double);
+
+static GaussianFilterFn SelectGaussianFilter() {
+  switch (ActiveIsaLevel()) {
+  case IsaLevel::AVX512:
+    return GaussianFilterAVX512;
+  case IsaLevel::AVX2:
+    return GaussianFilterAVX2;
+  default:
+    return GaussianFilterScalar;
+  }
+}
+
+static GaussianFilterFn SelectGaussianFilterPadded() {
+  switch (ActiveIsaLevel()) {
+  case IsaLevel::AVX512:
+    return GaussianFilterPaddedAVX512;
+  case IsaLevel::AVX2:
+    return GaussianFilterPaddedAVX2;
+  default:
+    return GaussianFilterPaddedScalar;
+  }
+}
+
 /**
- * @brief Apply a Gaussian filter to an image using SIMD
+ * @brief Apply a Gaussian filter to an image using the widest kernel the CPU
+ * supports
  */
 void GaussianFilter(const double *input, double *output, int kernalSize,
                     int width, int height, double sigma) {
+  static const GaussianFilterFn impl = SelectGaussianFilter();
+  impl(input, output, kernalSize, width, height, sigma);
+}
+
+/**
+ * @brief Apply a Gaussian filter to an image with rows `input.stride` apart,
+ * writing a continuous output. The rows are gathered by the zero padding the
+ * filter starts with, so a strided view costs no extra copy. With `inRange`,
+ * the padding also checks every pixel is in [0, 255] and stores the answer
+ * there; the output is not written when one is not.
+ */
+void GaussianFilter(ImageView<const double> input, double *output,
+                    int kernalSize, double sigma, bool *inRange) {
+  static const GaussianFilterFn impl = SelectGaussianFilterPadded();
+  int width = input.width;
+  int height = input.height;
+  int halfSize = kernalSize / 2;
+  double *paddedInput =
+      new double[(width + 2 * halfSize) * (height + 2 * halfSize)];
+  if (inRange != nullptr) {
+    *inRange = PadMatrixInRange(input, paddedInput, halfSize);
+  } else {
+    PadMatrix(input, paddedInput, halfSize, 0);
+  }
+
+  // The caller rejects such an image, the blur would be wasted
+  if (inRange != nullptr && !*inRange) {
+    delete[] paddedInput;
+    return;
+  }
+
+  impl(paddedInput, output, kernalSize, width, height, sigma);
+
+  delete[] paddedInput;
+}
+
+/**
+ * @brief Apply a Gaussian filter to an interleaved 8-bit BGR image, `stride`
+ * bytes per row. The grayscale conversion is fused into the zero padding the
+ * filter starts with, so no gray plane is ever stored.
+ */
+void GaussianFilterBGR(const unsigned char *bgr, size_t stride, double *output,
+                       int kernalSize, int width, int height, double sigma) {
+  static const GaussianFilterFn impl = SelectGaussianFilterPadded();
+  int halfSize = kernalSize / 2;
+  double *paddedInput =
+      new double[(width + 2 * halfSize) * (height + 2 * halfSize)];
+  PadBGRToGray(bgr, stride, paddedInput, width, height, halfSize);
 
-  // Assuming width and height are power of 2
-  assert(width > 0 && (width & (width - 1)) == 0);
-  assert(height > 0 && (height & (height - 1)) == 0);
+  impl(paddedInput, output, kernalSize, width, height, sigma);
 
+  delete[] paddedInput;
+}
+
+/**
+ * @brief Blur an image and keep every other row and column, like cv::pyrDown.
+ * Only the kept pixels are computed. `output` is (width + 1) / 2 by
+ * (height + 1) / 2, pixel (x, y) is the blur centered on input (2x, 2y).
+ */
+void GaussianDownsample(const double *input, double *output, int kernalSize,
+                        int width, int height, double sigma) {
+  // AVX-512 CPUs run the AVX2 kernel, which is bound by the strided loads
+  static const GaussianFilterFn impl = ActiveIsaLevel() >= IsaLevel::AVX2
+                                           ? GaussianDownsampleAVX2
+                                           : GaussianDownsampleScalar;
+  impl(input, output, kernalSize, width, height, sigma);
+}
+
+/**
+ * @brief Decimating Gaussian filter without intrinsics, see
+ * GaussianDownsample()
+ */
+void GaussianDownsampleScalar(const double *input, double *output,
+                              int kernalSize, int width, int height,
+                              double sigma) {
   int halfSize = kernalSize / 2;
+  int paddedWidth = width + 2 * halfSize;
+  int outputWidth = (width + 1) / 2;
+  int outputHeight = (height + 1) / 2;
   double *kernel = new double[kernalSize * kernalSize];
 
-  // TODO: We can try SIMD here
   GenerateGaussianKernel(kernel, kernalSize, kernalSize, sigma);
 
   double *paddedInput =
       new double[(width + 2 * halfSize) * (height + 2 * halfSize)];
-  // Add 0 padding to the input matrix
   PadMatrix(input, paddedInput, width, height, halfSize, 0);
 
-  int paddedWidth = width + 2 * halfSize;
-  int paddedHeight = height + 2 * halfSize;
-
-  __m256d sum1, sum2, sum3, sum4, sum5, sum6, sum7, sum8, sum9, sum10;
-  __m256d pixels1, pixels2, pixels3, pixels4, pixels5, pixels6;
+#pragma omp parallel for schedule(static)
+  for (int i = 0; i < outputHeight; i++) {
+    double *outRow = &output[i * outputWidth];
 
-  __m256d kernelValue = _mm256_setzero_pd();
+    for (int j = 0; j < outputWidth; j++) {
+      outRow[j] = 0.0;
+    }
 
-// TODO: Consider cache aware optimization
-// There are 2 FMA units in ECE06 and the latency is 10
-// We need to have at least 10 FMA to max the performance
-// SO we are processing 10 * 4 elements each time
-#pragma omp parallel for schedule(static)
-  for (int idx = 0; idx <= width * height - 40; idx += 40) {
-    sum1 = _mm256_setzero_pd();
-    sum2 = _mm256_setzero_pd();
-    sum3 = _mm256_setzero_pd();
-    sum4 = _mm256_setzero_pd();
-    sum5 = _mm256_setzero_pd();
-    sum6 = _mm256_setzero_pd();
-    sum7 = _mm256_setzero_pd();
-    sum8 = _mm256_setzero_pd();
-    sum9 = _mm256_setzero_pd();
-    sum10 = _mm256_setzero_pd();
-
-    pixels1 = _mm256_setzero_pd();
-    pixels2 = _mm256_setzero_pd();
-    pixels3 = _mm256_setzero_pd();
-    pixels4 = _mm256_setzero_pd();
-    pixels5 = _mm256_setzero_pd();
-
-    for (int k = -halfSize; k <= halfSize; k++) {
-      for (int l = -halfSize; l <= halfSize; l++) {
-        kernelValue = _mm256_set1_pd(
-            kernel[(k + halfSize) * kernalSize + (l + halfSize)]);
-
-        pixels1 = _mm256_loadu_pd(
-            &paddedInput[((idx) / width + halfSize + k) * paddedWidth +
-                         ((idx) % width + halfSize + l)]);
-        pixels2 = _mm256_loadu_pd(
-            &paddedInput[((idx + 4) / width + halfSize + k) * paddedWidth +
-                         ((idx + 4) % width + halfSize + l)]);
-        pixels3 = _mm256_loadu_pd(
-            &paddedInput[((idx + 8) / width + halfSize + k) * paddedWidth +
-                         ((idx + 8) % width + halfSize + l)]);
-        pixels4 = _mm256_loadu_pd(
-            &paddedInput[((idx + 12) / width + halfSize + k) * paddedWidth +
-                         ((idx + 12) % width + halfSize + l)]);
-        pixels5 = _mm256_loadu_pd(
-            &paddedInput[((idx + 16) / width + halfSize + k) * paddedWidth +
-                         ((idx + 16) % width + halfSize + l)]);
-        sum1 = _mm256_fmadd_pd(pixels1, kernelValue, sum1);
-        sum2 = _mm256_fmadd_pd(pixels2, kernelValue, sum2);
-        sum3 = _mm256_fmadd_pd(pixels3, kernelValue, sum3);
-        sum4 = _mm256_fmadd_pd(pixels4, kernelValue, sum4);
-        sum5 = _mm256_fmadd_pd(pixels5, kernelValue, sum5);
-
-        pixels1 = _mm256_loadu_pd(
-            &paddedInput[((idx + 20) / width + halfSize + k) * paddedWidth +
-                         ((idx + 20) % width + halfSize + l)]);
-        pixels2 = _mm256_loadu_pd(
-            &paddedInput[((idx + 24) / width + halfSize + k) * paddedWidth +
-                         ((idx + 24) % width + halfSize + l)]);
-        pixels3 = _mm256_loadu_pd(
-            &paddedInput[((idx + 28) / width + halfSize + k) * paddedWidth +
-                         ((idx + 28) % width + halfSize + l)]);
-        pixels4 = _mm256_loadu_pd(
-            &paddedInput[((idx + 32) / width + halfSize + k) * paddedWidth +
-                         ((idx + 32) % width + halfSize + l)]);
-        pixels5 = _mm256_loadu_pd(
-            &paddedInput[((idx + 36) / width + halfSize + k) * paddedWidth +
-                         ((idx + 36) % width + halfSize + l)]);
-
-        sum6 = _mm256_fmadd_pd(pixels1, kernelValue, sum6);
-        sum7 = _mm256_fmadd_pd(pixels2, kernelValue, sum7);
-        sum8 = _mm256_fmadd_pd(pixels3, kernelValue, sum8);
-        sum9 = _mm256_fmadd_pd(pixels4, kernelValue, sum9);
-        sum10 = _mm256_fmadd_pd(pixels5, kernelValue, sum10);
+    for (int k = 0; k < kernalSize; k++) {
+      const double *inRow = &paddedInput[(2 * i + k) * paddedWidth];
+      for (int l = 0; l < kernalSize; l++) {
+        double kernelValue = kernel[k * kernalSize + l];
+        for (int j = 0; j < outputWidth; j++) {
+          outRow[j] += inRow[2 * j + l] * kernelValue;
+        }
       }
     }
-
-    _mm256_storeu_pd(&output[((idx) / width) * width + ((idx) % width)], sum1);
-    _mm256_storeu_pd(&output[((idx + 4) / width) * width + ((idx + 4) % width)],
-                     sum2);
-    _mm256_storeu_pd(&output[((idx + 8) / width) * width + ((idx + 8) % width)],
-                     sum3);
-    _mm256_storeu_pd(
-        &output[((idx + 12) / width) * width + ((idx + 12) % width)], sum4);
-    _mm256_storeu_pd(
-        &output[((idx + 16) / width) * width + ((idx + 16) % width)], sum5);
-    _mm256_storeu_pd(
-        &output[((idx + 20) / width) * width + ((idx + 20) % width)], sum6);
-    _mm256_storeu_pd(
-        &output[((idx + 24) / width) * width + ((idx + 24) % width)], sum7);
-    _mm256_storeu_pd(
-        &output[((idx + 28) / width) * width + ((idx + 28) % width)], sum8);
-    _mm256_storeu_pd(
-        &output[((idx + 32) / width) * width + ((idx + 32) % width)], sum9);
-    _mm256_storeu_pd(
-        &output[((idx + 36) / width) * width + ((idx + 36) % width)], sum10);
   }
 
-  // process the rest of the matrix
-#pragma omp parallel for schedule(static)
-  for (int idx = (width * height / 40) * 40; idx < width * height; idx += 4) {
-    sum1 = _mm256_setzero_pd();
+  delete[] paddedInput;
+  delete[] kernel;
+}
 
-    for (int k = -halfSize; k <= halfSize; k++) {
-      for (int l = -halfSize; l <= halfSize; l++) {
-        kernelValue = _mm256_set1_pd(
-            kernel[(k + halfSize) * kernalSize + (l + halfSize)]);
+/**
+ * @brief Apply a Gaussian filter to an image without intrinsics. This is the
+ * fallback for CPUs without AVX2, the compiler vectorizes it for the baseline
+ * (SSE2) target
+ */
+void GaussianFilterScalar(const double *input, double *output, int kernalSize,
+                          int width, int height, double sigma) {
+  int halfSize = kernalSize / 2;
+  double *paddedInput =
+      new double[(width + 2 * halfSize) * (height + 2 * halfSize)];
+  // Add 0 padding to the input matrix
+  PadMatrix(input, paddedInput, width, height, halfSize, 0);
 
-        pixels1 = _mm256_loadu_pd(
-            &paddedInput[((idx) / width + halfSize + k) * paddedWidth +
-                         ((idx) % width + halfSize + l)]);
+  GaussianFilterPaddedScalar(paddedInput, output, kernalSize, width, height,
+                             sigma);
 
-        sum1 = _mm256_fmadd_pd(pixels1, kernelValue, sum1);
-      }
+  delete[] paddedInput;
+}
+
+/**
+ * @brief Apply a Gaussian filter to an image already padded by kernalSize / 2
+ * without intrinsics
+ */
+void GaussianFilterPaddedScalar(const double *paddedInput, double *output,
+                                int kernalSize, int width, int height,
+                                double sigma) {
+  int halfSize = kernalSize / 2;
+  int paddedWidth = width + 2 * halfSize;
+  double *kernel = new double[kernalSize * kernalSize];
+
+  GenerateGaussianKernel(kernel, kernalSize, kernalSize, sigma);
+
+#pragma omp parallel for schedule(static)
+  for (int i = 0; i < height; i++) {
+    double *outRow = &output[i * width];
+
+    for (int j = 0; j < width; j++) {
+      outRow[j] = 0.0;
     }
 
-    _mm256_storeu_pd(&output[((idx) / width) * width + ((idx) % width)], sum1);
+    // Accumulate one kernel tap over the whole row at a time so the inner
+    // loop is a contiguous multiply-add
+    for (int k = 0; k < kernalSize; k++) {
+      const double *inRow = &paddedInput[(i + k) * paddedWidth];
+      for (int l = 0; l < kernalSize; l++) {
+        double kernelValue = kernel[k * kernalSize + l];
+        for (int j = 0; j < width; j++) {
+          outRow[j] += inRow[j + l] * kernelValue;
+        }
+      }
+    }
   }
 
-  delete[] paddedInput;
   delete[] kernel;
-};
+}
 
 /**
  * @brief Apply a Gaussian filter to an image. This function is a slow
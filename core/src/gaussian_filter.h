@@ -1,10 +1,49 @@
 #pragma once
 
+#include "image_view.h"
+#include <cstddef>
+
 void GaussianFilter(const double *input, double *output, int kernalSize,
                     int width, int height, double sigma);
 
+void GaussianFilter(ImageView<const double> input, double *output,
+                    int kernalSize, double sigma, bool *inRange = nullptr);
+
+void GaussianFilterBGR(const unsigned char *bgr, size_t stride, double *output,
+                       int kernalSize, int width, int height, double sigma);
+
+void GaussianDownsample(const double *input, double *output, int kernalSize,
+                        int width, int height, double sigma);
+
 void GaussianFilterSlow(const double *input, double *output, int kernalSize,
                         int width, int height, double sigma);
 
 void GenerateGaussianKernel(double *kernel, int width, int height,
                             double sigma);
+
+// Per-ISA kernels behind GaussianFilter(), see cpu_dispatch.h
+void GaussianFilterScalar(const double *input, double *output, int kernalSize,
+                          int width, int height, double sigma);
+void GaussianFilterAVX2(const double *input, double *output, int kernalSize,
+                        int width, int height, double sigma);
+void GaussianFilterAVX512(const double *input, double *output, int kernalSize,
+                          int width, int height, double sigma);
+
+// The same kernels on an input already padded by kernalSize / 2
+void GaussianFilterPaddedScalar(const double *paddedInput, double *output,
+                                int kernalSize, int width, int height,
+                                double sigma);
+void GaussianFilterPaddedAVX2(const double *paddedInput, double *output,
+                              int kernalSize, int width, int height,
+                              double sigma);
+void GaussianFilterPaddedAVX512(const double *paddedInput, double *output,
+                                int kernalSize, int width, int height,
+                                double sigma);
+
+// Per-ISA kernels behind GaussianDownsample()
+void GaussianDownsampleScalar(const double *input, double *output,
+                              int kernalSize, int width, int height,
+                              double sigma);
+void GaussianDownsampleAVX2(const double *input, double *output,
+                            int kernalSize, int width, int height,
+                            double sigma);
@@ -0,0 +1,196 @@
+#include "gaussian_filter.h"
+#include "padding.h"
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <immintrin.h>
+#include <omp.h>
+
+/**
+ * @brief Apply a Gaussian filter to an image using AVX2 and FMA
+ */
+void GaussianFilterAVX2(const double *input, double *output, int kernalSize,
+                        int width, int height, double sigma) {
+  int halfSize = kernalSize / 2;
+  double *paddedInput =
+      new double[(width + 2 * halfSize) * (height + 2 * halfSize)];
+  // Add 0 padding to the input matrix
+  PadMatrix(input, paddedInput, width, height, halfSize, 0);
+
+  GaussianFilterPaddedAVX2(paddedInput, output, kernalSize, width, height,
+                           sigma);
+
+  delete[] paddedInput;
+}
+
+/**
+ * @brief Lanes [0, count) set, for the masked loads and stores of the last
+ * block of a row
+ */
+static inline __m256i TailMask(int count) {
+  return _mm256_cmpgt_epi64(_mm256_set1_epi64x(count),
+                            _mm256_setr_epi64x(0, 1, 2, 3));
+}
+
+/**
+ * @brief Apply a Gaussian filter to an image already padded by kernalSize / 2
+ * using AVX2 and FMA. The image is walked row by row so any width works, the
+ * end of each row is handled with a masked load and store
+ */
+void GaussianFilterPaddedAVX2(const double *paddedInput, double *output,
+                              int kernalSize, int width, int height,
+                              double sigma) {
+  assert(width > 0 && height > 0);
+
+  int halfSize = kernalSize / 2;
+  double *kernel = new double[kernalSize * kernalSize];
+
+  // TODO: We can try SIMD here
+  GenerateGaussianKernel(kernel, kernalSize, kernalSize, sigma);
+
+  int paddedWidth = width + 2 * halfSize;
+
+// TODO: Consider cache aware optimization
+// There are 2 FMA units in ECE06 and the latency is 10
+// We need to have at least 10 FMA to max the performance
+// SO we are processing 10 * 4 elements each time
+#pragma omp parallel for schedule(static)
+  for (int i = 0; i < height; i++) {
+    const double *window = &paddedInput[i * paddedWidth];
+    double *outRow = &output[i * width];
+    int j = 0;
+
+    for (; j <= width - 40; j += 40) {
+      // Declared inside the loop so every OpenMP thread gets its own registers
+      __m256d sum1 = _mm256_setzero_pd();
+      __m256d sum2 = _mm256_setzero_pd();
+      __m256d sum3 = _mm256_setzero_pd();
+      __m256d sum4 = _mm256_setzero_pd();
+      __m256d sum5 = _mm256_setzero_pd();
+      __m256d sum6 = _mm256_setzero_pd();
+      __m256d sum7 = _mm256_setzero_pd();
+      __m256d sum8 = _mm256_setzero_pd();
+      __m256d sum9 = _mm256_setzero_pd();
+      __m256d sum10 = _mm256_setzero_pd();
+
+      for (int k = 0; k < kernalSize; k++) {
+        const double *row = &window[k * paddedWidth + j];
+        for (int l = 0; l < kernalSize; l++) {
+          __m256d kernelValue = _mm256_set1_pd(kernel[k * kernalSize + l]);
+
+          sum1 = _mm256_fmadd_pd(_mm256_loadu_pd(&row[l]), kernelValue, sum1);
+          sum2 =
+              _mm256_fmadd_pd(_mm256_loadu_pd(&row[l + 4]), kernelValue, sum2);
+          sum3 =
+              _mm256_fmadd_pd(_mm256_loadu_pd(&row[l + 8]), kernelValue, sum3);
+          sum4 =
+              _mm256_fmadd_pd(_mm256_loadu_pd(&row[l + 12]), kernelValue, sum4);
+          sum5 =
+              _mm256_fmadd_pd(_mm256_loadu_pd(&row[l + 16]), kernelValue, sum5);
+          sum6 =
+              _mm256_fmadd_pd(_mm256_loadu_pd(&row[l + 20]), kernelValue, sum6);
+          sum7 =
+              _mm256_fmadd_pd(_mm256_loadu_pd(&row[l + 24]), kernelValue, sum7);
+          sum8 =
+              _mm256_fmadd_pd(_mm256_loadu_pd(&row[l + 28]), kernelValue, sum8);
+          sum9 =
+              _mm256_fmadd_pd(_mm256_loadu_pd(&row[l + 32]), kernelValue, sum9);
+          sum10 = _mm256_fmadd_pd(_mm256_loadu_pd(&row[l + 36]), kernelValue,
+                                  sum10);
+        }
+      }
+
+      _mm256_storeu_pd(&outRow[j], sum1);
+      _mm256_storeu_pd(&outRow[j + 4], sum2);
+      _mm256_storeu_pd(&outRow[j + 8], sum3);
+      _mm256_storeu_pd(&outRow[j + 12], sum4);
+      _mm256_storeu_pd(&outRow[j + 16], sum5);
+      _mm256_storeu_pd(&outRow[j + 20], sum6);
+      _mm256_storeu_pd(&outRow[j + 24], sum7);
+      _mm256_storeu_pd(&outRow[j + 28], sum8);
+      _mm256_storeu_pd(&outRow[j + 32], sum9);
+      _mm256_storeu_pd(&outRow[j + 36], sum10);
+    }
+
+    // Remaining 4-wide blocks, the last one masked to the end of the row
+    for (; j < width; j += 4) {
+      __m256i mask = TailMask(width - j);
+      __m256d sum = _mm256_setzero_pd();
+
+      for (int k = 0; k < kernalSize; k++) {
+        const double *row = &window[k * paddedWidth + j];
+        for (int l = 0; l < kernalSize; l++) {
+          __m256d kernelValue = _mm256_set1_pd(kernel[k * kernalSize + l]);
+          sum = _mm256_fmadd_pd(_mm256_maskload_pd(&row[l], mask), kernelValue,
+                                sum);
+        }
+      }
+
+      _mm256_maskstore_pd(&outRow[j], mask, sum);
+    }
+  }
+
+  delete[] kernel;
+}
+
+/**
+ * @brief Decimating Gaussian filter using AVX2 and FMA, see
+ * GaussianDownsample(). Works on any width, the end of each row is done
+ * without intrinsics.
+ */
+void GaussianDownsampleAVX2(const double *input, double *output,
+                            int kernalSize, int width, int height,
+                            double sigma) {
+  int halfSize = kernalSize / 2;
+  int paddedWidth = width + 2 * halfSize;
+  int outputWidth = (width + 1) / 2;
+  int outputHeight = (height + 1) / 2;
+  double *kernel = new double[kernalSize * kernalSize];
+
+  GenerateGaussianKernel(kernel, kernalSize, kernalSize, sigma);
+
+  double *paddedInput =
+      new double[(width + 2 * halfSize) * (height + 2 * halfSize)];
+  PadMatrix(input, paddedInput, width, height, halfSize, 0);
+
+#pragma omp parallel for schedule(static)
+  for (int i = 0; i < outputHeight; i++) {
+    double *outRow = &output[i * outputWidth];
+    int j = 0;
+
+    // The last block stays scalar so the loads never pass the padded row
+    for (; j + 4 < outputWidth; j += 4) {
+      __m256d sum = _mm256_setzero_pd();
+
+      for (int k = 0; k < kernalSize; k++) {
+        const double *inRow = &paddedInput[(2 * i + k) * paddedWidth + 2 * j];
+        for (int l = 0; l < kernalSize; l++) {
+          __m256d kernelValue = _mm256_set1_pd(kernel[k * kernalSize + l]);
+          // Even elements of 8 consecutive pixels: unpacklo gives
+          // a0 b0 a2 b2, the permute restores the order a0 a2 b0 b2
+          __m256d low = _mm256_loadu_pd(&inRow[l]);
+          __m256d high = _mm256_loadu_pd(&inRow[l + 4]);
+          __m256d even = _mm256_permute4x64_pd(_mm256_unpacklo_pd(low, high),
+                                               _MM_SHUFFLE(3, 1, 2, 0));
+          sum = _mm256_fmadd_pd(even, kernelValue, sum);
+        }
+      }
+
+      _mm256_storeu_pd(&outRow[j], sum);
+    }
+
+    for (; j < outputWidth; j++) {
+      double sum = 0.0;
+      for (int k = 0; k < kernalSize; k++) {
+        const double *inRow = &paddedInput[(2 * i + k) * paddedWidth + 2 * j];
+        for (int l = 0; l < kernalSize; l++) {
+          sum += inRow[l] * kernel[k * kernalSize + l];
+        }
+      }
+      outRow[j] = sum;
+    }
+  }
+
+  delete[] paddedInput;
+  delete[] kernel;
+}
@@ -0,0 +1,92 @@
+#include "gaussian_filter.h"
+#include "padding.h"
+#include <immintrin.h>
+#include <omp.h>
+
+/**
+ * @brief Apply a Gaussian filter to an image using AVX-512. The image is walked
+ * row by row so any width works, the end of each row is handled with a masked
+ * load and store instead of a scalar loop
+ */
+void GaussianFilterAVX512(const double *input, double *output, int kernalSize,
+                          int width, int height, double sigma) {
+  int halfSize = kernalSize / 2;
+  double *paddedInput =
+      new double[(width + 2 * halfSize) * (height + 2 * halfSize)];
+  // Add 0 padding to the input matrix
+  PadMatrix(input, paddedInput, width, height, halfSize, 0);
+
+  GaussianFilterPaddedAVX512(paddedInput, output, kernalSize, width, height,
+                             sigma);
+
+  delete[] paddedInput;
+}
+
+/**
+ * @brief Apply a Gaussian filter to an image already padded by kernalSize / 2
+ * using AVX-512
+ */
+void GaussianFilterPaddedAVX512(const double *paddedInput, double *output,
+                                int kernalSize, int width, int height,
+                                double sigma) {
+  int halfSize = kernalSize / 2;
+  int paddedWidth = width + 2 * halfSize;
+  double *kernel = new double[kernalSize * kernalSize];
+
+  GenerateGaussianKernel(kernel, kernalSize, kernalSize, sigma);
+
+#pragma omp parallel for schedule(static)
+  for (int i = 0; i < height; i++) {
+    const double *window = &paddedInput[i * paddedWidth];
+    double *outRow = &output[i * width];
+    int j = 0;
+
+    // 4 independent accumulators (32 pixels) to hide the FMA latency
+    for (; j <= width - 32; j += 32) {
+      __m512d sum1 = _mm512_setzero_pd();
+      __m512d sum2 = _mm512_setzero_pd();
+      __m512d sum3 = _mm512_setzero_pd();
+      __m512d sum4 = _mm512_setzero_pd();
+
+      for (int k = 0; k < kernalSize; k++) {
+        const double *row = &window[k * paddedWidth + j];
+        for (int l = 0; l < kernalSize; l++) {
+          __m512d kernelValue = _mm512_set1_pd(kernel[k * kernalSize + l]);
+
+          sum1 = _mm512_fmadd_pd(_mm512_loadu_pd(&row[l]), kernelValue, sum1);
+          sum2 =
+              _mm512_fmadd_pd(_mm512_loadu_pd(&row[l + 8]), kernelValue, sum2);
+          sum3 =
+              _mm512_fmadd_pd(_mm512_loadu_pd(&row[l + 16]), kernelValue, sum3);
+          sum4 =
+              _mm512_fmadd_pd(_mm512_loadu_pd(&row[l + 24]), kernelValue, sum4);
+        }
+      }
+
+      _mm512_storeu_pd(&outRow[j], sum1);
+      _mm512_storeu_pd(&outRow[j + 8], sum2);
+      _mm512_storeu_pd(&outRow[j + 16], sum3);
+      _mm512_storeu_pd(&outRow[j + 24], sum4);
+    }
+
+    // Remaining 8-wide blocks, the last one masked to the end of the row
+    for (; j < width; j += 8) {
+      __mmask8 mask =
+          width - j >= 8 ? (__mmask8)0xFF : (__mmask8)((1u << (width - j)) - 1);
+      __m512d sum = _mm512_setzero_pd();
+
+      for (int k = 0; k < kernalSize; k++) {
+        const double *row = &window[k * paddedWidth + j];
+        for (int l = 0; l < kernalSize; l++) {
+          __m512d kernelValue = _mm512_set1_pd(kernel[k * kernalSize + l]);
+          sum = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, &row[l]),
+                                kernelValue, sum);
+        }
+      }
+
+      _mm512_mask_storeu_pd(&outRow[j], mask, sum);
+    }
+  }
+
+  delete[] kernel;
+}
@@ -1,7 +1,50 @@
 #pragma once
 
+// Gradient magnitudes of a [0, 255] image stay below 4 * 255 * sqrt(2), the
+// histogram has one bin per unit of magnitude
+#define GRADIENT_HISTOGRAM_BINS 1443
+
+/**
+ * @brief Sobel magnitude and direction of every pixel. When `histogram` is not
+ * null, the magnitudes are also counted into its GRADIENT_HISTOGRAM_BINS bins
+ * (added to the current counts) while they are still in cache.
+ */
 void Gradient(const double *input, double *output, double *theta, int width,
-              int height);
+              int height, unsigned int *histogram = nullptr);
 
 void GradientSlow(const double *input, double *output, double *theta, int width,
                   int height);
+
+/**
+ * @brief Cheaper, approximate Gradient(): the L1 magnitude |gx| + |gy|, which
+ * overestimates the true one by up to sqrt(2), and the direction snapped to
+ * the four sectors non-maxima suppression tells apart, without atan2.
+ */
+void GradientL1(const double *input, double *output, double *theta, int width,
+                int height);
+
+// Per-ISA kernels behind Gradient(), see cpu_dispatch.h
+void GradientScalar(const double *input, double *output, double *theta,
+                    int width, int height, unsigned int *histogram = nullptr);
+void GradientAVX2(const double *input, double *output, double *theta,
+                  int width, int height, unsigned int *histogram = nullptr);
+void GradientAVX512(const double *input, double *output, double *theta,
+                    int width, int height, unsigned int *histogram = nullptr);
+
+// Count a run of magnitudes into a histogram, used by every kernel above
+static inline void CountGradientMagnitudes(const double *magnitudes, int count,
+                                           unsigned int *histogram) {
+  for (int i = 0; i < count; i++) {
+    int bin = (int)magnitudes[i];
+    histogram[bin < GRADIENT_HISTOGRAM_BINS ? bin
+                                            : GRADIENT_HISTOGRAM_BINS - 1]++;
+  }
+}
+
+// Add a thread's histogram to the shared one
+static inline void MergeGradientHistogram(const unsigned int *local,
+                                          unsigned int *histogram) {
+  for (int i = 0; i < GRADIENT_HISTOGRAM_BINS; i++) {
+    histogram[i] += local[i];
+  }
+}
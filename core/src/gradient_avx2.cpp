@@ -0,0 +1,159 @@
+#include "gradient.h"
+#include "padding.h"
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <immintrin.h>
+#include <omp.h>
+
+using namespace std;
+
+const double sobel_x[3][3] = {{-1, 0, 1}, {-2, 0, 2}, {-1, 0, 1}};
+const double sobel_y[3][3] = {{-1, -2, -1}, {0, 0, 0}, {1, 2, 1}};
+
+static __m256d simd_approx_atan(__m256d x) {
+  // Constants for approximation (coefficients would be based on a polynomial
+  // fit)
+  const __m256d c1 = _mm256_set1_pd(0.9997878412794807); // Example coefficient
+  const __m256d c2 = _mm256_set1_pd(-0.3258083974640975);
+  const __m256d c3 = _mm256_set1_pd(0.1555786518463281);
+  const __m256d c4 = _mm256_set1_pd(-0.04432655554792128);
+
+  __m256d x2 = _mm256_mul_pd(x, x);
+  __m256d result = _mm256_fmadd_pd(c4, x2, c3);
+  result = _mm256_fmadd_pd(result, x2, c2);
+  result = _mm256_fmadd_pd(result, x2, c1);
+  result = _mm256_mul_pd(result, x);
+
+  return result;
+}
+
+static __m256d simd_atan2(__m256d y, __m256d x) {
+  // Constants for adjusting results based on the quadrant
+  const __m256d pi = _mm256_set1_pd(M_PI);
+  const __m256d zero = _mm256_setzero_pd();
+
+  // Calculate y / x
+  __m256d tangent = _mm256_div_pd(y, x);
+
+  // Approximate atan using polynomial expansion or similar methods
+  __m256d atan_result =
+      simd_approx_atan(tangent); // Substitute with approximate atan
+
+  // Check for quadrant adjustments
+  __m256d x_lt_zero = _mm256_cmp_pd(x, zero, _CMP_LT_OS); // x < 0
+  __m256d y_ge_zero = _mm256_cmp_pd(y, zero, _CMP_GE_OS); // y >= 0
+
+  // Adjust atan_result based on the quadrant of (x, y)
+  __m256d angle_offset =
+      _mm256_blendv_pd(pi, -pi, y_ge_zero); // +/- pi based on y sign
+  __m256d adjusted_result =
+      _mm256_add_pd(atan_result, _mm256_and_pd(x_lt_zero, angle_offset));
+
+  return adjusted_result;
+};
+
+/**
+ * @brief Sobel magnitude and direction for 4 pixels starting at window[0].
+ * With a mask, lanes outside it are neither read nor written
+ */
+static inline void SobelBlock(const double *window, int paddedWidth,
+                              double *output, double *theta,
+                              const __m256i *mask = nullptr) {
+  const __m256d pi = _mm256_set1_pd(M_PI);
+  const __m256d neg_pi = _mm256_set1_pd(-M_PI);
+  const __m256d epsilon = _mm256_set1_pd(1e-10);
+
+  __m256d sum_x = _mm256_setzero_pd();
+  __m256d sum_y = _mm256_setzero_pd();
+
+  // Apply Sobel kernels
+  for (int k = 0; k < 3; k++) {
+    for (int l = 0; l < 3; l++) {
+      const double *at = &window[k * paddedWidth + l];
+      __m256d pixels = mask == nullptr ? _mm256_loadu_pd(at)
+                                       : _mm256_maskload_pd(at, *mask);
+      sum_x = _mm256_fmadd_pd(pixels, _mm256_set1_pd(sobel_x[k][l]), sum_x);
+      sum_y = _mm256_fmadd_pd(pixels, _mm256_set1_pd(sobel_y[k][l]), sum_y);
+    }
+  }
+
+  // Compute magnitude and direction (grad_x/2 + grad_y/2)
+  __m256d grad = _mm256_sqrt_pd(
+      _mm256_add_pd(_mm256_mul_pd(sum_x, sum_x), _mm256_mul_pd(sum_y, sum_y)));
+
+  __m256d dir = simd_atan2(sum_x, sum_y);
+  dir = _mm256_blendv_pd(
+      dir, neg_pi,
+      _mm256_cmp_pd(_mm256_andnot_pd(_mm256_set1_pd(-0.0),
+                                     _mm256_sub_pd(dir, pi)),
+                    epsilon, _CMP_LT_OS));
+
+  if (mask == nullptr) {
+    _mm256_storeu_pd(output, grad);
+    _mm256_storeu_pd(theta, dir);
+  } else {
+    _mm256_maskstore_pd(output, *mask, grad);
+    _mm256_maskstore_pd(theta, *mask, dir);
+  }
+}
+
+/**
+ * @brief Apply a Sobel filter to an image using AVX2 and FMA. Rows of any
+ * width are supported, the last block of each row uses masked loads and
+ * stores
+ */
+void GradientAVX2(const double *input, double *output, double *theta,
+                  int width, int height, unsigned int *histogram) {
+  assert(width > 0 && height > 0);
+
+  // The Sobel kernels are 3x3, one pixel of padding is all they read
+  const int padd = 1;
+  int paddedWidth = width + 2 * padd;
+
+  double *paddedInput = new double[(width + 2 * padd) * (height + 2 * padd)];
+  // Add 0 padding to the input matrix
+  PadMatrix(input, paddedInput, width, height, padd, 0);
+
+#pragma omp parallel
+  {
+    // Each thread counts into its own histogram, merged once at the end
+    unsigned int localHistogram[GRADIENT_HISTOGRAM_BINS] = {};
+
+#pragma omp for schedule(static)
+    for (int i = 0; i < height; i++) {
+      const double *window = &paddedInput[i * paddedWidth];
+      double *outRow = &output[i * width];
+      double *thetaRow = &theta[i * width];
+      int j = 0;
+
+      // Four independent blocks per iteration to hide the FMA latency
+      for (; j <= width - 16; j += 16) {
+        SobelBlock(&window[j], paddedWidth, &outRow[j], &thetaRow[j]);
+        SobelBlock(&window[j + 4], paddedWidth, &outRow[j + 4],
+                   &thetaRow[j + 4]);
+        SobelBlock(&window[j + 8], paddedWidth, &outRow[j + 8],
+                   &thetaRow[j + 8]);
+        SobelBlock(&window[j + 12], paddedWidth, &outRow[j + 12],
+                   &thetaRow[j + 12]);
+      }
+
+      for (; j < width; j += 4) {
+        __m256i mask = _mm256_cmpgt_epi64(_mm256_set1_epi64x(width - j),
+                                          _mm256_setr_epi64x(0, 1, 2, 3));
+        SobelBlock(&window[j], paddedWidth, &outRow[j], &thetaRow[j], &mask);
+      }
+
+      if (histogram != nullptr) {
+        CountGradientMagnitudes(outRow, width, localHistogram);
+      }
+    }
+
+    if (histogram != nullptr) {
+#pragma omp critical
+      MergeGradientHistogram(localHistogram, histogram);
+    }
+  }
+
+  delete[] paddedInput;
+}
@@ -0,0 +1,125 @@
+#include "gradient.h"
+#include "padding.h"
+#include <cmath>
+#include <immintrin.h>
+#include <omp.h>
+
+const double sobel_x[3][3] = {{-1, 0, 1}, {-2, 0, 2}, {-1, 0, 1}};
+const double sobel_y[3][3] = {{-1, -2, -1}, {0, 0, 0}, {1, 2, 1}};
+
+// Same polynomial and quadrant handling as simd_atan2 in gradient_avx2.cpp
+static inline __m512d ApproxAtan(__m512d x) {
+  const __m512d c1 = _mm512_set1_pd(0.9997878412794807);
+  const __m512d c2 = _mm512_set1_pd(-0.3258083974640975);
+  const __m512d c3 = _mm512_set1_pd(0.1555786518463281);
+  const __m512d c4 = _mm512_set1_pd(-0.04432655554792128);
+
+  __m512d x2 = _mm512_mul_pd(x, x);
+  __m512d result = _mm512_fmadd_pd(c4, x2, c3);
+  result = _mm512_fmadd_pd(result, x2, c2);
+  result = _mm512_fmadd_pd(result, x2, c1);
+  return _mm512_mul_pd(result, x);
+}
+
+static inline __m512d ApproxAtan2(__m512d y, __m512d x) {
+  const __m512d pi = _mm512_set1_pd(M_PI);
+  const __m512d negPi = _mm512_set1_pd(-M_PI);
+  const __m512d zero = _mm512_setzero_pd();
+
+  __m512d result = ApproxAtan(_mm512_div_pd(y, x));
+
+  __mmask8 xLtZero = _mm512_cmp_pd_mask(x, zero, _CMP_LT_OS);
+  __mmask8 yGeZero = _mm512_cmp_pd_mask(y, zero, _CMP_GE_OS);
+  __m512d offset = _mm512_mask_blend_pd(yGeZero, pi, negPi);
+
+  return _mm512_mask_add_pd(result, xLtZero, result, offset);
+}
+
+/**
+ * @brief Sobel magnitude and direction for 8 pixels starting at window[0],
+ * lanes outside mask are neither read nor written
+ */
+static inline void SobelBlock(const double *window, int paddedWidth,
+                              double *output, double *theta, __mmask8 mask) {
+  const __m512d pi = _mm512_set1_pd(M_PI);
+  const __m512d negPi = _mm512_set1_pd(-M_PI);
+  const __m512d epsilon = _mm512_set1_pd(1e-10);
+
+  __m512d sumX = _mm512_setzero_pd();
+  __m512d sumY = _mm512_setzero_pd();
+
+  for (int k = 0; k < 3; k++) {
+    for (int l = 0; l < 3; l++) {
+      __m512d pixels =
+          _mm512_maskz_loadu_pd(mask, &window[k * paddedWidth + l]);
+      sumX = _mm512_fmadd_pd(pixels, _mm512_set1_pd(sobel_x[k][l]), sumX);
+      sumY = _mm512_fmadd_pd(pixels, _mm512_set1_pd(sobel_y[k][l]), sumY);
+    }
+  }
+
+  // The zero-masking form, GCC's _mm512_sqrt_pd passes an undefined vector
+  // through and trips -Wmaybe-uninitialized
+  __m512d grad = _mm512_maskz_sqrt_pd(
+      mask,
+      _mm512_add_pd(_mm512_mul_pd(sumX, sumX), _mm512_mul_pd(sumY, sumY)));
+
+  __m512d dir = ApproxAtan2(sumX, sumY);
+  __mmask8 isPi = _mm512_cmp_pd_mask(_mm512_abs_pd(_mm512_sub_pd(dir, pi)),
+                                     epsilon, _CMP_LT_OS);
+  dir = _mm512_mask_blend_pd(isPi, dir, negPi);
+
+  _mm512_mask_storeu_pd(output, mask, grad);
+  _mm512_mask_storeu_pd(theta, mask, dir);
+}
+
+/**
+ * @brief Apply a Sobel filter to an image using AVX-512. Rows of any width are
+ * supported, the last block of each row uses masked loads and stores
+ */
+void GradientAVX512(const double *input, double *output, double *theta,
+                    int width, int height, unsigned int *histogram) {
+  const int padd = 1;
+  int paddedWidth = width + 2 * padd;
+
+  double *paddedInput = new double[(width + 2 * padd) * (height + 2 * padd)];
+  // Add 0 padding to the input matrix
+  PadMatrix(input, paddedInput, width, height, padd, 0);
+
+#pragma omp parallel
+  {
+    // Each thread counts into its own histogram, merged once at the end
+    unsigned int localHistogram[GRADIENT_HISTOGRAM_BINS] = {};
+
+#pragma omp for schedule(static)
+    for (int i = 0; i < height; i++) {
+      const double *window = &paddedInput[i * paddedWidth];
+      double *outRow = &output[i * width];
+      double *thetaRow = &theta[i * width];
+      int j = 0;
+
+      // Two independent blocks per iteration to keep both FMA ports busy
+      for (; j <= width - 16; j += 16) {
+        SobelBlock(&window[j], paddedWidth, &outRow[j], &thetaRow[j], 0xFF);
+        SobelBlock(&window[j + 8], paddedWidth, &outRow[j + 8],
+                   &thetaRow[j + 8], 0xFF);
+      }
+
+      for (; j < width; j += 8) {
+        __mmask8 mask = width - j >= 8 ? (__mmask8)0xFF
+                                       : (__mmask8)((1u << (width - j)) - 1);
+        SobelBlock(&window[j], paddedWidth, &outRow[j], &thetaRow[j], mask);
+      }
+
+      if (histogram != nullptr) {
+        CountGradientMagnitudes(outRow, width, localHistogram);
+      }
+    }
+
+    if (histogram != nullptr) {
+#pragma omp critical
+      MergeGradientHistogram(localHistogram, histogram);
+    }
+  }
+
+  delete[] paddedInput;
+}
@@ -4,8 +4,14 @@ void HysteresisSlow(double *input, double *output, int width, int height,
                     double lowThreshold, double highThreshold);
 void Hysteresis(double *input, double *output, int width, int height,
                 double lowThreshold, double highThreshold);
-void HysteresisIteration(double *input, double *output, int width, int height,
-                         double lowThreshold, double highThreshold);
 
 void HysteresisQueue(double *input, double *output, int width, int height,
                      double lowThreshold, double highThreshold);
+
+// Per-ISA kernels behind Hysteresis(), see cpu_dispatch.h
+void HysteresisScalar(double *input, double *output, int width, int height,
+                      double lowThreshold, double highThreshold);
+void HysteresisAVX2(double *input, double *output, int width, int height,
+                    double lowThreshold, double highThreshold);
+void HysteresisAVX512(double *input, double *output, int width, int height,
+                      double lowThreshold, double highThreshold);
@@ -0,0 +1,141 @@
+#include "hysteresis.h"
+#include <cstring>
+#include <immintrin.h>
+#include <omp.h>
+
+#define LABEL_NON_EDGE 0
+#define LABEL_WEAK_EDGE 1
+#define LABEL_STRONG_EDGE 2
+
+/**
+ * @brief Promote weak edges connected to strong ones using AVX-512.
+ *
+ * Instead of sweeping the whole image until nothing changes, one vector pass
+ * turns the thresholded image into a padded byte label map and compress-stores
+ * the index of every strong pixel into a seed stack. A flood fill from those
+ * seeds then only touches pixels that actually become edges. Rows are handled
+ * 16 pixels at a time, the last block of a row is masked.
+ */
+void HysteresisAVX512(double *input, double *output, int width, int height,
+                      double lowThreshold, double highThreshold) {
+  int paddedWidth = width + 2;
+  int paddedHeight = height + 2;
+
+  unsigned char *labels = new unsigned char[paddedWidth * paddedHeight];
+  // Every pixel is pushed at most once, so width * height entries are enough
+  int *stack = new int[width * height];
+  int *rowSeeds = new int[height];
+
+  // Zero border so the flood fill needs no bounds checks
+  std::memset(labels, LABEL_NON_EDGE, paddedWidth);
+  std::memset(&labels[(paddedHeight - 1) * paddedWidth], LABEL_NON_EDGE,
+              paddedWidth);
+
+  const __m512d strongEdgeValue = _mm512_set1_pd(highThreshold);
+  const __m512d weakEdgeValue = _mm512_set1_pd(lowThreshold);
+  const __m128i weakLabel = _mm_set1_epi8(LABEL_WEAK_EDGE);
+  const __m128i strongLabel = _mm_set1_epi8(LABEL_STRONG_EDGE);
+  const __m512i laneOffsets =
+      _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+#pragma omp parallel for schedule(static)
+  for (int y = 0; y < height; y++) {
+    const double *inRow = &input[y * width];
+    unsigned char *labelRow = &labels[(y + 1) * paddedWidth + 1];
+    // Each row owns a width sized slice of the stack until it is compacted
+    int *seeds = &stack[y * width];
+    int count = 0;
+
+    labelRow[-1] = LABEL_NON_EDGE;
+    labelRow[width] = LABEL_NON_EDGE;
+
+    for (int x = 0; x < width; x += 16) {
+      int remaining = width - x;
+      __mmask16 lanes = remaining >= 16 ? (__mmask16)0xFFFF
+                                        : (__mmask16)((1u << remaining) - 1);
+      __mmask8 lanesLo = (__mmask8)lanes;
+      __mmask8 lanesHi = (__mmask8)(lanes >> 8);
+
+      __m512d pixelsLo = _mm512_maskz_loadu_pd(lanesLo, &inRow[x]);
+      __m512d pixelsHi = _mm512_maskz_loadu_pd(lanesHi, &inRow[x + 8]);
+
+      __mmask16 strong =
+          (__mmask16)(_mm512_mask_cmp_pd_mask(lanesLo, pixelsLo,
+                                              strongEdgeValue, _CMP_EQ_OQ) |
+                      (_mm512_mask_cmp_pd_mask(lanesHi, pixelsHi,
+                                               strongEdgeValue, _CMP_EQ_OQ)
+                       << 8));
+      __mmask16 weak =
+          (__mmask16)(_mm512_mask_cmp_pd_mask(lanesLo, pixelsLo, weakEdgeValue,
+                                              _CMP_EQ_OQ) |
+                      (_mm512_mask_cmp_pd_mask(lanesHi, pixelsHi, weakEdgeValue,
+                                               _CMP_EQ_OQ)
+                       << 8)) &
+          ~strong;
+
+      __m128i label = _mm_maskz_mov_epi8(weak, weakLabel);
+      label = _mm_mask_mov_epi8(label, strong, strongLabel);
+      _mm_mask_storeu_epi8(&labelRow[x], lanes, label);
+
+      // Edge candidate extraction: pack the padded indices of the strong
+      // lanes to the top of the row's seed slice
+      __m512i indices = _mm512_add_epi32(
+          _mm512_set1_epi32((y + 1) * paddedWidth + 1 + x), laneOffsets);
+      _mm512_mask_compressstoreu_epi32(&seeds[count], strong, indices);
+      count += _mm_popcnt_u32(strong);
+    }
+
+    rowSeeds[y] = count;
+  }
+
+  // Compact the per-row seeds into one contiguous stack
+  int top = 0;
+  for (int y = 0; y < height; y++) {
+    std::memmove(&stack[top], &stack[y * width], rowSeeds[y] * sizeof(int));
+    top += rowSeeds[y];
+  }
+
+  const int neighborOffsets[8] = {-paddedWidth - 1, -paddedWidth,
+                                  -paddedWidth + 1, -1,
+                                  1,                paddedWidth - 1,
+                                  paddedWidth,      paddedWidth + 1};
+
+  while (top > 0) {
+    int idx = stack[--top];
+
+    for (int n = 0; n < 8; n++) {
+      int nidx = idx + neighborOffsets[n];
+      if (labels[nidx] == LABEL_WEAK_EDGE) {
+        labels[nidx] = LABEL_STRONG_EDGE;
+        stack[top++] = nidx;
+      }
+    }
+  }
+
+  // Strong labels become highThreshold, everything else is suppressed
+#pragma omp parallel for schedule(static)
+  for (int y = 0; y < height; y++) {
+    const unsigned char *labelRow = &labels[(y + 1) * paddedWidth + 1];
+    double *outRow = &output[y * width];
+
+    for (int x = 0; x < width; x += 16) {
+      int remaining = width - x;
+      __mmask16 lanes = remaining >= 16 ? (__mmask16)0xFFFF
+                                        : (__mmask16)((1u << remaining) - 1);
+
+      __m128i label = _mm_maskz_loadu_epi8(lanes, &labelRow[x]);
+      __mmask16 strong = _mm_cmpeq_epi8_mask(label, strongLabel);
+
+      _mm512_mask_storeu_pd(&outRow[x], (__mmask8)lanes,
+                            _mm512_maskz_mov_pd((__mmask8)strong,
+                                                strongEdgeValue));
+      _mm512_mask_storeu_pd(&outRow[x + 8], (__mmask8)(lanes >> 8),
+                            _mm512_maskz_mov_pd((__mmask8)(strong >> 8),
+                                                strongEdgeValue));
+    }
+  }
+
+  delete[] labels;
+  delete[] stack;
+  delete[] rowSeeds;
+}
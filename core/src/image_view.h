@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+
+/**
+ * @brief Non-owning view of a `width` x `height` image whose rows start
+ * `stride` elements apart, such as a ROI of a larger image or a camera buffer
+ * with a row pitch. A stride of 0 means continuous rows.
+ */
+template <class T> struct ImageView {
+  T *data = nullptr;
+  int width = 0;
+  int height = 0;
+  size_t stride = 0;
+
+  ImageView() = default;
+  ImageView(T *data, int width, int height, size_t stride = 0)
+      : data(data), width(width), height(height),
+        stride(stride != 0 ? stride : (size_t)width) {}
+
+  // A view of mutable pixels also reads as a view of const ones
+  template <class U, class = typename std::enable_if<
+                         std::is_same<const U, T>::value>::type>
+  ImageView(const ImageView<U> &other)
+      : data(other.data), width(other.width), height(other.height),
+        stride(other.stride) {}
+
+  T *Row(int y) const { return data + y * stride; }
+
+  bool Continuous() const { return stride == (size_t)width || height <= 1; }
+
+  /**
+   * @brief The `width` x `height` part starting at column `x`, row `y`, with
+   * the same stride
+   */
+  ImageView SubView(int x, int y, int width, int height) const {
+    return ImageView(Row(y) + x, width, height, stride);
+  }
+};
@@ -6,4 +6,12 @@ void NonMaxSuppressionSlow(double *input, double *output, double *theta,
 
 void NonMaxSuppression(double *input, double *output, double *theta,
                        int kernalSize, int width, int height);
+
+// Per-ISA kernels behind NonMaxSuppression(), see cpu_dispatch.h
+void NonMaxSuppressionScalar(double *input, double *output, double *theta,
+                             int kernalSize, int width, int height);
+void NonMaxSuppressionAVX2(double *input, double *output, double *theta,
+                           int kernalSize, int width, int height);
+void NonMaxSuppressionAVX512(double *input, double *output, double *theta,
+                             int kernalSize, int width, int height);
 #endif // NON_MAX_SUPPRESSION_H
@@ -0,0 +1,78 @@
+#include "non_maxima_suppression.h"
+#include <cmath>
+#include <immintrin.h>
+#include <omp.h>
+
+/**
+ * @brief Non-maxima suppression using AVX-512, 8 pixels at a time. The
+ * direction of every lane becomes a k-mask and only the two neighbours that
+ * direction needs are loaded (masked loads), which replaces the blendv chains
+ * of the AVX2 kernel. The end of each row is a masked block instead of a
+ * scalar loop.
+ */
+void NonMaxSuppressionAVX512(double *input, double *output, double *theta,
+                             int kernalSize, int width, int height) {
+  int padd = kernalSize / 2;
+  const __m512d vec_radianToDegree = _mm512_set1_pd(180.0 / M_PI);
+  const __m512d vec_180 = _mm512_set1_pd(180.0);
+  const __m512d vec_22_5 = _mm512_set1_pd(22.5);
+  const __m512d vec_67_5 = _mm512_set1_pd(67.5);
+  const __m512d vec_112_5 = _mm512_set1_pd(112.5);
+  const __m512d vec_157_5 = _mm512_set1_pd(157.5);
+  const __m512d vec_zero = _mm512_setzero_pd();
+
+#pragma omp parallel for schedule(static)
+  for (int i = padd; i < height - padd; i++) {
+    for (int j = padd; j < width - padd; j += 8) {
+      int idx = i * width + j;
+      int remaining = width - padd - j;
+      __mmask8 lanes = remaining >= 8 ? (__mmask8)0xFF
+                                      : (__mmask8)((1u << remaining) - 1);
+
+      // Convert to degrees and normalize to [0, 180)
+      __m512d angles = _mm512_mul_pd(_mm512_maskz_loadu_pd(lanes, &theta[idx]),
+                                     vec_radianToDegree);
+      __mmask8 negative = _mm512_cmp_pd_mask(angles, vec_zero, _CMP_LT_OS);
+      angles = _mm512_mask_add_pd(angles, negative, angles, vec_180);
+
+      __mmask8 ge_0 =
+          _mm512_mask_cmp_pd_mask(lanes, angles, vec_zero, _CMP_GE_OS);
+      __mmask8 ge_22_5 = _mm512_cmp_pd_mask(angles, vec_22_5, _CMP_GE_OS);
+      __mmask8 ge_67_5 = _mm512_cmp_pd_mask(angles, vec_67_5, _CMP_GE_OS);
+      __mmask8 ge_112_5 = _mm512_cmp_pd_mask(angles, vec_112_5, _CMP_GE_OS);
+      __mmask8 ge_157_5 = _mm512_cmp_pd_mask(angles, vec_157_5, _CMP_GE_OS);
+      __mmask8 le_180 = _mm512_cmp_pd_mask(angles, vec_180, _CMP_LE_OS);
+
+      // NaN angles fail every compare and keep q = r = 0, like the AVX2 kernel
+      __mmask8 mask_horizontal =
+          (ge_0 & ~ge_22_5) | (ge_157_5 & le_180 & lanes);
+      __mmask8 mask_diagonal1 = ge_22_5 & ~ge_67_5 & lanes;
+      __mmask8 mask_vertical = ge_67_5 & ~ge_112_5 & lanes;
+      __mmask8 mask_diagonal2 = ge_112_5 & ~ge_157_5 & lanes;
+
+      __m512d q = vec_zero;
+      __m512d r = vec_zero;
+
+      // Horizontal
+      q = _mm512_mask_loadu_pd(q, mask_horizontal, &input[idx + 1]);
+      r = _mm512_mask_loadu_pd(r, mask_horizontal, &input[idx - 1]);
+      // Diagonal1 (top-left to bottom-right)
+      q = _mm512_mask_loadu_pd(q, mask_diagonal1, &input[idx + width - 1]);
+      r = _mm512_mask_loadu_pd(r, mask_diagonal1, &input[idx - width + 1]);
+      // Vertical
+      q = _mm512_mask_loadu_pd(q, mask_vertical, &input[idx + width]);
+      r = _mm512_mask_loadu_pd(r, mask_vertical, &input[idx - width]);
+      // Diagonal2 (bottom-left to top-right)
+      q = _mm512_mask_loadu_pd(q, mask_diagonal2, &input[idx - width - 1]);
+      r = _mm512_mask_loadu_pd(r, mask_diagonal2, &input[idx + width + 1]);
+
+      __m512d input_vals = _mm512_maskz_loadu_pd(lanes, &input[idx]);
+      __mmask8 keep =
+          _mm512_mask_cmp_pd_mask(lanes, input_vals, q, _CMP_GE_OS) &
+          _mm512_cmp_pd_mask(input_vals, r, _CMP_GE_OS);
+
+      _mm512_mask_storeu_pd(&output[idx], lanes,
+                            _mm512_maskz_mov_pd(keep, input_vals));
+    }
+  }
+}
@@ -1,11 +1,21 @@
 /**
  * @brief Add Padding to a matrix with a given value
  */
+#include "padding.h"
+#include "cpu_dispatch.h"
 #include <cstring>
 #include <omp.h>
 
 void PadMatrix(const double *input, double *output, int width, int height,
                int padSize, int padValue) {
+  PadMatrix(ImageView<const double>(input, width, height), output, padSize,
+            padValue);
+}
+
+void PadMatrix(ImageView<const double> input, double *output, int padSize,
+               int padValue) {
+  int width = input.width;
+  int height = input.height;
   int paddedWidth = width + 2 * padSize;
   int paddedHeight = height + 2 * padSize;
 
@@ -13,7 +23,100 @@ void PadMatrix(const double *input, double *output, int width, int height,
 
 #pragma omp parallel for schedule(static)
   for (int i = 0; i < height; i++) {
-    std::memcpy(output + (i + padSize) * paddedWidth + padSize,
-                input + i * width, width * sizeof(double));
+    std::memcpy(output + (i + padSize) * paddedWidth + padSize, input.Row(i),
+                width * sizeof(double));
+  }
+}
+
+using PadMatrixInRangeFn = bool (*)(const double *, size_t, double *, int,
+                                     int, int);
+
+static PadMatrixInRangeFn SelectPadMatrixInRange() {
+  switch (ActiveIsaLevel()) {
+  case IsaLevel::AVX512:
+    return PadMatrixInRangeAVX512;
+  case IsaLevel::AVX2:
+    return PadMatrixInRangeAVX2;
+  default:
+    return PadMatrixInRangeScalar;
+  }
+}
+
+/**
+ * @brief PadMatrix() with zeros that also tells whether every pixel is in
+ * [0, 255], NaN counting as outside. The check runs on the values as they are copied, so validating
+ * the input costs no pass of its own.
+ */
+bool PadMatrixInRange(ImageView<const double> input, double *output,
+                      int padSize) {
+  static const PadMatrixInRangeFn impl = SelectPadMatrixInRange();
+  return impl(input.data, input.stride, output, input.width, input.height,
+              padSize);
+}
+
+bool PadMatrixInRangeScalar(const double *input, size_t stride, double *output,
+                            int width, int height, int padSize) {
+  int paddedWidth = width + 2 * padSize;
+  int paddedHeight = height + 2 * padSize;
+  bool outOfRange = false;
+
+  std::memset(output, 0, paddedWidth * padSize * sizeof(double));
+  std::memset(output + (paddedHeight - padSize) * paddedWidth, 0,
+              paddedWidth * padSize * sizeof(double));
+
+#pragma omp parallel for schedule(static) reduction(|| : outOfRange)
+  for (int i = 0; i < height; i++) {
+    const double *in = input + i * stride;
+    double *out = output + (i + padSize) * paddedWidth;
+
+    for (int j = 0; j < padSize; j++) {
+      out[j] = 0.0;
+      out[padSize + width + j] = 0.0;
+    }
+
+    bool rowOutOfRange = false;
+    for (int j = 0; j < width; j++) {
+      double pixel = in[j];
+      rowOutOfRange |= !(pixel >= 0 && pixel <= 255);
+      out[padSize + j] = pixel;
+    }
+    outOfRange = outOfRange || rowOutOfRange;
+  }
+
+  return !outOfRange;
+}
+
+/**
+ * @brief Convert an interleaved 8-bit BGR image, `stride` bytes per row, to
+ * gray and write it zero padded. Uses the fixed-point BT.601 weights of
+ * cv::cvtColor(COLOR_BGR2GRAY), so the result matches converting first.
+ */
+void PadBGRToGray(const unsigned char *bgr, size_t stride, double *output,
+                  int width, int height, int padSize) {
+  int paddedWidth = width + 2 * padSize;
+  int paddedHeight = height + 2 * padSize;
+
+  std::memset(output, 0, paddedWidth * padSize * sizeof(double));
+  std::memset(output + (paddedHeight - padSize) * paddedWidth, 0,
+              paddedWidth * padSize * sizeof(double));
+
+#pragma omp parallel for schedule(static)
+  for (int i = 0; i < height; i++) {
+    const unsigned char *in = bgr + i * stride;
+    double *out = output + (i + padSize) * paddedWidth;
+
+    for (int j = 0; j < padSize; j++) {
+      out[j] = 0.0;
+      out[padSize + width + j] = 0.0;
+    }
+
+    // Plain integer arithmetic on the interleaved bytes, which the compiler
+    // vectorizes with shuffles to split the channels
+    for (int j = 0; j < width; j++) {
+      int gray = (in[3 * j] * 1868 + in[3 * j + 1] * 9617 +
+                  in[3 * j + 2] * 4899 + (1 << 13)) >>
+                 14;
+      out[padSize + j] = gray;
+    }
   }
 }
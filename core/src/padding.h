@@ -1,2 +1,25 @@
+#include "image_view.h"
+#include <cstddef>
+
 void PadMatrix(const double *input, double *output, int width, int height,
                int padSize, int padValue);
+
+// Gathers the rows of a strided view into the padded, continuous copy
+void PadMatrix(ImageView<const double> input, double *output, int padSize,
+               int padValue);
+
+// Zero padding that also checks every pixel is in [0, 255] as it copies it,
+// returns false when one is not or is NaN
+bool PadMatrixInRange(ImageView<const double> input, double *output,
+                      int padSize);
+
+// Per-ISA kernels behind PadMatrixInRange(), see cpu_dispatch.h
+bool PadMatrixInRangeScalar(const double *input, size_t stride, double *output,
+                            int width, int height, int padSize);
+bool PadMatrixInRangeAVX2(const double *input, size_t stride, double *output,
+                          int width, int height, int padSize);
+bool PadMatrixInRangeAVX512(const double *input, size_t stride, double *output,
+                            int width, int height, int padSize);
+
+void PadBGRToGray(const unsigned char *bgr, size_t stride, double *output,
+                  int width, int height, int padSize);
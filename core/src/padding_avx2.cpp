@@ -0,0 +1,55 @@
+#include "padding.h"
+#include <cstring>
+#include <immintrin.h>
+
+/**
+ * @brief PadMatrixInRange() checking 4 pixels per compare with AVX2
+ */
+bool PadMatrixInRangeAVX2(const double *input, size_t stride, double *output,
+                          int width, int height, int padSize) {
+  int paddedWidth = width + 2 * padSize;
+  int paddedHeight = height + 2 * padSize;
+  int blockWidth = width - width % 4;
+  bool outOfRange = false;
+
+  std::memset(output, 0, paddedWidth * padSize * sizeof(double));
+  std::memset(output + (paddedHeight - padSize) * paddedWidth, 0,
+              paddedWidth * padSize * sizeof(double));
+
+  const __m256d low = _mm256_setzero_pd();
+  const __m256d high = _mm256_set1_pd(255.0);
+
+#pragma omp parallel for schedule(static) reduction(|| : outOfRange)
+  for (int i = 0; i < height; i++) {
+    const double *in = input + i * stride;
+    double *out = output + (i + padSize) * paddedWidth;
+
+    for (int j = 0; j < padSize; j++) {
+      out[j] = 0.0;
+      out[padSize + width + j] = 0.0;
+    }
+
+    // Lanes of pixels outside the range stay set for the rest of the row
+    __m256d rowOutOfRange = _mm256_setzero_pd();
+    for (int j = 0; j < blockWidth; j += 4) {
+      __m256d pixels = _mm256_loadu_pd(&in[j]);
+      rowOutOfRange = _mm256_or_pd(
+          rowOutOfRange,
+          _mm256_or_pd(_mm256_cmp_pd(pixels, low, _CMP_NGE_UQ),
+                       _mm256_cmp_pd(pixels, high, _CMP_NLE_UQ)));
+      _mm256_storeu_pd(&out[padSize + j], pixels);
+    }
+
+    bool tailOutOfRange = false;
+    for (int j = blockWidth; j < width; j++) {
+      double pixel = in[j];
+      tailOutOfRange |= !(pixel >= 0 && pixel <= 255);
+      out[padSize + j] = pixel;
+    }
+
+    outOfRange = outOfRange || tailOutOfRange ||
+                 _mm256_movemask_pd(rowOutOfRange) != 0;
+  }
+
+  return !outOfRange;
+}
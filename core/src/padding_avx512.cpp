@@ -0,0 +1,54 @@
+#include "padding.h"
+#include <cstring>
+#include <immintrin.h>
+
+/**
+ * @brief PadMatrixInRange() checking 8 pixels per compare with AVX-512. The
+ * end of each row is one masked block instead of a scalar loop.
+ */
+bool PadMatrixInRangeAVX512(const double *input, size_t stride, double *output,
+                            int width, int height, int padSize) {
+  int paddedWidth = width + 2 * padSize;
+  int paddedHeight = height + 2 * padSize;
+  int blockWidth = width - width % 8;
+  __mmask8 tailMask = (__mmask8)((1u << (width % 8)) - 1);
+  bool outOfRange = false;
+
+  std::memset(output, 0, paddedWidth * padSize * sizeof(double));
+  std::memset(output + (paddedHeight - padSize) * paddedWidth, 0,
+              paddedWidth * padSize * sizeof(double));
+
+  const __m512d low = _mm512_setzero_pd();
+  const __m512d high = _mm512_set1_pd(255.0);
+
+#pragma omp parallel for schedule(static) reduction(|| : outOfRange)
+  for (int i = 0; i < height; i++) {
+    const double *in = input + i * stride;
+    double *out = output + (i + padSize) * paddedWidth;
+
+    for (int j = 0; j < padSize; j++) {
+      out[j] = 0.0;
+      out[padSize + width + j] = 0.0;
+    }
+
+    __mmask8 rowOutOfRange = 0;
+    for (int j = 0; j < blockWidth; j += 8) {
+      __m512d pixels = _mm512_loadu_pd(&in[j]);
+      rowOutOfRange |= _mm512_cmp_pd_mask(pixels, low, _CMP_NGE_UQ) |
+                       _mm512_cmp_pd_mask(pixels, high, _CMP_NLE_UQ);
+      _mm512_storeu_pd(&out[padSize + j], pixels);
+    }
+
+    if (tailMask != 0) {
+      __m512d pixels = _mm512_maskz_loadu_pd(tailMask, &in[blockWidth]);
+      rowOutOfRange |=
+          _mm512_mask_cmp_pd_mask(tailMask, pixels, low, _CMP_NGE_UQ) |
+          _mm512_mask_cmp_pd_mask(tailMask, pixels, high, _CMP_NLE_UQ);
+      _mm512_mask_storeu_pd(&out[padSize + blockWidth], tailMask, pixels);
+    }
+
+    outOfRange = outOfRange || rowOutOfRange != 0;
+  }
+
+  return !outOfRange;
+}
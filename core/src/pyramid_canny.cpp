@@ -0,0 +1,232 @@
+#include "pyramid_canny.h"
+#include "canny_mask.h"
+#include "canny_pipeline.h"
+#include "gaussian_filter.h"
+#include "suppressed_region.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#define LABEL_NON_EDGE 0
+#define LABEL_WEAK_EDGE 1
+#define LABEL_STRONG_EDGE 2
+
+// Decimation filter, close to the 5-tap binomial of cv::pyrDown
+#define PYRAMID_KERNEL_SIZE 5
+#define PYRAMID_KERNEL_SIGMA 1.0
+
+#define PYRAMID_TILE_SIZE 64
+
+/**
+ * @brief Follow weak edges from `stack` over `labels` and write the edges of
+ * a level
+ */
+static void TrackLevelEdges(PyramidLevel &level,
+                            std::vector<unsigned char> &labels,
+                            std::vector<int> &stack, int upperThreshold) {
+  int width = level.width;
+  int height = level.height;
+
+  std::fill(level.edges.begin(), level.edges.end(), 0.0);
+  for (int idx : stack) {
+    level.edges[idx] = upperThreshold;
+  }
+
+  while (!stack.empty()) {
+    int idx = stack.back();
+    stack.pop_back();
+    int y = idx / width;
+    int x = idx % width;
+
+    for (int ny = std::max(0, y - 1); ny <= std::min(height - 1, y + 1); ny++) {
+      for (int nx = std::max(0, x - 1); nx <= std::min(width - 1, x + 1);
+           nx++) {
+        int nidx = ny * width + nx;
+        if (labels[nidx] == LABEL_WEAK_EDGE) {
+          labels[nidx] = LABEL_STRONG_EDGE;
+          level.edges[nidx] = upperThreshold;
+          stack.push_back(nidx);
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @brief Every level at once: the tiles of all levels share one dynamic
+ * schedule, largest level first
+ */
+static void DetectAllLevels(const double *input,
+                            std::vector<PyramidLevel> &levels,
+                            int lowerThreshold, int upperThreshold,
+                            int kernelSize, double sigma) {
+  int levelCount = (int)levels.size();
+  std::vector<std::pair<int, int>> work;
+  std::vector<std::vector<unsigned char>> labels(levelCount);
+  std::vector<std::vector<int>> stacks(levelCount);
+
+  for (int l = 0; l < levelCount; l++) {
+    int tilesX = (levels[l].width + PYRAMID_TILE_SIZE - 1) / PYRAMID_TILE_SIZE;
+    int tilesY = (levels[l].height + PYRAMID_TILE_SIZE - 1) / PYRAMID_TILE_SIZE;
+    for (int tile = 0; tile < tilesX * tilesY; tile++) {
+      work.emplace_back(l, tile);
+    }
+    labels[l].assign((size_t)levels[l].width * levels[l].height,
+                     LABEL_NON_EDGE);
+  }
+
+  // First tile with a pixel out of range, if any
+  size_t outOfRange = work.size();
+
+#pragma omp parallel reduction(min : outOfRange)
+  {
+    std::vector<double> scratch;
+    std::vector<double> suppressed;
+    std::vector<std::vector<int>> seeds(levelCount);
+
+#pragma omp for schedule(dynamic) nowait
+    for (size_t i = 0; i < work.size(); i++) {
+      const PyramidLevel &level = levels[work[i].first];
+      const double *image = work[i].first == 0 ? input : level.image.data();
+      int tilesX = (level.width + PYRAMID_TILE_SIZE - 1) / PYRAMID_TILE_SIZE;
+      int x0 = (work[i].second % tilesX) * PYRAMID_TILE_SIZE;
+      int y0 = (work[i].second / tilesX) * PYRAMID_TILE_SIZE;
+      int x1 = std::min(level.width, x0 + PYRAMID_TILE_SIZE);
+      int y1 = std::min(level.height, y0 + PYRAMID_TILE_SIZE);
+
+      suppressed.resize((size_t)(x1 - x0) * (y1 - y0));
+      if (!SuppressedGradientRegion(image, level.width, level.height,
+                                    level.width, x0, y0, x1, y1, kernelSize,
+                                    sigma, scratch, suppressed.data())) {
+        outOfRange = std::min(outOfRange, i);
+        continue;
+      }
+
+      std::vector<unsigned char> &levelLabels = labels[work[i].first];
+      for (int y = y0; y < y1; y++) {
+        const double *nmsRow = &suppressed[(size_t)(y - y0) * (x1 - x0)];
+        for (int x = x0; x < x1; x++) {
+          int idx = y * level.width + x;
+          if (nmsRow[x - x0] >= upperThreshold) {
+            levelLabels[idx] = LABEL_STRONG_EDGE;
+            seeds[work[i].first].push_back(idx);
+          } else if (nmsRow[x - x0] >= lowerThreshold) {
+            levelLabels[idx] = LABEL_WEAK_EDGE;
+          }
+        }
+      }
+    }
+
+#pragma omp critical
+    for (int l = 0; l < levelCount; l++) {
+      stacks[l].insert(stacks[l].end(), seeds[l].begin(), seeds[l].end());
+    }
+  }
+
+  // Only the input can be out of range, the coarser levels are clamped
+  if (outOfRange < work.size()) {
+    const PyramidLevel &level = levels[work[outOfRange].first];
+    const double *image =
+        work[outOfRange].first == 0 ? input : level.image.data();
+    int tilesX = (level.width + PYRAMID_TILE_SIZE - 1) / PYRAMID_TILE_SIZE;
+    int x0 = (work[outOfRange].second % tilesX) * PYRAMID_TILE_SIZE;
+    int y0 = (work[outOfRange].second / tilesX) * PYRAMID_TILE_SIZE;
+    ThrowRegionRangeError(image, level.width, level.height, level.width, x0,
+                          y0, std::min(level.width, x0 + PYRAMID_TILE_SIZE),
+                          std::min(level.height, y0 + PYRAMID_TILE_SIZE),
+                          kernelSize, "PyramidCanny");
+  }
+
+#pragma omp parallel for schedule(dynamic)
+  for (int l = 0; l < levelCount; l++) {
+    TrackLevelEdges(levels[l], labels[l], stacks[l], upperThreshold);
+  }
+}
+
+/**
+ * @brief Mask of the pixels of a level within `searchRadius` of an edge of
+ * the next, coarser level
+ */
+static CannyMask SearchRegion(const PyramidLevel &level,
+                              const PyramidLevel &coarser, int searchRadius) {
+  std::vector<unsigned char> selected((size_t)level.width * level.height, 0);
+
+  for (int cy = 0; cy < coarser.height; cy++) {
+    for (int cx = 0; cx < coarser.width; cx++) {
+      if (coarser.edges[(size_t)cy * coarser.width + cx] == 0) {
+        continue;
+      }
+
+      // A coarse pixel covers fine pixels (2cx, 2cy) to (2cx + 1, 2cy + 1)
+      int x0 = std::max(0, 2 * cx - searchRadius);
+      int x1 = std::min(level.width - 1, 2 * cx + 1 + searchRadius);
+      int y0 = std::max(0, 2 * cy - searchRadius);
+      int y1 = std::min(level.height - 1, 2 * cy + 1 + searchRadius);
+      for (int y = y0; y <= y1; y++) {
+        std::memset(&selected[(size_t)y * level.width + x0], 1, x1 - x0 + 1);
+      }
+    }
+  }
+
+  return CannyMask(selected.data(), level.width, level.height, level.width,
+                   PYRAMID_TILE_SIZE);
+}
+
+void PyramidCanny(const double *input, int width, int height, int levelCount,
+                  int lowerThreshold, int upperThreshold, int kernelSize,
+                  double sigma, int searchRadius,
+                  std::vector<PyramidLevel> &levels) {
+  if (width <= 0 || height <= 0 || levelCount <= 0) {
+    throw std::runtime_error("PyramidCanny failed: image size and level count "
+                             "must be positive");
+  }
+
+  levels.resize(levelCount);
+  for (int l = 0; l < levelCount; l++) {
+    PyramidLevel &level = levels[l];
+    level.width = l == 0 ? width : (levels[l - 1].width + 1) / 2;
+    level.height = l == 0 ? height : (levels[l - 1].height + 1) / 2;
+    level.edges.resize((size_t)level.width * level.height);
+    level.image.clear();
+
+    if (l > 0) {
+      const double *finer = l == 1 ? input : levels[l - 1].image.data();
+      level.image.resize((size_t)level.width * level.height);
+      GaussianDownsample(finer, level.image.data(), PYRAMID_KERNEL_SIZE,
+                         levels[l - 1].width, levels[l - 1].height,
+                         PYRAMID_KERNEL_SIGMA);
+
+      // Rounding can take a blur of 255s just past 255
+      for (double &pixel : level.image) {
+        pixel = std::min(255.0, std::max(0.0, pixel));
+      }
+    }
+  }
+
+  if (searchRadius < 0) {
+    DetectAllLevels(input, levels, lowerThreshold, upperThreshold, kernelSize,
+                    sigma);
+    return;
+  }
+
+  // Coarse to fine, each level searching around the edges of the last one
+  for (int l = levelCount - 1; l >= 0; l--) {
+    PyramidLevel &level = levels[l];
+    const double *image = l == 0 ? input : level.image.data();
+    std::vector<unsigned char> all;
+    if (l == levelCount - 1) {
+      all.assign((size_t)level.width * level.height, 1);
+    }
+    CannyMask mask = l == levelCount - 1
+                         ? CannyMask(all.data(), level.width, level.height,
+                                     level.width, PYRAMID_TILE_SIZE)
+                         : SearchRegion(level, levels[l + 1], searchRadius);
+
+    try {
+      MaskedCanny(image, level.width, mask, lowerThreshold, upperThreshold,
+                  kernelSize, sigma, level.edges.data());
+    } catch (const PixelRangeError &e) {
+      throw PixelRangeError("PyramidCanny", e.x, e.y, e.value);
+    }
+  }
+}
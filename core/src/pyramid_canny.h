@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+
+/**
+ * @brief One level of an image pyramid and its edges. Level 0 is the input
+ * resolution, every next level halves both dimensions (rounding up).
+ */
+struct PyramidLevel {
+  int width;
+  int height;
+  // Empty for level 0, which is read from the input
+  std::vector<double> image;
+  // upperThreshold for edges, 0 elsewhere
+  std::vector<double> edges;
+};
+
+/**
+ * @brief Canny edges of `levelCount` pyramid levels of a `width` x `height`
+ * image in [0, 255]. A pixel out of range throws a PixelRangeError.
+ *
+ * Levels are built with GaussianDownsample. By default all levels are cut
+ * into tiles that go through blur, gradient, suppression and thresholding in
+ * one parallel loop, so the small levels fill the cores left idle by the end
+ * of the large ones, and hysteresis then runs on every level in parallel.
+ *
+ * With `searchRadius` >= 0, levels are processed coarse to fine instead and
+ * each level only looks for edges within `searchRadius` pixels of an edge of
+ * the level below it (a coarser one); tiles with no such edge are skipped.
+ */
+void PyramidCanny(const double *input, int width, int height, int levelCount,
+                  int lowerThreshold, int upperThreshold, int kernelSize,
+                  double sigma, int searchRadius,
+                  std::vector<PyramidLevel> &levels);
@@ -0,0 +1,172 @@
+#include "streaming_canny.h"
+#include "canny_pipeline.h"
+#include "gaussian_filter.h"
+#include "gradient.h"
+#include "non_maxima_suppression.h"
+#include "padding.h"
+#include <algorithm>
+#include <stdexcept>
+
+#define LABEL_NON_EDGE 0
+#define LABEL_WEAK_EDGE 1
+#define LABEL_STRONG_EDGE 2
+
+StreamingCanny::StreamingCanny(int width, int lowerThreshold,
+                               int upperThreshold, int kernelSize,
+                               double sigma, RowCallback onRow,
+                               int hysteresisLookahead, int bandRows)
+    : width(width), lowerThreshold(lowerThreshold),
+      upperThreshold(upperThreshold), kernelSize(kernelSize), sigma(sigma),
+      onRow(std::move(onRow)), lookahead(std::max(1, hysteresisLookahead)),
+      bandRows(std::max(1, bandRows)) {
+  if (width <= 0 || kernelSize <= 0 || kernelSize % 2 == 0) {
+    throw std::runtime_error("StreamingCanny failed: width must be positive "
+                             "and the kernel size odd");
+  }
+}
+
+void StreamingCanny::PushRows(const double *rows, int count) {
+  if (finished) {
+    throw std::runtime_error("StreamingCanny failed: rows pushed after Finish");
+  }
+
+  // The rows are range checked as they are copied into the held input
+  ImageView<const double> view(rows, width, count);
+  size_t held = input.size();
+  input.resize(held + (size_t)count * width);
+  if (!PadMatrixInRange(view, input.data() + held, 0)) {
+    input.resize(held);
+    ThrowPixelRangeError(view, "StreamingCanny", 0, inputEnd);
+  }
+  inputEnd += count;
+
+  // A band can be finished once the rows below it cover the Gaussian, Sobel
+  // and suppression halos
+  int halo = kernelSize / 2 + 2;
+  while (inputEnd - halo - nextRow >= bandRows) {
+    ProcessBand(nextRow + bandRows, false);
+  }
+
+  // Drop the input rows no later band will read
+  int keepFrom = std::max(inputBase, nextRow - halo);
+  input.erase(input.begin(),
+              input.begin() + (size_t)(keepFrom - inputBase) * width);
+  inputBase = keepFrom;
+}
+
+void StreamingCanny::Finish() {
+  if (finished) {
+    return;
+  }
+  finished = true;
+
+  if (nextRow < inputEnd) {
+    ProcessBand(inputEnd, true);
+  }
+  EmitRows(nextRow);
+}
+
+/**
+ * @brief Compute the suppressed gradient of rows [nextRow, bandEnd) with the
+ * whole-image kernels. Each stage runs on a slice extended by its halo, and
+ * only the rows far enough from the cut edges are kept, so the result matches
+ * the whole-image pipeline exactly. The real top and bottom of the image keep
+ * the kernels' zero padding.
+ */
+void StreamingCanny::ProcessBand(int bandEnd, bool lastBand) {
+  int halfSize = kernelSize / 2;
+  int first = nextRow;
+
+  // Gaussian over input rows [inStart, inEnd), exact on [blurStart, blurEnd)
+  int inStart = std::max(0, first - 2 - halfSize);
+  int inEnd = lastBand ? inputEnd : bandEnd + 2 + halfSize;
+  int blurStart = std::max(0, first - 2);
+  int blurEnd = lastBand ? inEnd : bandEnd + 2;
+  // Sobel over the blurred rows, exact on [gradStart, gradEnd)
+  int gradStart = std::max(0, first - 1);
+  int gradEnd = lastBand ? inEnd : bandEnd + 1;
+
+  blurred.resize((size_t)(inEnd - inStart) * width);
+  GaussianFilter(&input[(size_t)(inStart - inputBase) * width], blurred.data(),
+                 kernelSize, width, inEnd - inStart, sigma);
+
+  gradient.resize((size_t)(blurEnd - blurStart) * width);
+  theta.resize((size_t)(blurEnd - blurStart) * width);
+  Gradient(&blurred[(size_t)(blurStart - inStart) * width], gradient.data(),
+           theta.data(), width, blurEnd - blurStart);
+
+  // Suppression leaves the border of its slice untouched. Those pixels are
+  // either the image border or halo rows that are not used.
+  size_t gradOffset = (size_t)(gradStart - blurStart) * width;
+  suppressed.assign((size_t)(gradEnd - gradStart) * width, 0.0);
+  NonMaxSuppression(&gradient[gradOffset], suppressed.data(),
+                    &theta[gradOffset], 3, width, gradEnd - gradStart);
+
+  TrackEdges(&suppressed[(size_t)(first - gradStart) * width], first, bandEnd);
+  nextRow = bandEnd;
+
+  EmitRows(std::max(labelBase, nextRow - lookahead));
+}
+
+/**
+ * @brief Threshold rows [firstRow, endRow) and run hysteresis over every row
+ * still held, so strong pixels in the new rows can also promote weak pixels
+ * in rows that are not emitted yet
+ */
+void StreamingCanny::TrackEdges(const double *nms, int firstRow, int endRow) {
+  size_t offset = (size_t)(firstRow - labelBase) * width;
+  size_t count = (size_t)(endRow - firstRow) * width;
+  labels.resize(offset + count);
+
+  for (size_t i = 0; i < count; i++) {
+    double value = nms[i];
+    labels[offset + i] = value >= upperThreshold   ? LABEL_STRONG_EDGE
+                         : value >= lowerThreshold ? LABEL_WEAK_EDGE
+                                                   : LABEL_NON_EDGE;
+  }
+
+  // Seed from the new rows and the row above them, which may touch weak
+  // pixels that just arrived
+  int rows = endRow - labelBase;
+  int seedRow = std::max(labelBase, firstRow - 1) - labelBase;
+  stack.clear();
+  for (size_t i = (size_t)seedRow * width; i < labels.size(); i++) {
+    if (labels[i] == LABEL_STRONG_EDGE) {
+      stack.push_back((int)i);
+    }
+  }
+
+  while (!stack.empty()) {
+    int idx = stack.back();
+    stack.pop_back();
+    int y = idx / width;
+    int x = idx % width;
+
+    for (int ny = std::max(0, y - 1); ny <= std::min(rows - 1, y + 1); ny++) {
+      for (int nx = std::max(0, x - 1); nx <= std::min(width - 1, x + 1);
+           nx++) {
+        int nidx = ny * width + nx;
+        if (labels[nidx] == LABEL_WEAK_EDGE) {
+          labels[nidx] = LABEL_STRONG_EDGE;
+          stack.push_back(nidx);
+        }
+      }
+    }
+  }
+}
+
+void StreamingCanny::EmitRows(int until) {
+  edgeRow.resize(width);
+
+  for (int row = labelBase; row < until; row++) {
+    const unsigned char *labelRow = &labels[(size_t)(row - labelBase) * width];
+    for (int x = 0; x < width; x++) {
+      edgeRow[x] = labelRow[x] == LABEL_STRONG_EDGE ? upperThreshold : 0.0;
+    }
+    onRow(row, edgeRow.data());
+  }
+
+  labels.erase(labels.begin(),
+               labels.begin() + (size_t)(until - labelBase) * width);
+  labelBase = until;
+}
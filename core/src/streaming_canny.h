@@ -0,0 +1,81 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+/**
+ * @brief Canny edge detection for images delivered as horizontal bands of
+ * rows, e.g. from a line scanner, that are too large to hold in memory.
+ *
+ * Only a rolling window of rows is kept: the input rows the Gaussian and Sobel
+ * halos still need, one band of intermediate buffers, and the edge labels of
+ * the last `hysteresisLookahead` rows. Peak memory is O(width * window) and
+ * does not depend on the image height.
+ *
+ * Finished edge rows are handed to `onRow` in order, with the same values as
+ * FastCanny (upperThreshold for edges, 0 otherwise). A row is finished once
+ * `hysteresisLookahead` more rows have been thresholded, so a weak edge is
+ * kept if it reaches a strong pixel at most that many rows further down (or
+ * anywhere above). Pass a lookahead >= the image height for results identical
+ * to the whole-image pipeline.
+ */
+class StreamingCanny {
+public:
+  using RowCallback = std::function<void(int row, const double *edges)>;
+
+  StreamingCanny(int width, int lowerThreshold, int upperThreshold,
+                 int kernelSize, double sigma, RowCallback onRow,
+                 int hysteresisLookahead = 64, int bandRows = 64);
+
+  /**
+   * @brief Append `count` rows of `width` pixels in [0, 255], stored
+   * contiguously. Rows are processed once a full band is available. A pixel
+   * out of range throws a PixelRangeError with its row in the stream, and
+   * none of the rows are kept.
+   */
+  void PushRows(const double *rows, int count);
+
+  /**
+   * @brief Mark the end of the image and emit every remaining row. No rows can
+   * be pushed afterwards.
+   */
+  void Finish();
+
+  int RowsPushed() const { return inputEnd; }
+  int RowsEmitted() const { return labelBase; }
+
+private:
+  void ProcessBand(int bandEnd, bool lastBand);
+  void TrackEdges(const double *nms, int firstRow, int endRow);
+  void EmitRows(int until);
+
+  int width;
+  int lowerThreshold;
+  int upperThreshold;
+  int kernelSize;
+  double sigma;
+  RowCallback onRow;
+  int lookahead;
+  int bandRows;
+  bool finished = false;
+
+  // Input rows [inputBase, inputEnd) still needed by the filter halos
+  std::vector<double> input;
+  int inputBase = 0;
+  int inputEnd = 0;
+
+  // First row whose non-maxima suppression output is not computed yet
+  int nextRow = 0;
+
+  // Per-band scratch buffers, reused across bands
+  std::vector<double> blurred;
+  std::vector<double> gradient;
+  std::vector<double> theta;
+  std::vector<double> suppressed;
+
+  // Edge labels of rows [labelBase, nextRow) that are not emitted yet
+  std::vector<unsigned char> labels;
+  int labelBase = 0;
+  std::vector<int> stack;
+  std::vector<double> edgeRow;
+};
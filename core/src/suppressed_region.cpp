@@ -0,0 +1,78 @@
+#include "suppressed_region.h"
+#include "canny_pipeline.h"
+#include "gaussian_filter.h"
+#include "gradient.h"
+#include "non_maxima_suppression.h"
+#include <algorithm>
+#include <cstring>
+
+/**
+ * @brief The pixels the kernels read for [x0, x1) x [y0, y1): the rectangle
+ * grown by the Gaussian radius, then one pixel each for Sobel and
+ * suppression. Its top left corner is (sliceX, sliceY).
+ */
+static ImageView<const double> RegionSlice(const double *image, int width,
+                                           int height, size_t stride, int x0,
+                                           int y0, int x1, int y1,
+                                           int kernelSize, int *sliceX,
+                                           int *sliceY) {
+  int halo = kernelSize / 2 + 2;
+  *sliceX = std::max(0, x0 - halo);
+  *sliceY = std::max(0, y0 - halo);
+  return ImageView<const double>(&image[(size_t)*sliceY * stride + *sliceX],
+                                 std::min(width, x1 + halo) - *sliceX,
+                                 std::min(height, y1 + halo) - *sliceY,
+                                 stride);
+}
+
+bool SuppressedGradientRegion(const double *image, int width, int height,
+                              size_t stride, int x0, int y0, int x1, int y1,
+                              int kernelSize, double sigma,
+                              std::vector<double> &scratch, double *output) {
+  int sliceX;
+  int sliceY;
+  ImageView<const double> slice = RegionSlice(
+      image, width, height, stride, x0, y0, x1, y1, kernelSize, &sliceX,
+      &sliceY);
+  int sliceWidth = slice.width;
+  int sliceHeight = slice.height;
+  size_t sliceSize = (size_t)sliceWidth * sliceHeight;
+
+  scratch.resize(4 * sliceSize);
+  double *blurred = scratch.data();
+  double *gradient = blurred + sliceSize;
+  double *theta = gradient + sliceSize;
+  double *suppressed = theta + sliceSize;
+
+  // The blur reads the slice straight from the image and checks its range
+  // while padding it
+  bool inRange = true;
+  GaussianFilter(slice, blurred, kernelSize, sigma, &inRange);
+  if (!inRange) {
+    return false;
+  }
+
+  Gradient(blurred, gradient, theta, sliceWidth, sliceHeight);
+  // Suppression leaves the slice border untouched, which is either the image
+  // border or halo that is not used
+  std::fill(suppressed, suppressed + sliceSize, 0.0);
+  NonMaxSuppression(gradient, suppressed, theta, 3, sliceWidth, sliceHeight);
+
+  for (int y = y0; y < y1; y++) {
+    std::memcpy(&output[(size_t)(y - y0) * (x1 - x0)],
+                &suppressed[(size_t)(y - sliceY) * sliceWidth + (x0 - sliceX)],
+                (x1 - x0) * sizeof(double));
+  }
+  return true;
+}
+
+void ThrowRegionRangeError(const double *image, int width, int height,
+                           size_t stride, int x0, int y0, int x1, int y1,
+                           int kernelSize, const char *caller) {
+  int sliceX;
+  int sliceY;
+  ImageView<const double> slice = RegionSlice(
+      image, width, height, stride, x0, y0, x1, y1, kernelSize, &sliceX,
+      &sliceY);
+  ThrowPixelRangeError(slice, caller, sliceX, sliceY);
+}
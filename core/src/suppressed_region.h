@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Non-maxima suppressed gradient of the rectangle [x0, x1) x [y0, y1)
+ * of a `width` x `height` image with `stride` doubles per row.
+ *
+ * Blur, gradient and suppression run on the rectangle grown by their combined
+ * halo, read from the image itself, so the result equals the whole-image
+ * pipeline. The real image border keeps the kernels' zero padding and is 0 in
+ * the output. Writes (x1 - x0) * (y1 - y0) values to `output`; `scratch` is
+ * resized as needed and can be reused across calls.
+ *
+ * Returns false, leaving `output` untouched, if a pixel read is outside
+ * [0, 255] or NaN. The check is fused into the padding of the blur.
+ */
+bool SuppressedGradientRegion(const double *image, int width, int height,
+                              size_t stride, int x0, int y0, int x1, int y1,
+                              int kernelSize, double sigma,
+                              std::vector<double> &scratch, double *output);
+
+/**
+ * @brief Throw the PixelRangeError of a rectangle SuppressedGradientRegion
+ * returned false for, naming the first bad pixel it read in image
+ * coordinates
+ */
+[[noreturn]] void ThrowRegionRangeError(const double *image, int width,
+                                        int height, size_t stride, int x0,
+                                        int y0, int x1, int y1, int kernelSize,
+                                        const char *caller);
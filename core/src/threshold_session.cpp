@@ -0,0 +1,70 @@
+#include "threshold_session.h"
+#include "suppressed_region.h"
+#include <algorithm>
+#include <stdexcept>
+
+ThresholdSweep ThresholdSession::Prepare(const double *image, int width,
+                                         int height, int kernelSize,
+                                         double sigma, int minLowerThreshold) {
+  if (width <= 0 || height <= 0 || kernelSize <= 0 || kernelSize % 2 == 0) {
+    throw std::runtime_error("ThresholdSession failed: image size must be "
+                             "positive and the kernel size odd");
+  }
+
+  std::vector<double> scratch;
+  std::vector<double> suppressed((size_t)width * height);
+  if (!SuppressedGradientRegion(image, width, height, width, 0, 0, width,
+                                height, kernelSize, sigma, scratch,
+                                suppressed.data())) {
+    ThrowRegionRangeError(image, width, height, width, 0, 0, width, height,
+                          kernelSize, "ThresholdSession");
+  }
+
+  return ThresholdSweep(suppressed.data(), width, height, minLowerThreshold);
+}
+
+ThresholdSession::ThresholdSession(const double *image, int width, int height,
+                                   int kernelSize, double sigma,
+                                   int minLowerThreshold)
+    : sweep(Prepare(image, width, height, kernelSize, sigma,
+                    minLowerThreshold)),
+      edges((size_t)width * height, 0) {}
+
+const unsigned char *ThresholdSession::Edges(int lowerThreshold,
+                                             int upperThreshold) {
+  sweep.EdgeRanges(lowerThreshold, upperThreshold, nextRanges);
+
+  // Most edges are shared by the two threshold pairs, only the difference
+  // needs writing
+  WriteDifference(ranges, nextRanges, 0);
+  WriteDifference(nextRanges, ranges, 255);
+
+  ranges.swap(nextRanges);
+  return edges.data();
+}
+
+void ThresholdSession::WriteDifference(
+    const std::vector<ThresholdSweep::EdgeRange> &from,
+    const std::vector<ThresholdSweep::EdgeRange> &without,
+    unsigned char value) {
+  size_t j = 0;
+  for (const ThresholdSweep::EdgeRange &range : from) {
+    int at = range.begin;
+    while (j < without.size() && without[j].end <= at) {
+      j++;
+    }
+
+    // Both lists are sorted, so the ranges to skip over are the next ones
+    for (size_t k = j; k < without.size() && without[k].begin < range.end;
+         k++) {
+      for (; at < without[k].begin; at++) {
+        edges[sweep.Pixel(at)] = value;
+      }
+      at = std::max(at, without[k].end);
+    }
+
+    for (; at < range.end; at++) {
+      edges[sweep.Pixel(at)] = value;
+    }
+  }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "threshold_sweep.h"
+#include <vector>
+
+/**
+ * @brief Canny edges of one image for thresholds that change interactively,
+ * e.g. from sliders.
+ *
+ * Blur, gradient and suppression run once in the constructor, which keeps
+ * only the candidate pixels of the suppressed gradient, in a ThresholdSweep
+ * tree, rather than the double image. A threshold change re-runs only
+ * thresholding and hysteresis on that tree, and the edge mask is updated in
+ * place by writing just the pixels whose state changed.
+ */
+class ThresholdSession {
+public:
+  /**
+   * @brief Prepare `width * height` pixels in [0, 255], or throw a
+   * PixelRangeError. Lower thresholds
+   * below `minLowerThreshold` cannot be used later, smaller values keep more
+   * candidates.
+   */
+  ThresholdSession(const double *image, int width, int height, int kernelSize,
+                   double sigma, int minLowerThreshold = 1);
+
+  /**
+   * @brief Edge mask for one threshold pair, 255 for edges and 0 elsewhere,
+   * `width * height` bytes. The returned buffer belongs to the session and is
+   * updated in place by the next call.
+   */
+  const unsigned char *Edges(int lowerThreshold, int upperThreshold);
+
+  int Width() const { return sweep.Width(); }
+  int Height() const { return sweep.Height(); }
+
+private:
+  static ThresholdSweep Prepare(const double *image, int width, int height,
+                                int kernelSize, double sigma,
+                                int minLowerThreshold);
+  // Set the tree positions in `from` but not in `without` to `value`
+  void WriteDifference(const std::vector<ThresholdSweep::EdgeRange> &from,
+                       const std::vector<ThresholdSweep::EdgeRange> &without,
+                       unsigned char value);
+
+  ThresholdSweep sweep;
+  std::vector<unsigned char> edges;
+  // Edges currently in the mask, and those of the new thresholds
+  std::vector<ThresholdSweep::EdgeRange> ranges;
+  std::vector<ThresholdSweep::EdgeRange> nextRanges;
+};
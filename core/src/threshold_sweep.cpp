@@ -0,0 +1,209 @@
+#include "threshold_sweep.h"
+#include "gradient.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+// Suppressed magnitudes never exceed the gradient's
+#define MAX_LEVEL (GRADIENT_HISTOGRAM_BINS - 1)
+// Tree nodes per entry of blockMax
+#define SWEEP_BLOCK 64
+
+static int FindRoot(std::vector<int> &sets, int rank) {
+  while (sets[rank] != rank) {
+    sets[rank] = sets[sets[rank]];
+    rank = sets[rank];
+  }
+  return rank;
+}
+
+ThresholdSweep::ThresholdSweep(const double *suppressed, int width, int height,
+                               int minLowerThreshold)
+    : width(width), height(height),
+      minLevel(std::max(0, std::min(minLowerThreshold, MAX_LEVEL + 1))) {
+  if (width <= 0 || height <= 0) {
+    throw std::runtime_error("ThresholdSweep failed: image size must be "
+                             "positive");
+  }
+
+  int size = width * height;
+  std::vector<int> levelCount(MAX_LEVEL + 2, 0);
+  std::vector<int> rankOf(size, -1);
+
+  // Integer levels let a counting sort order the candidates
+  for (int i = 0; i < size; i++) {
+    int pixelLevel = std::min((int)suppressed[i], MAX_LEVEL);
+    if (pixelLevel >= minLevel) {
+      levelCount[pixelLevel]++;
+    }
+  }
+
+  std::vector<int> countAtLeast(MAX_LEVEL + 2, 0);
+  for (int l = MAX_LEVEL; l >= 0; l--) {
+    countAtLeast[l] = countAtLeast[l + 1] + levelCount[l];
+  }
+
+  // Rank candidates by decreasing magnitude
+  int candidates = countAtLeast[0];
+  std::vector<int> order(candidates);
+  std::vector<unsigned short> level(candidates);
+  // Next free rank of each level, the strongest level comes first
+  std::vector<int> next(MAX_LEVEL + 1);
+  for (int l = 0; l <= MAX_LEVEL; l++) {
+    next[l] = countAtLeast[l + 1];
+  }
+
+  for (int i = 0; i < size; i++) {
+    int pixelLevel = std::min((int)suppressed[i], MAX_LEVEL);
+    if (pixelLevel >= minLevel) {
+      int rank = next[pixelLevel]++;
+      order[rank] = i;
+      level[rank] = (unsigned short)pixelLevel;
+      rankOf[i] = rank;
+    }
+  }
+
+  // Add the pixels from the strongest down, with a union-find of the
+  // components seen so far. `node` is the newest pixel of each component,
+  // which the next pixel joining it adopts as a child.
+  std::vector<int> parent(candidates, -1);
+  std::vector<unsigned short> subtreeMax(level);
+  std::vector<int> sets(candidates);
+  std::vector<int> node(candidates);
+  std::vector<int> setSize(candidates, 1);
+
+  for (int rank = 0; rank < candidates; rank++) {
+    sets[rank] = rank;
+    node[rank] = rank;
+    int y = order[rank] / width;
+    int x = order[rank] % width;
+
+    for (int ny = std::max(0, y - 1); ny <= std::min(height - 1, y + 1); ny++) {
+      for (int nx = std::max(0, x - 1); nx <= std::min(width - 1, x + 1);
+           nx++) {
+        int neighbor = rankOf[ny * width + nx];
+        if (neighbor < 0 || neighbor >= rank) {
+          continue;
+        }
+
+        int joined = FindRoot(sets, neighbor);
+        int root = FindRoot(sets, rank);
+        if (joined == root) {
+          continue;
+        }
+
+        int child = node[joined];
+        parent[child] = rank;
+        subtreeMax[rank] = std::max(subtreeMax[rank], subtreeMax[child]);
+
+        if (setSize[joined] > setSize[root]) {
+          std::swap(joined, root);
+        }
+        sets[joined] = root;
+        setSize[root] += setSize[joined];
+        node[root] = rank;
+      }
+    }
+  }
+
+  // Lay the tree out in preorder so every subtree is one range. Children
+  // have lower ranks than their parent, so ascending ranks total the subtree
+  // sizes and descending ranks place parents before their children.
+  std::vector<int> sizeOf(candidates, 1);
+  for (int rank = 0; rank < candidates; rank++) {
+    if (parent[rank] >= 0) {
+      sizeOf[parent[rank]] += sizeOf[rank];
+    }
+  }
+
+  std::vector<int> position(candidates);
+  std::vector<int> nextChild(candidates);
+  int nextRoot = 0;
+  for (int rank = candidates - 1; rank >= 0; rank--) {
+    int up = parent[rank];
+    if (up < 0) {
+      position[rank] = nextRoot;
+      nextRoot += sizeOf[rank];
+    } else {
+      position[rank] = nextChild[up];
+      nextChild[up] += sizeOf[rank];
+    }
+    nextChild[rank] = position[rank] + 1;
+  }
+
+  pixels.resize(candidates);
+  levels.resize(candidates);
+  maxLevels.resize(candidates);
+  sizes.resize(candidates);
+  for (int rank = 0; rank < candidates; rank++) {
+    int at = position[rank];
+    pixels[at] = order[rank];
+    levels[at] = level[rank];
+    maxLevels[at] = subtreeMax[rank];
+    sizes[at] = sizeOf[rank];
+  }
+
+  // A last node above every threshold stops the scans in EdgeRanges
+  levels.push_back(MAX_LEVEL + 1);
+  blockMax.assign(candidates / SWEEP_BLOCK + 1, 0);
+  for (int at = 0; at <= candidates; at++) {
+    unsigned short &max = blockMax[at / SWEEP_BLOCK];
+    max = std::max(max, levels[at]);
+  }
+}
+
+void ThresholdSweep::Edges(int lowerThreshold, int upperThreshold,
+                           double *output) const {
+  std::vector<EdgeRange> ranges;
+  EdgeRanges(lowerThreshold, upperThreshold, ranges);
+
+  std::memset(output, 0, (size_t)width * height * sizeof(double));
+  for (const EdgeRange &range : ranges) {
+    for (int at = range.begin; at < range.end; at++) {
+      output[pixels[at]] = upperThreshold;
+    }
+  }
+}
+
+void ThresholdSweep::EdgeRanges(int lowerThreshold, int upperThreshold,
+                                std::vector<EdgeRange> &ranges) const {
+  // With low > high every pixel >= high is already strong, and no magnitude
+  // is below 0
+  lowerThreshold = std::max(0, std::min(lowerThreshold, upperThreshold));
+  if (lowerThreshold < minLevel) {
+    throw std::runtime_error("ThresholdSweep failed: lower threshold below "
+                             "the one the sweep was built for");
+  }
+
+  ranges.clear();
+  if (lowerThreshold > MAX_LEVEL) {
+    return;
+  }
+
+  // Magnitudes only grow down the tree and ancestors come first in preorder,
+  // so the first node >= lowerThreshold after nodes below it tops a
+  // component of the thresholded image, made of its whole subtree. The
+  // component is an edge if it reaches upperThreshold.
+  int count = (int)sizes.size();
+  int at = 0;
+  while (true) {
+    // Skip the nodes below lowerThreshold, with their subtree if it cannot
+    // reach upperThreshold, and whole blocks of them at once
+    while (levels[at] < lowerThreshold) {
+      at += maxLevels[at] < upperThreshold ? sizes[at] : 1;
+      if (at % SWEEP_BLOCK == 0) {
+        while (blockMax[at / SWEEP_BLOCK] < lowerThreshold) {
+          at += SWEEP_BLOCK;
+        }
+      }
+    }
+    if (at >= count) {
+      break;
+    }
+
+    if (maxLevels[at] >= upperThreshold) {
+      ranges.push_back({at, at + sizes[at]});
+    }
+    at += sizes[at];
+  }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+
+/**
+ * @brief Double thresholding and hysteresis of one suppressed gradient image
+ * for any number of (low, high) threshold pairs.
+ *
+ * A pixel is an edge for (low, high) when the 8-connected component of pixels
+ * >= low around it reaches a pixel >= high. The constructor builds, once, the
+ * tree of those components over all thresholds: pixels are added from the
+ * strongest down and each one becomes the parent of the components it joins.
+ * The tree is stored in preorder, so every component is one range of it, and
+ * a pair only looks for the tops of its components instead of flood filling
+ * the image.
+ *
+ * Magnitudes are compared at integer precision, which is exact for the
+ * integer thresholds FastCanny takes.
+ */
+class ThresholdSweep {
+public:
+  /**
+   * @brief Build the tree of a `width` x `height` suppressed gradient image.
+   * Pixels below `minLowerThreshold` are left out, no pair may use a lower
+   * threshold under it.
+   */
+  ThresholdSweep(const double *suppressed, int width, int height,
+                 int minLowerThreshold = 1);
+
+  /**
+   * @brief Write the edges for one threshold pair, upperThreshold for edges
+   * and 0 elsewhere, to `width * height` doubles
+   */
+  void Edges(int lowerThreshold, int upperThreshold, double *output) const;
+
+  // Range [begin, end) of the tree, see Pixel()
+  struct EdgeRange {
+    int begin;
+    int end;
+  };
+
+  /**
+   * @brief Replace `ranges` with the edges for one threshold pair, as sorted
+   * and disjoint ranges of the tree
+   */
+  void EdgeRanges(int lowerThreshold, int upperThreshold,
+                  std::vector<EdgeRange> &ranges) const;
+
+  // Image index (y * width + x) of a position in the tree
+  int Pixel(int at) const { return pixels[at]; }
+
+  int Width() const { return width; }
+  int Height() const { return height; }
+
+private:
+  int width;
+  int height;
+  int minLevel;
+
+  // Tree in preorder: image index and magnitude of each node, and the size
+  // and largest magnitude of its subtree
+  std::vector<int> pixels;
+  std::vector<unsigned short> levels;
+  std::vector<unsigned short> maxLevels;
+  std::vector<int> sizes;
+  // Largest magnitude of each block of nodes
+  std::vector<unsigned short> blockMax;
+};
@@ -0,0 +1,224 @@
+#include "video_canny.h"
+#include "canny_pipeline.h"
+#include "suppressed_region.h"
+#include <algorithm>
+#include <cstring>
+#include <omp.h>
+#include <stdexcept>
+
+#define LABEL_NON_EDGE 0
+#define LABEL_WEAK_EDGE 1
+#define LABEL_STRONG_EDGE 2
+#define LABEL_VISITED 4
+
+VideoCanny::VideoCanny(int width, int height, int lowerThreshold,
+                       int upperThreshold, int kernelSize, double sigma,
+                       int tileSize)
+    : width(width), height(height), lowerThreshold(lowerThreshold),
+      upperThreshold(upperThreshold), kernelSize(kernelSize), sigma(sigma) {
+  if (width <= 0 || height <= 0 || kernelSize <= 0 || kernelSize % 2 == 0) {
+    throw std::runtime_error("VideoCanny failed: frame size must be positive "
+                             "and the kernel size odd");
+  }
+
+  // A changed pixel moves the suppressed gradient up to the Gaussian radius
+  // plus the Sobel and suppression halos away, tiles at least that large keep
+  // the effect within the neighbouring tiles
+  this->tileSize = std::max(tileSize, kernelSize / 2 + 2);
+  tilesX = (width + this->tileSize - 1) / this->tileSize;
+  tilesY = (height + this->tileSize - 1) / this->tileSize;
+
+  size_t size = (size_t)width * height;
+  previous.resize(size);
+  labels.assign(size, LABEL_NON_EDGE);
+  edges.assign(size, 0.0);
+  changed.resize((size_t)tilesX * tilesY);
+}
+
+const double *VideoCanny::ProcessFrame(const double *frame) {
+  int tiles = tilesX * tilesY;
+  bool outOfRange = false;
+
+  // Compare each tile with the previous frame. memcmp is vectorized by the C
+  // library and stops at the first difference. Only changed rows need the
+  // range check, the others were validated with an earlier frame.
+#pragma omp parallel for schedule(dynamic) reduction(|| : outOfRange)
+  for (int tile = 0; tile < tiles; tile++) {
+    int x0 = (tile % tilesX) * tileSize;
+    int y0 = (tile / tilesX) * tileSize;
+    int x1 = std::min(width, x0 + tileSize);
+    int y1 = std::min(height, y0 + tileSize);
+    bool differs = !hasFrame;
+
+    for (int y = y0; y < y1; y++) {
+      const double *row = &frame[(size_t)y * width + x0];
+      if (!differs &&
+          std::memcmp(row, &previous[(size_t)y * width + x0],
+                      (x1 - x0) * sizeof(double)) != 0) {
+        differs = true;
+      }
+      if (differs) {
+        for (int x = 0; x < x1 - x0; x++) {
+          outOfRange = outOfRange || !(row[x] >= 0 && row[x] <= 255);
+        }
+      }
+    }
+
+    changed[tile] = differs;
+  }
+
+  // The unchanged tiles passed with an earlier frame, so the first pixel out
+  // of range is in a changed one
+  if (outOfRange) {
+    ThrowPixelRangeError(ImageView<const double>(frame, width, height),
+                         "VideoCanny");
+  }
+  hasFrame = true;
+
+  // Keep the changed tiles and list every tile within one tile of them
+  recompute.clear();
+  changedTiles = 0;
+  for (int tile = 0; tile < tiles; tile++) {
+    int tx = tile % tilesX;
+    int ty = tile / tilesX;
+    bool dirty = false;
+
+    for (int ny = std::max(0, ty - 1); ny <= std::min(tilesY - 1, ty + 1);
+         ny++) {
+      for (int nx = std::max(0, tx - 1); nx <= std::min(tilesX - 1, tx + 1);
+           nx++) {
+        dirty = dirty || changed[ny * tilesX + nx];
+      }
+    }
+
+    if (dirty) {
+      recompute.push_back(tile);
+    }
+    if (changed[tile]) {
+      changedTiles++;
+      int x0 = tx * tileSize;
+      int y0 = ty * tileSize;
+      int x1 = std::min(width, x0 + tileSize);
+      for (int y = y0; y < std::min(height, y0 + tileSize); y++) {
+        std::memcpy(&previous[(size_t)y * width + x0],
+                    &frame[(size_t)y * width + x0],
+                    (x1 - x0) * sizeof(double));
+      }
+    }
+  }
+
+  if (recompute.empty()) {
+    return edges.data();
+  }
+
+  // The kernels' own parallel loops run single threaded inside this region
+  size_t threads = std::max(scratch.size(), (size_t)omp_get_max_threads());
+  scratch.resize(threads);
+  suppressed.resize(threads);
+#pragma omp parallel for schedule(dynamic)
+  for (size_t i = 0; i < recompute.size(); i++) {
+    int thread = omp_get_thread_num();
+    RecomputeTile(recompute[i], scratch[thread], suppressed[thread]);
+  }
+
+  TrackEdges();
+  return edges.data();
+}
+
+/**
+ * @brief Threshold the suppressed gradient of one tile, computed from the tile
+ * and its halo so it matches the whole-image pipeline
+ */
+void VideoCanny::RecomputeTile(int tile, std::vector<double> &scratch,
+                               std::vector<double> &suppressed) {
+  int x0 = (tile % tilesX) * tileSize;
+  int y0 = (tile / tilesX) * tileSize;
+  int x1 = std::min(width, x0 + tileSize);
+  int y1 = std::min(height, y0 + tileSize);
+
+  // The pixels were range checked by ProcessFrame
+  suppressed.resize((size_t)(x1 - x0) * (y1 - y0));
+  SuppressedGradientRegion(previous.data(), width, height, width, x0, y0, x1,
+                           y1, kernelSize, sigma, scratch, suppressed.data());
+
+  for (int y = y0; y < y1; y++) {
+    const double *nmsRow = &suppressed[(size_t)(y - y0) * (x1 - x0)];
+    unsigned char *labelRow = &labels[(size_t)y * width + x0];
+    double *edgeRow = &edges[(size_t)y * width + x0];
+
+    for (int x = 0; x < x1 - x0; x++) {
+      double value = nmsRow[x];
+      labelRow[x] = value >= upperThreshold   ? LABEL_STRONG_EDGE
+                    : value >= lowerThreshold ? LABEL_WEAK_EDGE
+                                              : LABEL_NON_EDGE;
+      // Edges of the tile are rebuilt by TrackEdges
+      edgeRow[x] = 0.0;
+    }
+  }
+}
+
+/**
+ * @brief Re-run hysteresis on every edge component that has a pixel in a
+ * recomputed tile or right next to one. Any other component has the same
+ * pixels and labels as in the previous frame, so its edges are still valid.
+ */
+void VideoCanny::TrackEdges() {
+  component.clear();
+
+  for (int tile : recompute) {
+    int x0 = std::max(0, (tile % tilesX) * tileSize - 1);
+    int y0 = std::max(0, (tile / tilesX) * tileSize - 1);
+    int x1 = std::min(width, (tile % tilesX + 1) * tileSize + 1);
+    int y1 = std::min(height, (tile / tilesX + 1) * tileSize + 1);
+
+    for (int y = y0; y < y1; y++) {
+      for (int x = x0; x < x1; x++) {
+        int seed = y * width + x;
+        if (labels[seed] != LABEL_WEAK_EDGE &&
+            labels[seed] != LABEL_STRONG_EDGE) {
+          continue;
+        }
+
+        // Collect the whole component, then mark it as edge if any of its
+        // pixels is strong
+        size_t first = component.size();
+        bool strong = false;
+        labels[seed] |= LABEL_VISITED;
+        component.push_back(seed);
+        stack.assign(1, seed);
+
+        while (!stack.empty()) {
+          int idx = stack.back();
+          stack.pop_back();
+          strong =
+              strong || (labels[idx] & ~LABEL_VISITED) == LABEL_STRONG_EDGE;
+          int cy = idx / width;
+          int cx = idx % width;
+
+          for (int ny = std::max(0, cy - 1); ny <= std::min(height - 1, cy + 1);
+               ny++) {
+            for (int nx = std::max(0, cx - 1);
+                 nx <= std::min(width - 1, cx + 1); nx++) {
+              int nidx = ny * width + nx;
+              if (labels[nidx] == LABEL_WEAK_EDGE ||
+                  labels[nidx] == LABEL_STRONG_EDGE) {
+                labels[nidx] |= LABEL_VISITED;
+                component.push_back(nidx);
+                stack.push_back(nidx);
+              }
+            }
+          }
+        }
+
+        double value = strong ? upperThreshold : 0.0;
+        for (size_t i = first; i < component.size(); i++) {
+          edges[component[i]] = value;
+        }
+      }
+    }
+  }
+
+  for (int idx : component) {
+    labels[idx] &= ~LABEL_VISITED;
+  }
+}
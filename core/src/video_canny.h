@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+
+/**
+ * @brief Canny edge detection for a sequence of same-sized frames, e.g. from a
+ * fixed camera, where most of each frame equals the previous one.
+ *
+ * Each frame is compared with the previous one tile by tile. Only tiles next
+ * to a changed tile go through blur, gradient, suppression and thresholding
+ * again, each on a slice extended by the filter halos so the result matches
+ * the whole-image pipeline. Hysteresis is then re-run only on the edge
+ * components that touch those tiles; every other edge is reused.
+ *
+ * Edges have the same values as FastCanny (upperThreshold or 0). The image
+ * border, which non-maxima suppression never writes, is always 0.
+ */
+class VideoCanny {
+public:
+  VideoCanny(int width, int height, int lowerThreshold, int upperThreshold,
+             int kernelSize, double sigma, int tileSize = 32);
+
+  /**
+   * @brief Detect the edges of the next frame of `width * height` pixels in
+   * [0, 255]. The returned buffer belongs to the session and is updated in
+   * place by the next call. A frame with a pixel out of range throws a
+   * PixelRangeError and leaves the session as it was.
+   */
+  const double *ProcessFrame(const double *frame);
+
+  // Statistics of the last frame
+  int ChangedTiles() const { return changedTiles; }
+  int RecomputedTiles() const { return (int)recompute.size(); }
+  int TileCount() const { return tilesX * tilesY; }
+
+private:
+  void RecomputeTile(int tile, std::vector<double> &scratch,
+                     std::vector<double> &suppressed);
+  void TrackEdges();
+
+  int width;
+  int height;
+  int lowerThreshold;
+  int upperThreshold;
+  int kernelSize;
+  double sigma;
+  int tileSize;
+  int tilesX;
+  int tilesY;
+  bool hasFrame = false;
+
+  // Last frame, its threshold labels and its edges
+  std::vector<double> previous;
+  std::vector<unsigned char> labels;
+  std::vector<double> edges;
+
+  // Per-frame bookkeeping, reused across frames
+  std::vector<unsigned char> changed;
+  std::vector<int> recompute;
+  int changedTiles = 0;
+  std::vector<std::vector<double>> scratch;
+  std::vector<std::vector<double>> suppressed;
+  std::vector<int> component;
+  std::vector<int> stack;
+};
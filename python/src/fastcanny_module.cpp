@@ -0,0 +1,703 @@
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "canny_pipeline.h"
+#include "canny_workspace.h"
+#include "double_threshold.h"
+#include "gaussian_filter.h"
+#include "gradient.h"
+#include "hysteresis.h"
+#include "image_view.h"
+#include "non_maxima_suppression.h"
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <new>
+#include <string>
+#include <vector>
+
+// Defaults of detect_edge
+#define DEFAULT_LOWER_THRESHOLD 100
+#define DEFAULT_UPPER_THRESHOLD 200
+#define DEFAULT_KERNEL_SIZE 3
+#define DEFAULT_SIGMA 0.5
+
+/**
+ * @brief A 2-D image allocated by the module and exported through the buffer
+ * protocol, so NumPy wraps it without a copy
+ */
+struct ImageObject {
+  PyObject_HEAD void *data;
+  Py_ssize_t shape[2];
+  Py_ssize_t strides[2];
+  Py_ssize_t itemsize;
+  char format[2];
+};
+
+static void ImageDealloc(PyObject *self) {
+  // Instances of a heap type hold a reference to it
+  PyTypeObject *type = Py_TYPE(self);
+  std::free(((ImageObject *)self)->data);
+  type->tp_free(self);
+  Py_DECREF(type);
+}
+
+static int ImageGetBuffer(PyObject *self, Py_buffer *view, int flags) {
+  ImageObject *image = (ImageObject *)self;
+  view->obj = self;
+  Py_INCREF(self);
+  view->buf = image->data;
+  view->len = image->shape[0] * image->shape[1] * image->itemsize;
+  view->readonly = 0;
+  view->itemsize = image->itemsize;
+  view->format = (flags & PyBUF_FORMAT) ? image->format : nullptr;
+  view->ndim = 2;
+  view->shape = (flags & PyBUF_ND) ? image->shape : nullptr;
+  view->strides = (flags & PyBUF_STRIDES) ? image->strides : nullptr;
+  view->suboffsets = nullptr;
+  view->internal = nullptr;
+  return 0;
+}
+
+static PyType_Slot ImageSlots[] = {
+    {Py_tp_doc, (void *)"Image memory owned by fastcanny"},
+    {Py_tp_dealloc, (void *)ImageDealloc},
+    {Py_bf_getbuffer, (void *)ImageGetBuffer},
+    {0, nullptr}};
+
+static PyType_Spec ImageSpec = {"fastcanny.Image", sizeof(ImageObject), 0,
+                                Py_TPFLAGS_DEFAULT, ImageSlots};
+
+// Created from ImageSpec when the module is loaded
+static PyTypeObject *ImageType = nullptr;
+
+// numpy.asarray, or null when NumPy is not installed
+static PyObject *numpyAsArray = nullptr;
+
+/**
+ * @brief A new continuous `width` x `height` image of 'B' or 'd' pixels, or
+ * null with a Python error set
+ */
+static ImageObject *NewImage(int width, int height, char format) {
+  ImageObject *image = PyObject_New(ImageObject, ImageType);
+  if (image == nullptr) {
+    return nullptr;
+  }
+  image->data = nullptr;
+  image->itemsize = format == 'd' ? sizeof(double) : 1;
+  image->shape[0] = height;
+  image->shape[1] = width;
+  image->strides[0] = width * image->itemsize;
+  image->strides[1] = image->itemsize;
+  image->format[0] = format;
+  image->format[1] = '\0';
+  // One byte at least so an empty image still has a buffer
+  image->data = std::malloc((size_t)width * height * image->itemsize + 1);
+  if (image->data == nullptr) {
+    Py_DECREF(image);
+    PyErr_NoMemory();
+    return nullptr;
+  }
+  return image;
+}
+
+/**
+ * @brief Hand an image to Python as a NumPy array sharing its memory, or as a
+ * memoryview without NumPy. Steals the reference.
+ */
+static PyObject *AsArray(ImageObject *image) {
+  if (image == nullptr) {
+    return nullptr;
+  }
+  PyObject *array =
+      numpyAsArray != nullptr
+          ? PyObject_CallOneArg(numpyAsArray, (PyObject *)image)
+          : PyMemoryView_FromObject((PyObject *)image);
+  Py_DECREF(image);
+  return array;
+}
+
+/**
+ * @brief Borrow the pixels of a 2-D uint8 or float64 buffer. Rows may be
+ * strided but pixels within a row must be adjacent. Returns false with a
+ * Python error set.
+ */
+static bool GetImage(PyObject *object, Py_buffer *view, bool writable,
+                     const char *name) {
+  int flags = PyBUF_STRIDES | PyBUF_FORMAT;
+  if (writable) {
+    flags |= PyBUF_WRITABLE;
+  }
+  if (PyObject_GetBuffer(object, view, flags) != 0) {
+    return false;
+  }
+
+  const char *format = view->format != nullptr ? view->format : "B";
+  // NumPy spells native types with or without the byte order prefix
+  if (format[0] == '=' || format[0] == '@') {
+    format++;
+  }
+  bool isByte = std::strcmp(format, "B") == 0;
+  bool isDouble = std::strcmp(format, "d") == 0;
+  std::string error;
+  if (view->ndim != 2) {
+    error = "must be 2-dimensional";
+  } else if (!isByte && !isDouble) {
+    error = "must be uint8 or float64";
+  } else if (view->strides[1] != view->itemsize ||
+             view->strides[0] < view->shape[1] * view->itemsize ||
+             view->strides[0] % view->itemsize != 0) {
+    error = "must have adjacent pixels and rows in increasing order";
+  }
+
+  if (!error.empty()) {
+    PyBuffer_Release(view);
+    PyErr_Format(PyExc_ValueError, "%s %s", name, error.c_str());
+    return false;
+  }
+  return true;
+}
+
+static bool IsDouble(const Py_buffer &view) {
+  return view.itemsize == sizeof(double);
+}
+
+/**
+ * @brief Whether the blur can use `kernelSize` and `sigma`, else false with a
+ * ValueError set. The kernels do not check them.
+ */
+static bool CheckBlurParams(int kernelSize, double sigma) {
+  if (kernelSize <= 0 || kernelSize % 2 == 0 || !(sigma > 0)) {
+    PyErr_SetString(PyExc_ValueError,
+                    "kernel_size must be odd and positive, sigma positive");
+    return false;
+  }
+  return true;
+}
+
+template <class T> static ImageView<T> ViewOf(const Py_buffer &view) {
+  return ImageView<T>((T *)view.buf, (int)view.shape[1], (int)view.shape[0],
+                      view.strides[0] / view.itemsize);
+}
+
+/**
+ * @brief Edges of one image into a same-size, same-type output. 8-bit images
+ * give 0/255 edges, float64 ones the edges of FastCanny.
+ */
+static void DetectImage(const Py_buffer &input, const Py_buffer &output,
+                        int lowerThreshold, int upperThreshold,
+                        int kernelSize, double sigma) {
+  if (IsDouble(input)) {
+    FastCanny(ViewOf<const double>(input), ViewOf<double>(output),
+              lowerThreshold, upperThreshold, kernelSize, sigma);
+    return;
+  }
+
+  if (input.shape[0] == 0 || input.shape[1] == 0) {
+    return;
+  }
+  thread_local CannyWorkspace workspace;
+  workspace.Detect(ViewOf<const unsigned char>(input),
+                   ViewOf<unsigned char>(output), lowerThreshold,
+                   upperThreshold, kernelSize, sigma);
+}
+
+/**
+ * @brief The output of a call: `out` when given, checked against the input's
+ * shape and type, or a new image returned through `result`. Returns false
+ * with a Python error set.
+ */
+static bool GetOutput(PyObject *out, const Py_buffer &input, char format,
+                      bool continuous, Py_buffer *view,
+                      ImageObject **result) {
+  *result = nullptr;
+  if (out == Py_None) {
+    *result = NewImage((int)input.shape[1], (int)input.shape[0], format);
+    if (*result == nullptr ||
+        PyObject_GetBuffer((PyObject *)*result, view,
+                           PyBUF_STRIDES | PyBUF_FORMAT) != 0) {
+      Py_XDECREF(*result);
+      return false;
+    }
+    return true;
+  }
+
+  if (!GetImage(out, view, true, "out")) {
+    return false;
+  }
+  if (view->shape[0] != input.shape[0] || view->shape[1] != input.shape[1] ||
+      view->itemsize != (format == 'd' ? (Py_ssize_t)sizeof(double) : 1) ||
+      (continuous && view->strides[0] != view->shape[1] * view->itemsize)) {
+    PyBuffer_Release(view);
+    PyErr_SetString(PyExc_ValueError,
+                    continuous ? "out must be a continuous array of the "
+                                 "input's shape and the result's type"
+                               : "out must have the input's shape and type");
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Run `kernel` without the GIL. Returns false with a Python error set
+ * if it threw: MemoryError for a failed allocation, ValueError otherwise.
+ */
+template <class F> static bool RunWithoutGil(F kernel) {
+  std::string error;
+  bool noMemory = false;
+  Py_BEGIN_ALLOW_THREADS
+  try {
+    kernel();
+  } catch (const std::bad_alloc &) {
+    noMemory = true;
+  } catch (const std::exception &e) {
+    error = e.what();
+  }
+  Py_END_ALLOW_THREADS
+
+  if (noMemory) {
+    PyErr_NoMemory();
+    return false;
+  }
+  if (!error.empty()) {
+    PyErr_SetString(PyExc_ValueError, error.c_str());
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Return `out` itself when given, else the new image as an array
+ */
+static PyObject *Result(PyObject *out, ImageObject *result) {
+  if (result == nullptr) {
+    Py_INCREF(out);
+    return out;
+  }
+  return AsArray(result);
+}
+
+static PyObject *Detect(PyObject *, PyObject *args, PyObject *kwargs) {
+  static const char *keywords[] = {"image",       "lower", "upper",
+                                   "kernel_size", "sigma", "out",
+                                   nullptr};
+  PyObject *imageObject;
+  int lowerThreshold = DEFAULT_LOWER_THRESHOLD;
+  int upperThreshold = DEFAULT_UPPER_THRESHOLD;
+  int kernelSize = DEFAULT_KERNEL_SIZE;
+  double sigma = DEFAULT_SIGMA;
+  PyObject *out = Py_None;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|iiidO", (char **)keywords,
+                                   &imageObject, &lowerThreshold,
+                                   &upperThreshold, &kernelSize, &sigma,
+                                   &out) ||
+      !CheckBlurParams(kernelSize, sigma)) {
+    return nullptr;
+  }
+
+  Py_buffer input;
+  if (!GetImage(imageObject, &input, false, "image")) {
+    return nullptr;
+  }
+  Py_buffer output;
+  ImageObject *result;
+  if (!GetOutput(out, input, IsDouble(input) ? 'd' : 'B', false, &output,
+                 &result)) {
+    PyBuffer_Release(&input);
+    return nullptr;
+  }
+
+  bool ok = RunWithoutGil([&] {
+    DetectImage(input, output, lowerThreshold, upperThreshold, kernelSize,
+                sigma);
+  });
+
+  PyBuffer_Release(&input);
+  PyBuffer_Release(&output);
+  if (!ok) {
+    Py_XDECREF(result);
+    return nullptr;
+  }
+  return Result(out, result);
+}
+
+static PyObject *DetectBatch(PyObject *, PyObject *args, PyObject *kwargs) {
+  static const char *keywords[] = {"images", "lower", "upper",
+                                   "kernel_size", "sigma", nullptr};
+  PyObject *imagesObject;
+  int lowerThreshold = DEFAULT_LOWER_THRESHOLD;
+  int upperThreshold = DEFAULT_UPPER_THRESHOLD;
+  int kernelSize = DEFAULT_KERNEL_SIZE;
+  double sigma = DEFAULT_SIGMA;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|iiid", (char **)keywords,
+                                   &imagesObject, &lowerThreshold,
+                                   &upperThreshold, &kernelSize, &sigma) ||
+      !CheckBlurParams(kernelSize, sigma)) {
+    return nullptr;
+  }
+
+  PyObject *sequence =
+      PySequence_Fast(imagesObject, "images must be a sequence");
+  if (sequence == nullptr) {
+    return nullptr;
+  }
+
+  Py_ssize_t count = PySequence_Fast_GET_SIZE(sequence);
+  std::vector<Py_buffer> inputs(count);
+  std::vector<Py_buffer> outputs(count);
+  std::vector<ImageObject *> results(count, nullptr);
+  Py_ssize_t acquired = 0;
+  bool ok = true;
+  for (; acquired < count; acquired++) {
+    PyObject *item = PySequence_Fast_GET_ITEM(sequence, acquired);
+    if (!GetImage(item, &inputs[acquired], false, "image")) {
+      ok = false;
+      break;
+    }
+    if (!GetOutput(Py_None, inputs[acquired],
+                   IsDouble(inputs[acquired]) ? 'd' : 'B', false,
+                   &outputs[acquired], &results[acquired])) {
+      PyBuffer_Release(&inputs[acquired]);
+      ok = false;
+      break;
+    }
+  }
+
+  std::vector<std::string> errors(count);
+  if (ok) {
+    Py_BEGIN_ALLOW_THREADS
+    // One image per thread, a single image is better served by the kernels'
+    // own parallel loops
+#pragma omp parallel for schedule(dynamic) if (count > 1)
+    for (Py_ssize_t i = 0; i < count; i++) {
+      try {
+        DetectImage(inputs[i], outputs[i], lowerThreshold, upperThreshold,
+                    kernelSize, sigma);
+      } catch (const std::exception &e) {
+        errors[i] = e.what();
+      }
+    }
+    Py_END_ALLOW_THREADS
+  }
+
+  for (Py_ssize_t i = 0; i < acquired; i++) {
+    PyBuffer_Release(&inputs[i]);
+    PyBuffer_Release(&outputs[i]);
+  }
+  Py_DECREF(sequence);
+
+  for (Py_ssize_t i = 0; ok && i < count; i++) {
+    if (!errors[i].empty()) {
+      PyErr_Format(PyExc_ValueError, "image %zd: %s", i, errors[i].c_str());
+      ok = false;
+    }
+  }
+
+  PyObject *list = ok ? PyList_New(count) : nullptr;
+  for (Py_ssize_t i = 0; i < acquired; i++) {
+    if (list == nullptr) {
+      Py_DECREF(results[i]);
+      continue;
+    }
+    PyObject *array = AsArray(results[i]);
+    if (array == nullptr) {
+      Py_CLEAR(list);
+      continue;
+    }
+    PyList_SET_ITEM(list, i, array);
+  }
+  return list;
+}
+
+/**
+ * @brief Borrow a continuous float64 image for a single stage. Returns false
+ * with a Python error set.
+ */
+static bool GetStageInput(PyObject *object, Py_buffer *view,
+                          const char *name) {
+  if (!GetImage(object, view, false, name)) {
+    return false;
+  }
+  if (!IsDouble(*view) || view->strides[0] != view->shape[1] * view->itemsize) {
+    PyBuffer_Release(view);
+    PyErr_Format(PyExc_ValueError, "%s must be a continuous float64 array",
+                 name);
+    return false;
+  }
+  return true;
+}
+
+static PyObject *GaussianFilterStage(PyObject *, PyObject *args,
+                                     PyObject *kwargs) {
+  static const char *keywords[] = {"image", "kernel_size", "sigma", "out",
+                                   nullptr};
+  PyObject *imageObject;
+  int kernelSize = DEFAULT_KERNEL_SIZE;
+  double sigma = DEFAULT_SIGMA;
+  PyObject *out = Py_None;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|idO", (char **)keywords,
+                                   &imageObject, &kernelSize, &sigma, &out) ||
+      !CheckBlurParams(kernelSize, sigma)) {
+    return nullptr;
+  }
+
+  // The blur reads strided rows, so any float64 view will do
+  Py_buffer input;
+  if (!GetImage(imageObject, &input, false, "image")) {
+    return nullptr;
+  }
+  if (!IsDouble(input)) {
+    PyBuffer_Release(&input);
+    PyErr_SetString(PyExc_ValueError, "image must be float64");
+    return nullptr;
+  }
+  Py_buffer output;
+  ImageObject *result;
+  if (!GetOutput(out, input, 'd', true, &output, &result)) {
+    PyBuffer_Release(&input);
+    return nullptr;
+  }
+
+  bool ok = RunWithoutGil([&] {
+    if (input.shape[0] > 0 && input.shape[1] > 0) {
+      GaussianFilter(ViewOf<const double>(input), (double *)output.buf,
+                     kernelSize, sigma);
+    }
+  });
+
+  PyBuffer_Release(&input);
+  PyBuffer_Release(&output);
+  if (!ok) {
+    Py_XDECREF(result);
+    return nullptr;
+  }
+  return Result(out, result);
+}
+
+static PyObject *GradientStage(PyObject *, PyObject *args) {
+  PyObject *imageObject;
+  if (!PyArg_ParseTuple(args, "O", &imageObject)) {
+    return nullptr;
+  }
+
+  Py_buffer input;
+  if (!GetStageInput(imageObject, &input, "image")) {
+    return nullptr;
+  }
+  int width = (int)input.shape[1];
+  int height = (int)input.shape[0];
+  ImageObject *magnitude = NewImage(width, height, 'd');
+  ImageObject *theta = magnitude != nullptr ? NewImage(width, height, 'd')
+                                            : nullptr;
+  if (theta == nullptr) {
+    Py_XDECREF(magnitude);
+    PyBuffer_Release(&input);
+    return nullptr;
+  }
+
+  bool ok = RunWithoutGil([&] {
+    if (width > 0 && height > 0) {
+      Gradient((const double *)input.buf, (double *)magnitude->data,
+               (double *)theta->data, width, height);
+    }
+  });
+
+  PyBuffer_Release(&input);
+  if (!ok) {
+    Py_DECREF(magnitude);
+    Py_DECREF(theta);
+    return nullptr;
+  }
+  PyObject *magnitudeArray = AsArray(magnitude);
+  PyObject *thetaArray = AsArray(theta);
+  if (magnitudeArray == nullptr || thetaArray == nullptr) {
+    Py_XDECREF(magnitudeArray);
+    Py_XDECREF(thetaArray);
+    return nullptr;
+  }
+  PyObject *pair = PyTuple_Pack(2, magnitudeArray, thetaArray);
+  Py_DECREF(magnitudeArray);
+  Py_DECREF(thetaArray);
+  return pair;
+}
+
+static PyObject *NonMaxSuppressionStage(PyObject *, PyObject *args) {
+  PyObject *magnitudeObject;
+  PyObject *thetaObject;
+  if (!PyArg_ParseTuple(args, "OO", &magnitudeObject, &thetaObject)) {
+    return nullptr;
+  }
+
+  Py_buffer magnitude;
+  if (!GetStageInput(magnitudeObject, &magnitude, "magnitude")) {
+    return nullptr;
+  }
+  Py_buffer theta;
+  if (!GetStageInput(thetaObject, &theta, "theta")) {
+    PyBuffer_Release(&magnitude);
+    return nullptr;
+  }
+  int width = (int)magnitude.shape[1];
+  int height = (int)magnitude.shape[0];
+  ImageObject *result = nullptr;
+  if (theta.shape[0] != height || theta.shape[1] != width) {
+    PyErr_SetString(PyExc_ValueError,
+                    "magnitude and theta must have the same shape");
+  } else {
+    result = NewImage(width, height, 'd');
+  }
+  if (result == nullptr) {
+    PyBuffer_Release(&magnitude);
+    PyBuffer_Release(&theta);
+    return nullptr;
+  }
+
+  bool ok = RunWithoutGil([&] {
+    double *suppressed = (double *)result->data;
+    // Suppression leaves the border alone
+    std::memset(suppressed, 0, (size_t)width * height * sizeof(double));
+    if (width > 0 && height > 0) {
+      // The kernels only read their inputs
+      NonMaxSuppression((double *)magnitude.buf, suppressed,
+                        (double *)theta.buf, 3, width, height);
+    }
+  });
+
+  PyBuffer_Release(&magnitude);
+  PyBuffer_Release(&theta);
+  if (!ok) {
+    Py_DECREF(result);
+    return nullptr;
+  }
+  return AsArray(result);
+}
+
+/**
+ * @brief DoubleThreshold or Hysteresis, which share their arguments
+ */
+static PyObject *ThresholdStage(PyObject *args, PyObject *kwargs,
+                                void (*stage)(double *, double *, int, int,
+                                              double, double)) {
+  static const char *keywords[] = {"image", "lower", "upper", nullptr};
+  PyObject *imageObject;
+  double lowerThreshold = DEFAULT_LOWER_THRESHOLD;
+  double upperThreshold = DEFAULT_UPPER_THRESHOLD;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|dd", (char **)keywords,
+                                   &imageObject, &lowerThreshold,
+                                   &upperThreshold)) {
+    return nullptr;
+  }
+
+  Py_buffer input;
+  if (!GetStageInput(imageObject, &input, "image")) {
+    return nullptr;
+  }
+  int width = (int)input.shape[1];
+  int height = (int)input.shape[0];
+  ImageObject *result = NewImage(width, height, 'd');
+  if (result == nullptr) {
+    PyBuffer_Release(&input);
+    return nullptr;
+  }
+
+  bool ok = RunWithoutGil([&] {
+    if (width > 0 && height > 0) {
+      stage((double *)input.buf, (double *)result->data, width, height,
+            lowerThreshold, upperThreshold);
+    }
+  });
+
+  PyBuffer_Release(&input);
+  if (!ok) {
+    Py_DECREF(result);
+    return nullptr;
+  }
+  return AsArray(result);
+}
+
+static PyObject *DoubleThresholdStage(PyObject *, PyObject *args,
+                                      PyObject *kwargs) {
+  return ThresholdStage(args, kwargs, [](double *input, double *output,
+                                         int width, int height, double lower,
+                                         double upper) {
+    DoubleThreshold(input, output, width, height, lower, upper);
+  });
+}
+
+static PyObject *HysteresisStage(PyObject *, PyObject *args,
+                                 PyObject *kwargs) {
+  return ThresholdStage(args, kwargs, Hysteresis);
+}
+
+static PyMethodDef FastCannyMethods[] = {
+    {"detect", (PyCFunction)(void (*)(void))Detect,
+     METH_VARARGS | METH_KEYWORDS,
+     "detect(image, lower=100, upper=200, kernel_size=3, sigma=0.5, "
+     "out=None)\n\nCanny edges of a 2-D uint8 or float64 array, returned as "
+     "an array of the same type: 0/255 for uint8, the FastCanny edges for "
+     "float64. Rows may be strided. With `out`, the edges are written into it "
+     "and it is returned. The GIL is released while detecting."},
+    {"detect_batch", (PyCFunction)(void (*)(void))DetectBatch,
+     METH_VARARGS | METH_KEYWORDS,
+     "detect_batch(images, lower=100, upper=200, kernel_size=3, sigma=0.5)"
+     "\n\ndetect() on every image of a sequence, in parallel and without the "
+     "GIL. Returns a list of edge arrays."},
+    {"gaussian_filter", (PyCFunction)(void (*)(void))GaussianFilterStage,
+     METH_VARARGS | METH_KEYWORDS,
+     "gaussian_filter(image, kernel_size=3, sigma=0.5, out=None)\n\nBlur of "
+     "a float64 image with zero padding."},
+    {"gradient", GradientStage, METH_VARARGS,
+     "gradient(image)\n\nSobel magnitude and direction of a continuous "
+     "float64 image, as a (magnitude, theta) tuple."},
+    {"non_max_suppression", NonMaxSuppressionStage, METH_VARARGS,
+     "non_max_suppression(magnitude, theta)\n\nMagnitude kept only at local "
+     "maxima along the gradient direction, 0 on the border."},
+    {"double_threshold", (PyCFunction)(void (*)(void))DoubleThresholdStage,
+     METH_VARARGS | METH_KEYWORDS,
+     "double_threshold(image, lower=100, upper=200)\n\nClassify pixels as "
+     "strong (upper), weak (lower) or 0."},
+    {"hysteresis", (PyCFunction)(void (*)(void))HysteresisStage,
+     METH_VARARGS | METH_KEYWORDS,
+     "hysteresis(image, lower=100, upper=200)\n\nKeep the weak pixels of a "
+     "double_threshold() output that connect to strong ones."},
+    {nullptr, nullptr, 0, nullptr}};
+
+static PyModuleDef FastCannyModule = {
+    PyModuleDef_HEAD_INIT,
+    "fastcanny",
+    "FastCanny edge detection on NumPy arrays and other buffers",
+    -1,
+    FastCannyMethods,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr};
+
+PyMODINIT_FUNC PyInit_fastcanny(void) {
+  if (ImageType == nullptr) {
+    ImageType = (PyTypeObject *)PyType_FromSpec(&ImageSpec);
+    if (ImageType == nullptr) {
+      return nullptr;
+    }
+  }
+
+  // NumPy is optional, results are memoryviews without it
+  PyObject *numpy = PyImport_ImportModule("numpy");
+  if (numpy != nullptr) {
+    numpyAsArray = PyObject_GetAttrString(numpy, "asarray");
+    Py_DECREF(numpy);
+  }
+  PyErr_Clear();
+
+  PyObject *module = PyModule_Create(&FastCannyModule);
+  if (module == nullptr) {
+    return nullptr;
+  }
+  Py_INCREF(ImageType);
+  if (PyModule_AddObject(module, "Image", (PyObject *)ImageType) < 0) {
+    Py_DECREF(ImageType);
+    Py_DECREF(module);
+    return nullptr;
+  }
+  return module;
+}
@@ -0,0 +1,162 @@
+#include "canny_client.h"
+#include "canny_protocol.h"
+#include <atomic>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Edges start on their own cache line after the input
+#define CANNY_SEGMENT_ALIGNMENT 64
+
+static std::runtime_error ClientError(const std::string &what) {
+  return std::runtime_error("CannyClient failed: " + what);
+}
+
+static std::runtime_error ClientErrno(const std::string &what) {
+  return ClientError(what + ": " + std::strerror(errno));
+}
+
+// Send a request and wait for its reply, throwing the server's error
+static CannyReply Exchange(int fd, const CannyRequest &request) {
+  CannyReply reply;
+  if (!WriteMessage(fd, &request, sizeof(request)) ||
+      !ReadMessage(fd, &reply, sizeof(reply))) {
+    throw ClientError("lost the connection to the server");
+  }
+  if (reply.magic != CANNY_PROTOCOL_MAGIC) {
+    throw ClientError("unexpected reply from the server");
+  }
+  if (reply.status != 0) {
+    reply.error[CANNY_ERROR_SIZE - 1] = '\0';
+    throw ClientError(reply.error);
+  }
+  return reply;
+}
+
+CannyClient::CannyClient(const std::string &socketPath) {
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if (socketPath.size() >= sizeof(address.sun_path)) {
+    throw ClientError("socket path too long: " + socketPath);
+  }
+  std::strcpy(address.sun_path, socketPath.c_str());
+
+  socketFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (socketFd < 0) {
+    throw ClientErrno("socket");
+  }
+  if (connect(socketFd, (const sockaddr *)&address, sizeof(address)) != 0) {
+    std::runtime_error error = ClientErrno("connect to " + socketPath);
+    close(socketFd);
+    throw error;
+  }
+}
+
+CannyClient::~CannyClient() {
+  if (segment != nullptr) {
+    munmap(segment, segmentSize);
+  }
+  close(socketFd);
+}
+
+void CannyClient::Attach(size_t size) {
+  // Names only have to be unique while the server opens them
+  static std::atomic<unsigned> segmentCount{0};
+  std::string name = "/fast_canny." + std::to_string(getpid()) + "." +
+                     std::to_string(segmentCount++);
+
+  int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) {
+    throw ClientErrno("shm_open " + name);
+  }
+  if (ftruncate(fd, (off_t)size) != 0) {
+    std::runtime_error error = ClientErrno("ftruncate " + name);
+    close(fd);
+    shm_unlink(name.c_str());
+    throw error;
+  }
+  void *mapping =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    std::runtime_error error = ClientErrno("mmap " + name);
+    shm_unlink(name.c_str());
+    throw error;
+  }
+
+  CannyRequest request = {};
+  request.magic = CANNY_PROTOCOL_MAGIC;
+  request.type = CANNY_REQUEST_ATTACH;
+  std::strncpy(request.segment, name.c_str(), CANNY_SEGMENT_NAME_SIZE - 1);
+  request.segmentSize = size;
+
+  try {
+    Exchange(socketFd, request);
+  } catch (...) {
+    munmap(mapping, size);
+    shm_unlink(name.c_str());
+    throw;
+  }
+  // Both sides have it mapped, the name is not needed anymore
+  shm_unlink(name.c_str());
+
+  if (segment != nullptr) {
+    munmap(segment, segmentSize);
+  }
+  segment = (unsigned char *)mapping;
+  segmentSize = size;
+}
+
+unsigned char *CannyClient::Input(int width, int height) {
+  if (width <= 0 || height <= 0) {
+    throw ClientError("image size must be positive");
+  }
+
+  size_t size = (size_t)width * height;
+  size_t edgesAt = (size + CANNY_SEGMENT_ALIGNMENT - 1) /
+                   CANNY_SEGMENT_ALIGNMENT * CANNY_SEGMENT_ALIGNMENT;
+  if (edgesAt + size > segmentSize) {
+    Attach(edgesAt + size);
+  }
+
+  this->width = width;
+  this->height = height;
+  outputOffset = edgesAt;
+  return segment;
+}
+
+const unsigned char *CannyClient::Detect(int lowerThreshold,
+                                         int upperThreshold, int kernelSize,
+                                         double sigma) {
+  if (segment == nullptr) {
+    throw ClientError("no image was written into Input()");
+  }
+
+  CannyRequest request = {};
+  request.magic = CANNY_PROTOCOL_MAGIC;
+  request.type = CANNY_REQUEST_DETECT;
+  request.inputOffset = 0;
+  request.outputOffset = outputOffset;
+  request.width = width;
+  request.height = height;
+  request.lowerThreshold = lowerThreshold;
+  request.upperThreshold = upperThreshold;
+  request.kernelSize = kernelSize;
+  request.sigma = sigma;
+
+  CannyReply reply = Exchange(socketFd, request);
+  lastDetectMs = reply.detectMs;
+  return segment + outputOffset;
+}
+
+const unsigned char *CannyClient::Detect(const unsigned char *image, int width,
+                                         int height, int lowerThreshold,
+                                         int upperThreshold, int kernelSize,
+                                         double sigma) {
+  std::memcpy(Input(width, height), image, (size_t)width * height);
+  return Detect(lowerThreshold, upperThreshold, kernelSize, sigma);
+}
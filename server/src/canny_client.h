@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief Connection to a canny_server, see canny_protocol.h.
+ *
+ * The client owns a POSIX shared memory segment holding one input image and
+ * its edges. Write the image straight into Input() (or let the copying
+ * Detect() overload do it) and read the edges from the pointer Detect()
+ * returns; only the request and the reply go through the socket. The segment
+ * grows when a larger image comes and is unlinked as soon as the server has
+ * mapped it, so nothing is left behind if either process dies.
+ *
+ * A client is not thread-safe, use one per thread.
+ */
+class CannyClient {
+public:
+  /**
+   * @brief Connect to the server listening on `socketPath`
+   */
+  explicit CannyClient(const std::string &socketPath);
+  ~CannyClient();
+
+  CannyClient(const CannyClient &) = delete;
+  CannyClient &operator=(const CannyClient &) = delete;
+
+  /**
+   * @brief Shared buffer to write the next `width` x `height` 8-bit image
+   * into, row after row without padding
+   */
+  unsigned char *Input(int width, int height);
+
+  /**
+   * @brief Detect the edges of the image last written into Input(). Returns
+   * the width * height edges, 0 or 255, valid until the next call to Input()
+   * or Detect().
+   */
+  const unsigned char *Detect(int lowerThreshold, int upperThreshold,
+                              int kernelSize, double sigma);
+
+  /**
+   * @brief Copy `image` into Input() and detect its edges
+   */
+  const unsigned char *Detect(const unsigned char *image, int width,
+                              int height, int lowerThreshold,
+                              int upperThreshold, int kernelSize,
+                              double sigma);
+
+  // Time the server spent on the last detection, in milliseconds
+  double LastDetectMs() const { return lastDetectMs; }
+
+private:
+  void Attach(size_t size);
+
+  int socketFd = -1;
+  unsigned char *segment = nullptr;
+  size_t segmentSize = 0;
+  size_t outputOffset = 0;
+  int width = 0;
+  int height = 0;
+  double lastDetectMs = 0;
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <sys/socket.h>
+
+// Messages between CannyClient and canny_server over a Unix domain socket.
+// Pixels never go through the socket: the client creates a POSIX shared
+// memory segment that the server maps once per connection, and each request
+// only carries where the image and the edges are inside it.
+#define CANNY_PROTOCOL_MAGIC 0x46434e59u
+#define CANNY_SEGMENT_NAME_SIZE 64
+#define CANNY_ERROR_SIZE 128
+
+enum CannyRequestType : uint32_t {
+  // Map the segment named in the request, replacing the previous one
+  CANNY_REQUEST_ATTACH = 1,
+  // Detect the edges of an 8-bit image in the segment
+  CANNY_REQUEST_DETECT = 2,
+};
+
+struct CannyRequest {
+  uint32_t magic;
+  uint32_t type;
+
+  // Attach: shm_open name and size of the segment
+  char segment[CANNY_SEGMENT_NAME_SIZE];
+  uint64_t segmentSize;
+
+  // Detect: offsets in the segment of the width * height input pixels and of
+  // the edges, written as 0 or 255
+  uint64_t inputOffset;
+  uint64_t outputOffset;
+  int32_t width;
+  int32_t height;
+  int32_t lowerThreshold;
+  int32_t upperThreshold;
+  int32_t kernelSize;
+  double sigma;
+};
+
+struct CannyReply {
+  uint32_t magic;
+  // 0 on success, -1 with `error` set otherwise
+  int32_t status;
+  // Time the server spent detecting, without the queueing and the socket
+  double detectMs;
+  char error[CANNY_ERROR_SIZE];
+};
+
+/**
+ * @brief Write a whole message to a socket. Returns false when the peer is
+ * gone.
+ */
+static inline bool WriteMessage(int fd, const void *message, size_t size) {
+  const char *data = (const char *)message;
+  while (size > 0) {
+    // A peer that went away is reported here rather than by SIGPIPE
+    ssize_t written = send(fd, data, size, MSG_NOSIGNAL);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+/**
+ * @brief Read a whole message from a socket. Returns false when the peer
+ * closed the connection or it failed.
+ */
+static inline bool ReadMessage(int fd, void *message, size_t size) {
+  char *data = (char *)message;
+  while (size > 0) {
+    ssize_t got = recv(fd, data, size, 0);
+    if (got < 0 && errno == EINTR) {
+      continue;
+    }
+    if (got <= 0) {
+      return false;
+    }
+    data += got;
+    size -= got;
+  }
+  return true;
+}
@@ -0,0 +1,281 @@
+#include "canny_server.h"
+#include "canny_protocol.h"
+#include "canny_workspace.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <csetjmp>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <future>
+#include <omp.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static std::runtime_error ServerError(const std::string &what) {
+  return std::runtime_error("CannyServer failed: " + what);
+}
+
+static std::runtime_error ServerErrno(const std::string &what) {
+  return ServerError(what + ": " + std::strerror(errno));
+}
+
+// Where the bus error handler jumps back to while this thread copies from or
+// to a client's shared memory, null otherwise. Volatile so the stores around
+// the copy are not optimized away, only the handler reads it.
+static thread_local sigjmp_buf *volatile sharedCopyFault = nullptr;
+// SIGBUS disposition before the server installed its handler
+static struct sigaction previousBusAction;
+
+/**
+ * @brief A client that shrinks its segment below the mapping makes every
+ * access past the new end raise SIGBUS. Inside CopyShared() that fails the
+ * copy, anywhere else the previous disposition applies.
+ */
+static void OnBusError(int, siginfo_t *, void *) {
+  if (sharedCopyFault != nullptr) {
+    siglongjmp(*sharedCopyFault, 1);
+  }
+  // Returning runs the faulting access again, now with the old disposition
+  sigaction(SIGBUS, &previousBusAction, nullptr);
+}
+
+static void InstallBusHandler() {
+  static std::once_flag installed;
+  std::call_once(installed, [] {
+    struct sigaction action = {};
+    action.sa_sigaction = OnBusError;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGBUS, &action, &previousBusAction);
+  });
+}
+
+/**
+ * @brief memcpy to or from a client's shared memory. Returns false instead of
+ * crashing the server when the client truncated the segment under it.
+ */
+static bool CopyShared(void *to, const void *from, size_t size) {
+  sigjmp_buf fault;
+  if (sigsetjmp(fault, 1) != 0) {
+    sharedCopyFault = nullptr;
+    return false;
+  }
+  sharedCopyFault = &fault;
+  std::memcpy(to, from, size);
+  sharedCopyFault = nullptr;
+  return true;
+}
+
+/**
+ * @brief FastCanny on an 8-bit image, writing 0/255 edges. The workspace is
+ * kept per executor worker from one frame to the next.
+ */
+static double DetectFrame(const unsigned char *input, unsigned char *output,
+                          int width, int height, int lowerThreshold,
+                          int upperThreshold, int kernelSize, double sigma) {
+  thread_local CannyWorkspace workspace;
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+
+  workspace.Detect(ImageView<const unsigned char>(input, width, height),
+                   ImageView<unsigned char>(output, width, height),
+                   lowerThreshold, upperThreshold, kernelSize, sigma);
+
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+CannyServer::CannyServer(const std::string &socketPath, int workers,
+                         size_t queueDepth)
+    : socketPath(socketPath),
+      threadsPerWorker(
+          std::max(1, omp_get_max_threads() / std::max(1, workers))),
+      executor(workers, queueDepth) {
+  InstallBusHandler();
+
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if (socketPath.size() >= sizeof(address.sun_path)) {
+    throw ServerError("socket path too long: " + socketPath);
+  }
+  std::strcpy(address.sun_path, socketPath.c_str());
+
+  listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listenFd < 0) {
+    throw ServerErrno("socket");
+  }
+
+  // A stale socket makes bind fail, but a live server must not be replaced
+  struct stat existing;
+  if (lstat(socketPath.c_str(), &existing) == 0 &&
+      S_ISSOCK(existing.st_mode)) {
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    bool live = probe >= 0 && connect(probe, (const sockaddr *)&address,
+                                      sizeof(address)) == 0;
+    if (probe >= 0) {
+      close(probe);
+    }
+    if (live) {
+      close(listenFd);
+      throw ServerError("a server is already listening on " + socketPath);
+    }
+    unlink(socketPath.c_str());
+  }
+
+  if (bind(listenFd, (const sockaddr *)&address, sizeof(address)) != 0 ||
+      listen(listenFd, SOMAXCONN) != 0) {
+    std::runtime_error error = ServerErrno("listen on " + socketPath);
+    close(listenFd);
+    throw error;
+  }
+}
+
+CannyServer::~CannyServer() {
+  close(listenFd);
+  unlink(socketPath.c_str());
+}
+
+void CannyServer::Stop() {
+  stopping = true;
+  // Wakes up accept() in Serve()
+  shutdown(listenFd, SHUT_RDWR);
+}
+
+void CannyServer::Serve() {
+  while (!stopping) {
+    int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      break;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    connections.push_back(fd);
+    std::thread(&CannyServer::HandleConnection, this, fd).detach();
+  }
+
+  // Clients blocked in a read see the end of the stream, the others finish
+  // their request first
+  std::unique_lock<std::mutex> lock(mutex);
+  for (int fd : connections) {
+    shutdown(fd, SHUT_RDWR);
+  }
+  connectionClosed.wait(lock, [this] { return connections.empty(); });
+}
+
+void CannyServer::HandleConnection(int fd) {
+  unsigned char *segment = nullptr;
+  size_t segmentSize = 0;
+  // Private copies of the frame, the detector never touches the segment
+  std::vector<unsigned char> frameInput;
+  std::vector<unsigned char> frameOutput;
+  CannyRequest request;
+
+  while (ReadMessage(fd, &request, sizeof(request)) &&
+         request.magic == CANNY_PROTOCOL_MAGIC) {
+    CannyReply reply = {};
+    reply.magic = CANNY_PROTOCOL_MAGIC;
+
+    try {
+      if (request.type == CANNY_REQUEST_ATTACH) {
+        request.segment[CANNY_SEGMENT_NAME_SIZE - 1] = '\0';
+        int shm = shm_open(request.segment, O_RDWR, 0);
+        if (shm < 0) {
+          throw ServerErrno(std::string("shm_open ") + request.segment);
+        }
+
+        struct stat info;
+        void *mapping = MAP_FAILED;
+        if (fstat(shm, &info) == 0 && request.segmentSize > 0 &&
+            (uint64_t)info.st_size >= request.segmentSize) {
+          mapping = mmap(nullptr, request.segmentSize, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, shm, 0);
+        }
+        close(shm);
+        if (mapping == MAP_FAILED) {
+          throw ServerError(std::string("cannot map ") + request.segment);
+        }
+
+        if (segment != nullptr) {
+          munmap(segment, segmentSize);
+        }
+        segment = (unsigned char *)mapping;
+        segmentSize = request.segmentSize;
+
+      } else if (request.type == CANNY_REQUEST_DETECT) {
+        if (segment == nullptr) {
+          throw ServerError("no shared memory attached");
+        }
+        if (request.width <= 0 || request.height <= 0 ||
+            (uint64_t)request.width * request.height > INT_MAX) {
+          throw ServerError("invalid image size");
+        }
+        uint64_t size = (uint64_t)request.width * request.height;
+        if (size > segmentSize || request.inputOffset > segmentSize - size ||
+            request.outputOffset > segmentSize - size) {
+          throw ServerError("image outside of the shared memory");
+        }
+        if (request.kernelSize <= 0 || request.kernelSize % 2 == 0 ||
+            !(request.sigma > 0)) {
+          throw ServerError("kernel size must be odd and sigma positive");
+        }
+
+        // The client can shrink the segment at any time, so only this
+        // thread reads and writes it, through the guarded copies
+        frameInput.resize(size);
+        frameOutput.resize(size);
+        if (!CopyShared(frameInput.data(), segment + request.inputOffset,
+                        size)) {
+          throw ServerError("shared memory truncated by the client");
+        }
+
+        int threads = threadsPerWorker;
+        std::packaged_task<double()> frame([&] {
+          omp_set_num_threads(threads);
+          return DetectFrame(frameInput.data(), frameOutput.data(),
+                             request.width, request.height,
+                             request.lowerThreshold, request.upperThreshold,
+                             request.kernelSize, request.sigma);
+        });
+        std::future<double> detected = frame.get_future();
+        executor.Submit([&frame] { frame(); });
+        reply.detectMs = detected.get();
+
+        if (!CopyShared(segment + request.outputOffset, frameOutput.data(),
+                        size)) {
+          throw ServerError("shared memory truncated by the client");
+        }
+
+      } else {
+        throw ServerError("unknown request");
+      }
+    } catch (const std::exception &e) {
+      reply.status = -1;
+      std::strncpy(reply.error, e.what(), CANNY_ERROR_SIZE - 1);
+    }
+
+    if (!WriteMessage(fd, &reply, sizeof(reply))) {
+      break;
+    }
+  }
+
+  if (segment != nullptr) {
+    munmap(segment, segmentSize);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  close(fd);
+  connections.erase(std::find(connections.begin(), connections.end(), fd));
+  connectionClosed.notify_all();
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "canny_executor.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Edge detection service for the processes of one host, behind the
+ * canny_server executable.
+ *
+ * Processes that each link core also each start an OpenMP team, and together
+ * they oversubscribe the CPUs. The server runs every frame on a single
+ * CannyExecutor instead: `workers` frames at a time, each on its share of the
+ * OpenMP threads. Clients connect over a Unix domain socket and exchange
+ * images and edges through shared memory, see canny_protocol.h and
+ * canny_client.h.
+ *
+ * Frames are copied out of and back into the shared memory by the
+ * connection's thread with a SIGBUS guard, so a client that truncates its
+ * segment gets an error reply instead of bringing down the server. The
+ * constructor installs the SIGBUS handler, which hands other bus errors to
+ * the previous disposition. Any process allowed to connect to the socket can
+ * still name any segment the server may open, so the socket should only be
+ * reachable by trusted users.
+ */
+class CannyServer {
+public:
+  /**
+   * @brief Listen on `socketPath`, replacing a socket left there by a server
+   * that did not shut down cleanly
+   */
+  CannyServer(const std::string &socketPath, int workers = 1,
+              size_t queueDepth = 16);
+
+  /**
+   * @brief Stop listening and remove the socket
+   */
+  ~CannyServer();
+
+  CannyServer(const CannyServer &) = delete;
+  CannyServer &operator=(const CannyServer &) = delete;
+
+  /**
+   * @brief Accept clients until Stop(), then wait for the connected ones to
+   * finish their current request
+   */
+  void Serve();
+
+  /**
+   * @brief Make Serve() return. Safe to call from a signal handler.
+   */
+  void Stop();
+
+private:
+  void HandleConnection(int fd);
+
+  std::string socketPath;
+  int listenFd = -1;
+  int threadsPerWorker;
+  std::atomic<bool> stopping{false};
+
+  // Open connections, each served by a detached thread
+  std::mutex mutex;
+  std::condition_variable connectionClosed;
+  std::vector<int> connections;
+
+  // Last member, so it is destroyed first and finishes the queued frames
+  CannyExecutor executor;
+};
@@ -0,0 +1,42 @@
+#include "canny_server.h"
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+
+static CannyServer *runningServer = nullptr;
+
+static void StopServer(int) {
+  if (runningServer != nullptr) {
+    runningServer->Stop();
+  }
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 2 && argc != 3) {
+    std::cerr << "Usage: " << argv[0] << " <socket_path> [<workers>]\n";
+    return -1;
+  }
+
+  int workers = argc == 3 ? std::atoi(argv[2]) : 1;
+  if (workers <= 0) {
+    std::cerr << "Invalid worker count: " << argv[2] << "\n";
+    return -1;
+  }
+
+  try {
+    CannyServer server(argv[1], workers);
+    runningServer = &server;
+    std::signal(SIGINT, StopServer);
+    std::signal(SIGTERM, StopServer);
+
+    std::cout << "Listening on " << argv[1] << " with " << workers
+              << " worker(s)" << std::endl;
+    server.Serve();
+    runningServer = nullptr;
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << "\n";
+    return -1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,317 @@
+#include "batch_worker.h"
+#include "canny_workspace.h"
+#include "opencv2/opencv.hpp"
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <omp.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+
+#define GAUSSIAN_KERNEL_SIZE 3
+#define GAUSSIAN_KERNEL_SIGMA 0.5
+#define CANNY_GRADIENT_LOWER_THRESHOLD 100
+#define CANNY_GRADIENT_UPPER_THRESHOLD 200
+
+using BatchClock = std::chrono::steady_clock;
+
+static double SecondsSince(BatchClock::time_point start) {
+  return std::chrono::duration<double>(BatchClock::now() - start).count();
+}
+
+static bool SendAll(int fd, const char *data, size_t size) {
+  while (size > 0) {
+    ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+    if (sent < 0 && errno == EINTR) {
+      continue;
+    }
+    if (sent <= 0) {
+      return false;
+    }
+    data += sent;
+    size -= sent;
+  }
+  return true;
+}
+
+static bool ReceiveAll(int fd, char *data, size_t size) {
+  while (size > 0) {
+    ssize_t got = recv(fd, data, size, 0);
+    if (got < 0 && errno == EINTR) {
+      continue;
+    }
+    if (got <= 0) {
+      return false;
+    }
+    data += got;
+    size -= got;
+  }
+  return true;
+}
+
+bool SendBatchMessage(int fd, const void *data, uint32_t size) {
+  return SendAll(fd, (const char *)&size, sizeof(size)) &&
+         SendAll(fd, (const char *)data, size);
+}
+
+bool ReceiveBatchMessage(int fd, std::vector<char> &message) {
+  uint32_t size;
+  if (!ReceiveAll(fd, (char *)&size, sizeof(size))) {
+    return false;
+  }
+  message.resize(size);
+  return ReceiveAll(fd, message.data(), size);
+}
+
+namespace {
+
+struct BatchImage {
+  std::string output;
+  // Decoded input, then the edges to write. Empty when decoding failed.
+  cv::Mat pixels;
+};
+
+/**
+ * @brief State shared by the detector (the process' main thread) and the
+ * pool. Pool threads encode finished images first, then decode ahead while
+ * fewer than `prefetch` images wait for the detector, and fetch the next
+ * shard from the coordinator when the current one is used up.
+ */
+class BatchWorker {
+public:
+  BatchWorker(int fd, int poolThreads)
+      : fd(fd), poolThreads(poolThreads), prefetch(2 * poolThreads),
+        start(BatchClock::now()) {}
+
+  int Run() {
+    std::vector<std::thread> pool;
+    for (int i = 0; i < poolThreads; i++) {
+      pool.emplace_back(&BatchWorker::RunPool, this);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      changed.wait(lock, [this] { return !decoded.empty() || Drained(); });
+      if (decoded.empty()) {
+        break;
+      }
+      BatchImage image = std::move(decoded.front());
+      decoded.pop_front();
+      changed.notify_all();
+      lock.unlock();
+
+      BatchClock::time_point detectStart = BatchClock::now();
+      bool detected = Detect(image);
+      double seconds = SecondsSince(detectStart);
+
+      lock.lock();
+      report.detectSeconds += seconds;
+      if (detected) {
+        encoding.push_back(std::move(image));
+      } else {
+        report.failures++;
+      }
+      changed.notify_all();
+    }
+    detectorDone = true;
+    changed.notify_all();
+    lock.unlock();
+
+    for (std::thread &thread : pool) {
+      thread.join();
+    }
+
+    // Final totals, the coordinator's answer is not needed
+    BatchReport totals = Snapshot();
+    SendBatchMessage(fd, &totals, sizeof(totals));
+    return lostCoordinator ? 1 : 0;
+  }
+
+private:
+  // No image is left to decode or being decoded
+  bool Drained() const {
+    return exhausted && paths.empty() && decoding == 0 && !fetching;
+  }
+
+  BatchReport Snapshot() {
+    BatchReport totals = report;
+    totals.poolSeconds /= poolThreads;
+    totals.elapsedSeconds = SecondsSince(start);
+    return totals;
+  }
+
+  // Only called from the detector thread, which owns workspace and edges
+  bool Detect(BatchImage &image) {
+    if (image.pixels.empty()) {
+      return false;
+    }
+
+    try {
+      // Reallocates only when the size changes
+      edges.create(image.pixels.rows, image.pixels.cols, CV_8U);
+      const cv::Mat &input = image.pixels;
+      workspace.Detect(ImageView<const unsigned char>(input.data, input.cols,
+                                                      input.rows,
+                                                      input.step1()),
+                       ImageView<unsigned char>(edges.data, edges.cols,
+                                                edges.rows, edges.step1()),
+                       CANNY_GRADIENT_LOWER_THRESHOLD,
+                       CANNY_GRADIENT_UPPER_THRESHOLD, GAUSSIAN_KERNEL_SIZE,
+                       GAUSSIAN_KERNEL_SIGMA);
+      // The edges go to the encoder, the input becomes the next output
+      std::swap(image.pixels, edges);
+    } catch (const std::exception &e) {
+      std::cerr << "Error: " << image.output << ": " << e.what() << "\n";
+      return false;
+    }
+    return true;
+  }
+
+  static bool Encode(const BatchImage &image) {
+    std::filesystem::path output = image.output;
+    std::error_code error;
+    std::filesystem::create_directories(output.parent_path(), error);
+
+    try {
+      return cv::imwrite(image.output, image.pixels);
+    } catch (const std::exception &e) {
+      std::cerr << "Error: " << image.output << ": " << e.what() << "\n";
+      return false;
+    }
+  }
+
+  // Ask the coordinator for the next shard, with the mutex released
+  void Fetch(std::unique_lock<std::mutex> &lock) {
+    fetching = true;
+    BatchReport totals = Snapshot();
+    lock.unlock();
+
+    std::vector<char> shard;
+    bool received = SendBatchMessage(fd, &totals, sizeof(totals)) &&
+                    ReceiveBatchMessage(fd, shard);
+
+    lock.lock();
+    fetching = false;
+    if (!received) {
+      lostCoordinator = true;
+    }
+    if (!received || shard.empty() || shard.back() != '\0') {
+      exhausted = true;
+      return;
+    }
+
+    // Input and output paths alternate, each ended by a NUL
+    size_t at = 0;
+    while (at < shard.size()) {
+      std::string input(&shard[at]);
+      at += input.size() + 1;
+      if (at >= shard.size()) {
+        break;
+      }
+      std::string output(&shard[at]);
+      at += output.size() + 1;
+      paths.emplace_back(std::move(input), std::move(output));
+    }
+  }
+
+  void RunPool() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      if (!encoding.empty()) {
+        BatchImage image = std::move(encoding.front());
+        encoding.pop_front();
+        lock.unlock();
+
+        BatchClock::time_point encodeStart = BatchClock::now();
+        bool encoded = Encode(image);
+        double seconds = SecondsSince(encodeStart);
+
+        lock.lock();
+        report.poolSeconds += seconds;
+        if (encoded) {
+          report.images++;
+        } else {
+          report.failures++;
+        }
+        continue;
+      }
+
+      if (detectorDone) {
+        return;
+      }
+
+      if (decoded.size() + decoding < (size_t)prefetch) {
+        if (!paths.empty()) {
+          std::pair<std::string, std::string> path = std::move(paths.front());
+          paths.pop_front();
+          decoding++;
+          lock.unlock();
+
+          BatchClock::time_point decodeStart = BatchClock::now();
+          BatchImage image;
+          image.output = std::move(path.second);
+          try {
+            image.pixels = cv::imread(path.first, cv::IMREAD_GRAYSCALE);
+          } catch (const std::exception &e) {
+            std::cerr << "Error: " << path.first << ": " << e.what() << "\n";
+          }
+          if (image.pixels.empty()) {
+            std::cerr << "Error: Unable to read " << path.first << "\n";
+          }
+          double seconds = SecondsSince(decodeStart);
+
+          lock.lock();
+          report.poolSeconds += seconds;
+          decoding--;
+          decoded.push_back(std::move(image));
+          changed.notify_all();
+          continue;
+        }
+
+        if (!exhausted && !fetching) {
+          Fetch(lock);
+          changed.notify_all();
+          continue;
+        }
+      }
+
+      changed.wait(lock);
+    }
+  }
+
+  int fd;
+  int poolThreads;
+  int prefetch;
+  BatchClock::time_point start;
+
+  CannyWorkspace workspace;
+  cv::Mat edges;
+
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::deque<std::pair<std::string, std::string>> paths;
+  std::deque<BatchImage> decoded;
+  std::deque<BatchImage> encoding;
+  size_t decoding = 0;
+  bool fetching = false;
+  bool exhausted = false;
+  bool detectorDone = false;
+  bool lostCoordinator = false;
+  BatchReport report = {};
+};
+
+} // namespace
+
+int RunBatchWorker(int fd, int poolThreads, int detectThreads) {
+  omp_set_num_threads(detectThreads);
+  BatchWorker worker(fd, poolThreads);
+  int status = worker.Run();
+  close(fd);
+  return status;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Messages between canny_batch and its worker processes, over one stream
+// socket per worker. A worker asks for work with a BatchReport of what it
+// has done so far, and the coordinator answers with a shard: NUL-separated
+// input and output paths, alternating. An empty shard means no work is left.
+
+/**
+ * @brief Totals of one worker since it started
+ */
+struct BatchReport {
+  uint64_t images;
+  uint64_t failures;
+  // Time spent detecting edges, and by the pool decoding and encoding,
+  // divided by the number of pool threads
+  double detectSeconds;
+  double poolSeconds;
+  double elapsedSeconds;
+};
+
+/**
+ * @brief Send one length-prefixed message. Returns false when the peer is
+ * gone.
+ */
+bool SendBatchMessage(int fd, const void *data, uint32_t size);
+
+/**
+ * @brief Receive one length-prefixed message into `message`. Returns false
+ * when the peer is gone.
+ */
+bool ReceiveBatchMessage(int fd, std::vector<char> &message);
+
+/**
+ * @brief Worker process main loop: ask for shards on `fd` until none is left.
+ * `poolThreads` threads decode ahead of the detector, which runs on
+ * `detectThreads` OpenMP threads, and encode its results. Returns the exit
+ * status of the process.
+ */
+int RunBatchWorker(int fd, int poolThreads, int detectThreads);
@@ -0,0 +1,414 @@
+#include "batch_worker.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Images per shard handed to a worker at a time
+#define BATCH_SHARD_SIZE 64
+// Seconds between two progress lines
+#define BATCH_PROGRESS_INTERVAL 10
+// Replacement workers started for crashed ones, per initial worker, so a
+// shard that crashes every worker cannot keep the batch alive forever
+#define BATCH_RESPAWNS_PER_WORKER 1
+
+using BatchClock = std::chrono::steady_clock;
+
+struct BatchFile {
+  std::string input;
+  std::string output;
+};
+
+struct WorkerProcess {
+  pid_t pid;
+  int fd;
+  // Shards still to do, taken from the front, stolen from the back
+  std::deque<size_t> shards;
+  // Last shard sent, done again elsewhere if the worker dies
+  long inFlight = -1;
+  size_t stolen = 0;
+  // Set once the process is forked, until its socket is closed
+  bool open = false;
+  bool crashed = false;
+  BatchReport report = {};
+};
+
+static bool IsImageExtension(const std::filesystem::path &path) {
+  std::string extension = path.extension().string();
+  for (char &c : extension) {
+    c = (char)std::tolower(c);
+  }
+  return extension == ".jpg" || extension == ".jpeg" || extension == ".png" ||
+         extension == ".bmp" || extension == ".tif" || extension == ".tiff" ||
+         extension == ".pgm" || extension == ".ppm" || extension == ".webp";
+}
+
+// Output path of an input relative to the output directory, as a PNG named
+// after the whole file name, so a.jpg and a.png do not share one. Root and
+// ".." components are dropped so nothing is written outside of it.
+static std::string OutputPath(const std::filesystem::path &outputDir,
+                              const std::filesystem::path &relative) {
+  std::filesystem::path output = outputDir;
+  for (const std::filesystem::path &part :
+       relative.lexically_normal().relative_path()) {
+    if (part != "..") {
+      output /= part;
+    }
+  }
+  output += ".png";
+  return output.string();
+}
+
+/**
+ * @brief Fail when two inputs would be written to the same output, which
+ * dropping ".." or a repeated line of a file list can cause
+ */
+static void CheckOutputsUnique(const std::vector<BatchFile> &files) {
+  std::vector<const BatchFile *> byOutput;
+  for (const BatchFile &file : files) {
+    byOutput.push_back(&file);
+  }
+  std::sort(byOutput.begin(), byOutput.end(),
+            [](const BatchFile *a, const BatchFile *b) {
+              return a->output < b->output;
+            });
+  for (size_t i = 1; i < byOutput.size(); i++) {
+    if (byOutput[i]->output == byOutput[i - 1]->output) {
+      throw std::runtime_error("Both " + byOutput[i - 1]->input + " and " +
+                               byOutput[i]->input + " would be written to " +
+                               byOutput[i]->output);
+    }
+  }
+}
+
+/**
+ * @brief Every image under a directory, or every line of a file list
+ */
+static std::vector<BatchFile>
+ListFiles(const std::filesystem::path &input,
+          const std::filesystem::path &outputDir) {
+  std::vector<BatchFile> files;
+
+  if (std::filesystem::is_directory(input)) {
+    for (const std::filesystem::directory_entry &entry :
+         std::filesystem::recursive_directory_iterator(input)) {
+      if (entry.is_regular_file() && IsImageExtension(entry.path())) {
+        files.push_back(
+            {entry.path().string(),
+             OutputPath(outputDir, entry.path().lexically_relative(input))});
+      }
+    }
+    // Neighbouring files usually sit together on disk, keep them in a shard
+    std::sort(files.begin(), files.end(),
+              [](const BatchFile &a, const BatchFile &b) {
+                return a.input < b.input;
+              });
+    CheckOutputsUnique(files);
+    return files;
+  }
+
+  std::ifstream list(input);
+  if (!list) {
+    throw std::runtime_error("Unable to read " + input.string());
+  }
+  std::string line;
+  while (std::getline(list, line)) {
+    if (!line.empty()) {
+      files.push_back({line, OutputPath(outputDir, line)});
+    }
+  }
+  CheckOutputsUnique(files);
+  return files;
+}
+
+static std::vector<char> ShardMessage(const std::vector<BatchFile> &files,
+                                      size_t shard) {
+  std::vector<char> message;
+  size_t end = std::min(files.size(), (shard + 1) * BATCH_SHARD_SIZE);
+  for (size_t i = shard * BATCH_SHARD_SIZE; i < end; i++) {
+    message.insert(message.end(), files[i].input.begin(),
+                   files[i].input.end());
+    message.push_back('\0');
+    message.insert(message.end(), files[i].output.begin(),
+                   files[i].output.end());
+    message.push_back('\0');
+  }
+  return message;
+}
+
+/**
+ * @brief Next shard for a worker: the front of its own queue, or else the
+ * back half of the longest queue. Returns -1 when no work is left.
+ */
+static long NextShard(std::vector<WorkerProcess> &workers, size_t thief) {
+  WorkerProcess &worker = workers[thief];
+  if (worker.shards.empty()) {
+    size_t victim = thief;
+    for (size_t i = 0; i < workers.size(); i++) {
+      if (workers[i].shards.size() > workers[victim].shards.size()) {
+        victim = i;
+      }
+    }
+
+    size_t count = (workers[victim].shards.size() + 1) / 2;
+    for (size_t i = 0; i < count; i++) {
+      worker.shards.push_front(workers[victim].shards.back());
+      workers[victim].shards.pop_back();
+    }
+    worker.stolen += count;
+  }
+
+  if (worker.shards.empty()) {
+    return -1;
+  }
+  long shard = (long)worker.shards.front();
+  worker.shards.pop_front();
+  return shard;
+}
+
+static uint64_t TotalImages(const std::vector<WorkerProcess> &workers) {
+  uint64_t images = 0;
+  for (const WorkerProcess &worker : workers) {
+    images += worker.report.images + worker.report.failures;
+  }
+  return images;
+}
+
+/**
+ * @brief Fork the process of workers[w], connected to this one by a socket.
+ * Only called while this process runs no other thread.
+ */
+static bool SpawnWorker(std::vector<WorkerProcess> &workers, size_t w,
+                        int poolThreads, int detectThreads) {
+  int pair[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) != 0) {
+    std::cerr << "Error: socketpair failed\n";
+    return false;
+  }
+
+  // The child must not inherit buffered output
+  std::cout.flush();
+  pid_t pid = fork();
+  if (pid < 0) {
+    std::cerr << "Error: fork failed\n";
+    close(pair[0]);
+    close(pair[1]);
+    return false;
+  }
+  if (pid == 0) {
+    close(pair[0]);
+    for (size_t other = 0; other < workers.size(); other++) {
+      if (other != w && workers[other].open) {
+        close(workers[other].fd);
+      }
+    }
+    _exit(RunBatchWorker(pair[1], poolThreads, detectThreads));
+  }
+
+  close(pair[1]);
+  workers[w].pid = pid;
+  workers[w].fd = pair[0];
+  workers[w].open = true;
+  return true;
+}
+
+/**
+ * @brief Hand out the shards until every worker has closed its socket. A
+ * worker that crashes with shards left in its queue, including the one it
+ * was working on, is replaced by a new process that takes them over, so the
+ * work is finished even when no other worker is left to steal it.
+ */
+static void Coordinate(const std::vector<BatchFile> &files,
+                       std::vector<WorkerProcess> &workers, int poolThreads,
+                       int detectThreads) {
+  BatchClock::time_point lastProgress = BatchClock::now();
+  size_t openWorkers = workers.size();
+  size_t respawns = workers.size() * BATCH_RESPAWNS_PER_WORKER;
+  std::vector<char> message;
+
+  while (openWorkers > 0) {
+    std::vector<pollfd> fds;
+    std::vector<size_t> owners;
+    for (size_t i = 0; i < workers.size(); i++) {
+      if (workers[i].open) {
+        fds.push_back({workers[i].fd, POLLIN, 0});
+        owners.push_back(i);
+      }
+    }
+
+    if (poll(fds.data(), fds.size(), 1000) < 0 && errno != EINTR) {
+      throw std::runtime_error("poll failed");
+    }
+
+    std::vector<size_t> crashed;
+    for (size_t f = 0; f < fds.size(); f++) {
+      if (fds[f].revents == 0) {
+        continue;
+      }
+      WorkerProcess &worker = workers[owners[f]];
+
+      if (!ReceiveBatchMessage(worker.fd, message) ||
+          message.size() != sizeof(BatchReport)) {
+        // The worker is gone, its last shard may not be done. The final
+        // report comes after an empty shard, so a clean exit has none.
+        if (worker.inFlight >= 0) {
+          worker.shards.push_front((size_t)worker.inFlight);
+          worker.crashed = true;
+        }
+        worker.open = false;
+        close(worker.fd);
+        openWorkers--;
+        if (worker.crashed && !worker.shards.empty()) {
+          crashed.push_back(owners[f]);
+        }
+        continue;
+      }
+
+      std::copy(message.begin(), message.end(), (char *)&worker.report);
+      long shard = NextShard(workers, owners[f]);
+      worker.inFlight = shard;
+      std::vector<char> reply;
+      if (shard >= 0) {
+        reply = ShardMessage(files, (size_t)shard);
+      }
+      // A worker sending its final report does not read the answer
+      SendBatchMessage(worker.fd, reply.data(), (uint32_t)reply.size());
+    }
+
+    // Appending invalidates references into workers, so after the loop
+    for (size_t dead : crashed) {
+      if (respawns == 0) {
+        std::cerr << "Error: worker " << workers[dead].pid
+                  << " crashed, no replacement left\n";
+        continue;
+      }
+      respawns--;
+      workers.emplace_back();
+      size_t w = workers.size() - 1;
+      workers[w].shards.swap(workers[dead].shards);
+      if (!SpawnWorker(workers, w, poolThreads, detectThreads)) {
+        workers[dead].shards.swap(workers[w].shards);
+        workers.pop_back();
+        continue;
+      }
+      std::cerr << "Worker " << workers[dead].pid << " crashed, worker "
+                << workers[w].pid << " takes over its "
+                << workers[w].shards.size() << " shards\n";
+      openWorkers++;
+    }
+
+    if (BatchClock::now() - lastProgress >=
+        std::chrono::seconds(BATCH_PROGRESS_INTERVAL)) {
+      lastProgress = BatchClock::now();
+      std::cout << "Progress: " << TotalImages(workers) << "/" << files.size()
+                << " images" << std::endl;
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 3 || argc > 5) {
+    std::cerr << "Usage: " << argv[0]
+              << " <image_dir or file_list> <output_dir> [<workers> "
+              << "[<pool_threads>]]\n";
+    return -1;
+  }
+
+  int cores = std::max(1u, std::thread::hardware_concurrency());
+  int workerCount = argc >= 4 ? std::atoi(argv[3]) : std::max(1, cores / 4);
+  int poolThreads = argc >= 5 ? std::atoi(argv[4]) : 2;
+  if (workerCount <= 0 || poolThreads <= 0) {
+    std::cerr << "Invalid worker or thread count\n";
+    return -1;
+  }
+
+  std::vector<BatchFile> files;
+  try {
+    files = ListFiles(argv[1], argv[2]);
+  } catch (const std::exception &e) {
+    std::cerr << "Error: " << e.what() << "\n";
+    return -1;
+  }
+  std::cout << "Images: " << files.size() << ", workers: " << workerCount
+            << ", pool threads per worker: " << poolThreads << "\n";
+
+  size_t shardCount = (files.size() + BATCH_SHARD_SIZE - 1) / BATCH_SHARD_SIZE;
+  // Each worker shares out the cores with the others for its detector
+  int detectThreads = std::max(1, cores / workerCount);
+  BatchClock::time_point start = BatchClock::now();
+
+  // Workers are forked while this process runs no other thread
+  std::vector<WorkerProcess> workers(workerCount);
+  for (int w = 0; w < workerCount; w++) {
+    if (!SpawnWorker(workers, w, poolThreads, detectThreads)) {
+      return -1;
+    }
+    // Contiguous shards first, stealing only evens out the end
+    for (size_t s = shardCount * w / workerCount;
+         s < shardCount * (w + 1) / workerCount; s++) {
+      workers[w].shards.push_back(s);
+    }
+  }
+
+  int status = 0;
+  try {
+    Coordinate(files, workers, poolThreads, detectThreads);
+  } catch (const std::exception &e) {
+    std::cerr << "Error: " << e.what() << "\n";
+    status = -1;
+  }
+
+  for (WorkerProcess &worker : workers) {
+    int workerStatus;
+    waitpid(worker.pid, &workerStatus, 0);
+    if (worker.crashed || !WIFEXITED(workerStatus) ||
+        WEXITSTATUS(workerStatus) != 0) {
+      std::cerr << "Error: worker " << worker.pid << " failed\n";
+      status = -1;
+    }
+  }
+
+  size_t unprocessed = 0;
+  for (const WorkerProcess &worker : workers) {
+    unprocessed += worker.shards.size();
+  }
+  if (unprocessed > 0) {
+    std::cerr << "Error: " << unprocessed << " shards were not processed\n";
+    status = -1;
+  }
+
+  double seconds =
+      std::chrono::duration<double>(BatchClock::now() - start).count();
+  uint64_t images = 0;
+  uint64_t failures = 0;
+  for (const WorkerProcess &worker : workers) {
+    images += worker.report.images;
+    failures += worker.report.failures;
+  }
+
+  std::cout << "Processed " << images << " images (" << failures
+            << " failed) in " << seconds << " s: " << images / seconds
+            << " images/s\n";
+  for (size_t w = 0; w < workers.size(); w++) {
+    const BatchReport &report = workers[w].report;
+    double elapsed = std::max(report.elapsedSeconds, 1e-9);
+    std::cout << "Worker " << w << ": " << report.images << " images, "
+              << "detector busy " << 100 * report.detectSeconds / elapsed
+              << "%, pool busy " << 100 * report.poolSeconds / elapsed
+              << "%, " << workers[w].stolen << " shards stolen\n";
+  }
+
+  return status;
+}
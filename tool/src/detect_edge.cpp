@@ -1,80 +1,381 @@
 
 
+#include "canny_workspace.h"
 #include "fast_canny.h"
+#include "frame_stream.h"
+#include "mapped_image.h"
 #include "opencv2/opencv.hpp"
+#include "spsc_ring.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
 #include <filesystem>
 #include <iostream>
+#include <thread>
+#include <unistd.h>
+#include <vector>
 
 #define GAUSSIAN_KERNEL_SIZE 3
 #define GAUSSIAN_KERNEL_SIGMA 0.5
 #define CANNY_GRADIENT_LOWER_THRESHOLD 100
 #define CANNY_GRADIENT_UPPER_THRESHOLD 200
+// Frames waiting between two stages of the directory pipeline
+#define DIRECTORY_PIPELINE_DEPTH 4
+
+/**
+ * @brief Write the edges into the working directory. Raw, PGM and PBM
+ * inputs keep their format and are written through a memory mapping, anything
+ * else goes through cv::imwrite as PNG.
+ */
+static bool WriteEdges(const std::string &mode, const cv::Mat &edges,
+                       bool mapped, MappedImageFormat format,
+                       const std::string &extension) {
+  if (!mapped) {
+    return cv::imwrite("edges_" + mode + ".png", edges);
+  }
+
+  // The fast modes already give doubles
+  cv::Mat edgesDouble = edges;
+  if (edges.type() != CV_64F) {
+    edges.convertTo(edgesDouble, CV_64F);
+  }
+
+  try {
+    MappedImage output = MappedImage::Create(
+        "edges_" + mode + extension, format, edges.cols, edges.rows);
+    WriteMappedEdges(edgesDouble.ptr<double>(), output);
+  } catch (const std::runtime_error &e) {
+    std::cerr << e.what() << "\n";
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief The fast mode on a mapped 8-bit raw or PGM image, straight from the
+ * input mapping into the output one without converting to doubles
+ */
+static bool DetectMappedBytes(const MappedImage &input,
+                              const std::string &extension) {
+  try {
+    MappedImage output = MappedImage::Create(
+        "edges_fast" + extension, input.format, input.width, input.height);
+    CannyWorkspace workspace;
+    workspace.Detect(ImageView<const unsigned char>(input.pixels, input.width,
+                                                    input.height),
+                     ImageView<unsigned char>(output.pixels, output.width,
+                                              output.height),
+                     CANNY_GRADIENT_LOWER_THRESHOLD,
+                     CANNY_GRADIENT_UPPER_THRESHOLD, GAUSSIAN_KERNEL_SIZE,
+                     GAUSSIAN_KERNEL_SIGMA);
+  } catch (const std::runtime_error &e) {
+    std::cerr << e.what() << "\n";
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Run one mode on a decoded image: `image` is 8-bit (BGR for `color`)
+ * and `imageDouble` its CV_64F copy, which `color` and `opencv` do not use.
+ * The thresholds of `median`/`otsu` are returned through the last two
+ * arguments.
+ */
+static cv::Mat DetectEdges(const std::string &mode, const cv::Mat &image,
+                           const cv::Mat &imageDouble, int *lowerThreshold,
+                           int *upperThreshold) {
+  *lowerThreshold = CANNY_GRADIENT_LOWER_THRESHOLD;
+  *upperThreshold = CANNY_GRADIENT_UPPER_THRESHOLD;
+
+  if (mode == "fast") {
+    // Decoded from 8 bits, so always in range
+    return *FastCanny(imageDouble, CANNY_GRADIENT_LOWER_THRESHOLD,
+                      CANNY_GRADIENT_UPPER_THRESHOLD, GAUSSIAN_KERNEL_SIZE,
+                      GAUSSIAN_KERNEL_SIGMA, RangeCheck::Skip);
+  }
+
+  if (mode == "color") {
+    return *FastCannyBGR(image, CANNY_GRADIENT_LOWER_THRESHOLD,
+                         CANNY_GRADIENT_UPPER_THRESHOLD, GAUSSIAN_KERNEL_SIZE,
+                         GAUSSIAN_KERNEL_SIGMA);
+  }
+
+  if (mode == "median" || mode == "otsu") {
+    // Thresholds follow the image's own gradient distribution
+    return *FastCanny(
+        imageDouble,
+        mode == "otsu" ? ThresholdMethod::Otsu : ThresholdMethod::Median,
+        GAUSSIAN_KERNEL_SIZE, GAUSSIAN_KERNEL_SIGMA, lowerThreshold,
+        upperThreshold);
+  }
+
+  cv::Mat blurredImage;
+  cv::GaussianBlur(image, blurredImage,
+                   cv::Size(GAUSSIAN_KERNEL_SIZE, GAUSSIAN_KERNEL_SIZE),
+                   GAUSSIAN_KERNEL_SIGMA, cv::BORDER_CONSTANT, 0);
+
+  cv::Mat edges;
+  cv::Canny(blurredImage, edges, CANNY_GRADIENT_LOWER_THRESHOLD,
+            CANNY_GRADIENT_UPPER_THRESHOLD, 3);
+  return edges;
+}
+
+// An image on its way through the directory pipeline
+struct PipelineFrame {
+  std::filesystem::path path;
+  cv::Mat image;
+  cv::Mat imageDouble;
+  // Set by the detector, empty when reading or detecting failed
+  cv::Mat edges;
+  // Marks the end of the directory
+  bool last = false;
+};
+
+/**
+ * @brief Run a mode on every image of a directory, writing the edges of
+ * `a.jpg` to `edges_<mode>/a.jpg.png`. Reading, detection and writing are
+ * three threads connected by SPSC rings, so decoding and encoding overlap with
+ * detection, and at most DIRECTORY_PIPELINE_DEPTH frames wait between two
+ * stages.
+ */
+static int DetectDirectory(const std::string &mode,
+                           const std::filesystem::path &directory) {
+  std::vector<std::filesystem::path> paths;
+  for (const auto &p : std::filesystem::directory_iterator(directory)) {
+    if (p.is_regular_file()) {
+      paths.push_back(p.path());
+    }
+  }
+  std::sort(paths.begin(), paths.end());
+
+  std::filesystem::path outputDirectory = "edges_" + mode;
+  std::error_code error;
+  std::filesystem::create_directories(outputDirectory, error);
+  if (error) {
+    std::cerr << "Error: Unable to create " << outputDirectory << "\n";
+    return -1;
+  }
+
+  SpscRing<PipelineFrame> decoded(DIRECTORY_PIPELINE_DEPTH);
+  SpscRing<PipelineFrame> detected(DIRECTORY_PIPELINE_DEPTH);
+  std::atomic<int> failures{0};
+  double readSeconds = 0;
+  double writeSeconds = 0;
+  double detectSeconds = 0;
+  auto start = std::chrono::steady_clock::now();
+
+  std::thread reader([&] {
+    for (const std::filesystem::path &path : paths) {
+      auto stageStart = std::chrono::steady_clock::now();
+      PipelineFrame frame;
+      frame.path = path;
+      frame.image = cv::imread(path.string(), mode == "color"
+                                                  ? cv::IMREAD_COLOR
+                                                  : cv::IMREAD_GRAYSCALE);
+      if (!frame.image.empty() && mode != "color" && mode != "opencv") {
+        frame.image.convertTo(frame.imageDouble, CV_64F);
+      }
+      readSeconds += std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - stageStart)
+                         .count();
+      decoded.Push(std::move(frame));
+    }
+
+    PipelineFrame end;
+    end.last = true;
+    decoded.Push(std::move(end));
+  });
+
+  std::thread writer([&] {
+    while (true) {
+      PipelineFrame frame = detected.Pop();
+      if (frame.last) {
+        return;
+      }
+
+      auto stageStart = std::chrono::steady_clock::now();
+      // The input's extension stays in the name, a.jpg and a.png are two
+      // different outputs
+      std::filesystem::path output =
+          outputDirectory / (frame.path.filename().string() + ".png");
+      if (frame.edges.empty() || !cv::imwrite(output.string(), frame.edges)) {
+        std::cerr << "Error: Unable to process " << frame.path << "\n";
+        failures++;
+      }
+      writeSeconds += std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - stageStart)
+                          .count();
+    }
+  });
+
+  while (true) {
+    PipelineFrame frame = decoded.Pop();
+    if (!frame.last && !frame.image.empty()) {
+      auto stageStart = std::chrono::steady_clock::now();
+      try {
+        int lowerThreshold;
+        int upperThreshold;
+        frame.edges = DetectEdges(mode, frame.image, frame.imageDouble,
+                                  &lowerThreshold, &upperThreshold);
+      } catch (const std::exception &e) {
+        std::cerr << "Error: " << frame.path << ": " << e.what() << "\n";
+      }
+      detectSeconds += std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - stageStart)
+                           .count();
+      // The writer only needs the edges
+      frame.image.release();
+      frame.imageDouble.release();
+    }
+
+    bool last = frame.last;
+    detected.Push(std::move(frame));
+    if (last) {
+      break;
+    }
+  }
+
+  reader.join();
+  writer.join();
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  std::cout << "Images: " << paths.size() << " (" << failures
+            << " failed) in " << seconds << " s, "
+            << paths.size() / seconds << " images/s\n";
+  std::cout << "Busy time (s): read " << readSeconds << ", detect "
+            << detectSeconds << ", write " << writeSeconds << "\n";
+  std::cout << "Edges written to " << outputDirectory << "\n";
+
+  return failures > 0 ? -1 : 0;
+}
 
 int main(int argc, char *argv[]) {
 
-  if (argc != 3) {
-    std::cerr << "Usage: " << argv[0] << " fast/opencv "
-              << "<coco_image_path>\n";
+  if (argc != 3 && argc != 4) {
+    std::cerr << "Usage: " << argv[0] << " fast/color/median/otsu/opencv "
+              << "<coco_image_path or directory> "
+              << "[<width>x<height> for .raw input]\n"
+              << "       " << argv[0] << " stream <width>x<height> "
+              << "< frames.raw > edges.raw\n";
 
     return -1;
   }
 
   std::string mode = argv[1];
 
-  if (mode != "fast" && mode != "opencv") {
+  if (mode == "stream") {
+    // Raw gray frames from stdin to raw edge frames on stdout
+    int width = 0;
+    int height = 0;
+    if (std::sscanf(argv[2], "%dx%d", &width, &height) != 2) {
+      std::cerr << "Error: Streams need the frame size as <width>x<height>\n";
+      return -1;
+    }
+    return StreamRawFrames(STDIN_FILENO, STDOUT_FILENO, width, height,
+                           CANNY_GRADIENT_LOWER_THRESHOLD,
+                           CANNY_GRADIENT_UPPER_THRESHOLD,
+                           GAUSSIAN_KERNEL_SIZE, GAUSSIAN_KERNEL_SIGMA);
+  }
+
+  if (mode != "fast" && mode != "color" && mode != "median" &&
+      mode != "otsu" && mode != "opencv") {
     std::cerr << "Invalid mode: " << mode << "\n";
     return -1;
   }
 
   std::filesystem::path cocoImagePath = (std::string)argv[2];
 
-  std::cout << "Coco image path: " << cocoImagePath << "\n";
-
-  cv::Mat image = cv::imread(cocoImagePath.string(), cv::IMREAD_GRAYSCALE);
-
-  if (image.empty()) {
-    std::cerr << "Error: Unable to read image\n";
-    return -1;
+  if (std::filesystem::is_directory(cocoImagePath)) {
+    return DetectDirectory(mode, cocoImagePath);
   }
 
+  std::cout << "Coco image path: " << cocoImagePath << "\n";
+
+  cv::Mat image;
   cv::Mat imageDouble;
-  image.convertTo(imageDouble, CV_64F);
+  MappedImageFormat format = MappedImageFormat::Raw;
+  // Color input is read as interleaved BGR and converted by FastCannyBGR
+  bool mapped = mode != "color" &&
+                MappedImageFormatFromPath(cocoImagePath.string(), &format);
 
-  if (mode == "fast") {
+  if (mode == "color") {
+    image = cv::imread(cocoImagePath.string(), cv::IMREAD_COLOR);
 
-    auto edges = FastCanny(imageDouble, CANNY_GRADIENT_LOWER_THRESHOLD,
-                           CANNY_GRADIENT_UPPER_THRESHOLD, GAUSSIAN_KERNEL_SIZE,
-                           GAUSSIAN_KERNEL_SIGMA);
+    if (image.empty()) {
+      std::cerr << "Error: Unable to read image\n";
+      return -1;
+    }
+  } else if (mapped) {
+    // Uncompressed inputs are mapped and converted straight from the page
+    // cache instead of being decoded by imread
+    int rawWidth = 0;
+    int rawHeight = 0;
+    if (format == MappedImageFormat::Raw &&
+        (argc != 4 ||
+         std::sscanf(argv[3], "%dx%d", &rawWidth, &rawHeight) != 2)) {
+      std::cerr << "Error: Raw images need their size as <width>x<height>\n";
+      return -1;
+    }
 
-    auto edgesData = edges.get();
+    try {
+      MappedImage input =
+          MappedImage::Open(cocoImagePath.string(), rawWidth, rawHeight);
+      // Pixels that are already 0-255 bytes are used as they are, only PBM
+      // and PGM with a smaller maxval are expanded to doubles
+      bool bytes = input.format != MappedImageFormat::Pbm &&
+                   input.maxValue == 255;
+      if (bytes && mode == "fast") {
+        if (!DetectMappedBytes(input, cocoImagePath.extension().string())) {
+          std::cerr << "Error: Unable to write image\n";
+          return -1;
+        }
+        return 0;
+      }
 
-    bool success = cv::imwrite("edges_" + mode + ".png", *edgesData);
+      if (bytes && mode == "opencv") {
+        image = cv::Mat(input.height, input.width, CV_8U, input.pixels).clone();
+      } else {
+        imageDouble.create(input.height, input.width, CV_64F);
+        ReadMappedPixels(input, imageDouble.ptr<double>());
+      }
+    } catch (const std::runtime_error &e) {
+      std::cerr << "Error: Unable to read image: " << e.what() << "\n";
+      return -1;
+    }
 
-    if (!success) {
-      std::cerr << "Error: Unable to write image\n";
+    if (mode == "opencv" && image.empty()) {
+      imageDouble.convertTo(image, CV_8U);
+    }
+  } else {
+    image = cv::imread(cocoImagePath.string(), cv::IMREAD_GRAYSCALE);
+
+    if (image.empty()) {
+      std::cerr << "Error: Unable to read image\n";
       return -1;
     }
 
-  } else if (mode == "opencv") {
+    image.convertTo(imageDouble, CV_64F);
+  }
 
-    cv::Mat blurredImage;
-    cv::GaussianBlur(image, blurredImage,
-                     cv::Size(GAUSSIAN_KERNEL_SIZE, GAUSSIAN_KERNEL_SIZE),
-                     GAUSSIAN_KERNEL_SIGMA, cv::BORDER_CONSTANT, 0);
+  std::string extension = cocoImagePath.extension().string();
 
-    cv::Mat edges;
-    cv::Canny(blurredImage, edges, CANNY_GRADIENT_LOWER_THRESHOLD,
-              CANNY_GRADIENT_UPPER_THRESHOLD, 3);
+  int lowerThreshold;
+  int upperThreshold;
+  cv::Mat edges =
+      DetectEdges(mode, image, imageDouble, &lowerThreshold, &upperThreshold);
 
-    bool success = cv::imwrite("edges_" + mode + ".png", edges);
+  if (mode == "median" || mode == "otsu") {
+    std::cout << "Thresholds: " << lowerThreshold << "/" << upperThreshold
+              << "\n";
+  }
 
-    if (!success) {
-      std::cerr << "Error: Unable to write image\n";
-      return -1;
-    }
+  bool success = WriteEdges(mode, edges, mapped, format, extension);
 
-  } else {
-    std::cerr << "Invalid mode: " << mode << "\n";
+  if (!success) {
+    std::cerr << "Error: Unable to write image\n";
     return -1;
   }
 
@@ -0,0 +1,234 @@
+#include "frame_stream.h"
+#include "canny_workspace.h"
+#include "spsc_ring.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Buffers on each side of the detector: one being filled or drained while
+// the detector works on the other
+#define FRAME_STREAM_BUFFERS 2
+// Pipe size requested so a whole frame moves in few system calls
+#define FRAME_STREAM_PIPE_SIZE (1 << 20)
+// Latencies kept for the percentiles, a uniform sample of all frames once
+// more were written, so an endless stream uses bounded memory
+#define FRAME_STREAM_LATENCY_SAMPLES 4096
+
+using StreamClock = std::chrono::steady_clock;
+
+struct StreamSlot {
+  int buffer = 0;
+  // When the input frame was fully read
+  StreamClock::time_point readAt;
+  bool last = false;
+};
+
+/**
+ * @brief Read exactly `size` bytes unless the input ends. Returns the number
+ * of bytes read, or -1 on error.
+ */
+static long ReadFull(int fd, unsigned char *data, size_t size) {
+  size_t done = 0;
+  while (done < size) {
+    ssize_t got = read(fd, data + done, size - done);
+    if (got < 0 && errno == EINTR) {
+      continue;
+    }
+    if (got < 0) {
+      return -1;
+    }
+    if (got == 0) {
+      break;
+    }
+    done += got;
+  }
+  return (long)done;
+}
+
+static bool WriteFull(int fd, const unsigned char *data, size_t size) {
+  while (size > 0) {
+    ssize_t written = write(fd, data, size);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+/**
+ * @brief Fixed-size uniform sample of a stream of values (reservoir
+ * sampling), with the exact count and maximum
+ */
+class LatencySample {
+public:
+  void Add(double value) {
+    count++;
+    max = std::max(max, value);
+    if (values.size() < FRAME_STREAM_LATENCY_SAMPLES) {
+      values.push_back(value);
+      return;
+    }
+    size_t at = std::uniform_int_distribution<size_t>(0, count - 1)(random);
+    if (at < values.size()) {
+      values[at] = value;
+    }
+  }
+
+  size_t count = 0;
+  double max = 0;
+  std::vector<double> values;
+
+private:
+  std::mt19937_64 random;
+};
+
+static double Percentile(std::vector<double> &values, double fraction) {
+  size_t at = std::min(values.size() - 1, (size_t)(fraction * values.size()));
+  std::nth_element(values.begin(), values.begin() + at, values.end());
+  return values[at];
+}
+
+int StreamRawFrames(int inputFd, int outputFd, int width, int height,
+                    int lowerThreshold, int upperThreshold, int kernelSize,
+                    double sigma) {
+  if (width <= 0 || height <= 0) {
+    std::cerr << "Error: Frame size must be positive\n";
+    return -1;
+  }
+
+  size_t frameSize = (size_t)width * height;
+  // Larger pipes where the system allows it, fails harmlessly on files
+  fcntl(inputFd, F_SETPIPE_SZ, FRAME_STREAM_PIPE_SIZE);
+  fcntl(outputFd, F_SETPIPE_SZ, FRAME_STREAM_PIPE_SIZE);
+  // A closed reader shows up as a failed write instead of killing us
+  std::signal(SIGPIPE, SIG_IGN);
+
+  std::vector<unsigned char> inputs(FRAME_STREAM_BUFFERS * frameSize);
+  std::vector<unsigned char> outputs(FRAME_STREAM_BUFFERS * frameSize);
+  // Buffers travel from the free ring of a side to its filled ring and back
+  SpscRing<StreamSlot> freeInputs(FRAME_STREAM_BUFFERS);
+  SpscRing<StreamSlot> readFrames(FRAME_STREAM_BUFFERS);
+  SpscRing<StreamSlot> freeOutputs(FRAME_STREAM_BUFFERS);
+  SpscRing<StreamSlot> edgeFrames(FRAME_STREAM_BUFFERS);
+  for (int i = 0; i < FRAME_STREAM_BUFFERS; i++) {
+    StreamSlot slot;
+    slot.buffer = i;
+    freeInputs.Push(slot);
+    freeOutputs.Push(slot);
+  }
+
+  // A failed write stops the reader, a truncated or unreadable input still
+  // lets the frames before it through
+  std::atomic<bool> writeFailed{false};
+  bool readFailed = false;
+  LatencySample latencies;
+  double detectTotal = 0;
+  size_t detections = 0;
+  StreamClock::time_point start = StreamClock::now();
+
+  std::thread reader([&] {
+    while (!writeFailed) {
+      StreamSlot slot = freeInputs.Pop();
+      long got = ReadFull(inputFd, &inputs[slot.buffer * frameSize],
+                          frameSize);
+      if (got < 0) {
+        std::cerr << "Error: Unable to read frame: " << std::strerror(errno)
+                  << "\n";
+        readFailed = true;
+        break;
+      }
+      if (got == 0) {
+        break;
+      }
+      if (got != (long)frameSize) {
+        std::cerr << "Error: Input ended inside a frame\n";
+        readFailed = true;
+        break;
+      }
+      slot.readAt = StreamClock::now();
+      readFrames.Push(slot);
+    }
+
+    StreamSlot end;
+    end.last = true;
+    readFrames.Push(end);
+  });
+
+  std::thread writer([&] {
+    while (true) {
+      StreamSlot slot = edgeFrames.Pop();
+      if (slot.last) {
+        return;
+      }
+
+      // Keep draining after a failure so the detector never blocks
+      if (!writeFailed) {
+        if (WriteFull(outputFd, &outputs[slot.buffer * frameSize],
+                      frameSize)) {
+          latencies.Add(std::chrono::duration<double, std::milli>(
+                            StreamClock::now() - slot.readAt)
+                            .count());
+        } else {
+          std::cerr << "Error: Unable to write frame\n";
+          writeFailed = true;
+        }
+      }
+      freeOutputs.Push(slot);
+    }
+  });
+
+  CannyWorkspace workspace;
+  while (true) {
+    StreamSlot input = readFrames.Pop();
+    if (input.last) {
+      edgeFrames.Push(input);
+      break;
+    }
+
+    StreamSlot output = freeOutputs.Pop();
+    StreamClock::time_point detectStart = StreamClock::now();
+    workspace.Detect(ImageView<const unsigned char>(
+                         &inputs[input.buffer * frameSize], width, height),
+                     ImageView<unsigned char>(
+                         &outputs[output.buffer * frameSize], width, height),
+                     lowerThreshold, upperThreshold, kernelSize, sigma);
+    detectTotal += std::chrono::duration<double, std::milli>(
+                       StreamClock::now() - detectStart)
+                       .count();
+    detections++;
+
+    output.readAt = input.readAt;
+    freeInputs.Push(input);
+    edgeFrames.Push(output);
+  }
+
+  reader.join();
+  writer.join();
+  double seconds =
+      std::chrono::duration<double>(StreamClock::now() - start).count();
+
+  std::cerr << "Frames: " << latencies.count << " in " << seconds << " s, "
+            << latencies.count / seconds << " fps\n";
+  if (latencies.count > 0) {
+    std::cerr << "Latency (ms): median " << Percentile(latencies.values, 0.5)
+              << ", p99 " << Percentile(latencies.values, 0.99) << ", max "
+              << latencies.max << "\n";
+    std::cerr << "Detection (ms): mean " << detectTotal / detections << "\n";
+  }
+
+  return writeFailed || readFailed ? -1 : 0;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+/**
+ * @brief Detect the edges of raw 8-bit `width` x `height` frames read back to
+ * back from `inputFd` (e.g. `ffmpeg -f rawvideo -pix_fmt gray -`) and write
+ * them as raw 0/255 frames of the same size to `outputFd`, until the input
+ * ends.
+ *
+ * Frames are read, detected and written on three threads with two buffers
+ * on each side, so I/O overlaps with detection, and one CannyWorkspace is
+ * reused for every frame. Frame rate and per-frame latency, from the end of
+ * a frame's read to the end of its write, are printed to stderr at the end;
+ * the latency percentiles come from a bounded sample of the frames.
+ * Returns 0, or -1 if a read failed, the input ended inside a frame or a
+ * write failed.
+ */
+int StreamRawFrames(int inputFd, int outputFd, int width, int height,
+                    int lowerThreshold, int upperThreshold, int kernelSize,
+                    double sigma);
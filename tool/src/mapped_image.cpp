@@ -0,0 +1,272 @@
+#include "mapped_image.h"
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+static std::runtime_error MappingError(const std::string &what,
+                                       const std::string &path) {
+  return std::runtime_error("MappedImage failed: " + what + " " + path + ": " +
+                            std::strerror(errno));
+}
+
+/**
+ * @brief Read the next decimal field of a PNM header, skipping whitespace and
+ * comments. Returns false when the header ends early or is malformed.
+ */
+static bool ReadHeaderField(const unsigned char *data, size_t size,
+                            size_t *pos, int *value) {
+  while (*pos < size) {
+    if (data[*pos] == '#') {
+      while (*pos < size && data[*pos] != '\n') {
+        (*pos)++;
+      }
+    } else if (std::isspace(data[*pos])) {
+      (*pos)++;
+    } else {
+      break;
+    }
+  }
+
+  if (*pos >= size || !std::isdigit(data[*pos])) {
+    return false;
+  }
+
+  long parsed = 0;
+  while (*pos < size && std::isdigit(data[*pos])) {
+    parsed = parsed * 10 + (data[*pos] - '0');
+    if (parsed > 1 << 30) {
+      return false;
+    }
+    (*pos)++;
+  }
+  *value = (int)parsed;
+  return true;
+}
+
+bool MappedImageFormatFromPath(const std::string &path,
+                               MappedImageFormat *format) {
+  size_t dot = path.find_last_of('.');
+  if (dot == std::string::npos) {
+    return false;
+  }
+
+  std::string extension = path.substr(dot + 1);
+  for (char &c : extension) {
+    c = (char)std::tolower(c);
+  }
+
+  if (extension == "raw") {
+    *format = MappedImageFormat::Raw;
+  } else if (extension == "pgm") {
+    *format = MappedImageFormat::Pgm;
+  } else if (extension == "pbm") {
+    *format = MappedImageFormat::Pbm;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+MappedImage MappedImage::Open(const std::string &path, int rawWidth,
+                              int rawHeight) {
+  MappedImage image;
+  if (!MappedImageFormatFromPath(path, &image.format)) {
+    throw std::runtime_error("MappedImage failed: unsupported extension " +
+                             path);
+  }
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw MappingError("cannot open", path);
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size == 0) {
+    close(fd);
+    throw MappingError("cannot stat or empty", path);
+  }
+
+  void *mapping =
+      mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    throw MappingError("cannot map", path);
+  }
+  madvise(mapping, (size_t)info.st_size, MADV_SEQUENTIAL);
+
+  image.mapping = mapping;
+  image.mappingSize = (size_t)info.st_size;
+
+  const unsigned char *data = (const unsigned char *)mapping;
+  size_t pos = 0;
+
+  if (image.format == MappedImageFormat::Raw) {
+    image.width = rawWidth;
+    image.height = rawHeight;
+  } else {
+    const char *magic = image.format == MappedImageFormat::Pgm ? "P5" : "P4";
+    int maxValue = 255;
+    bool valid = image.mappingSize > 2 && data[0] == magic[0] &&
+                 data[1] == magic[1];
+    pos = 2;
+    valid = valid && ReadHeaderField(data, image.mappingSize, &pos,
+                                     &image.width);
+    valid = valid && ReadHeaderField(data, image.mappingSize, &pos,
+                                     &image.height);
+    if (valid && image.format == MappedImageFormat::Pgm) {
+      valid = ReadHeaderField(data, image.mappingSize, &pos, &maxValue);
+    }
+    // Exactly one whitespace character separates the header from the pixels
+    valid = valid && pos < image.mappingSize && std::isspace(data[pos]);
+    if (!valid || maxValue <= 0 || maxValue > 255) {
+      throw std::runtime_error("MappedImage failed: not a binary 8-bit " +
+                               std::string(magic) + " file " + path);
+    }
+    pos++;
+    image.maxValue = maxValue;
+  }
+
+  if (image.width <= 0 || image.height <= 0 ||
+      image.mappingSize - pos < image.RowBytes() * image.height) {
+    throw std::runtime_error("MappedImage failed: size does not match the "
+                             "pixel data in " +
+                             path);
+  }
+
+  image.pixels = (unsigned char *)mapping + pos;
+  return image;
+}
+
+MappedImage MappedImage::Create(const std::string &path,
+                                MappedImageFormat format, int width,
+                                int height) {
+  MappedImage image;
+  image.format = format;
+  image.width = width;
+  image.height = height;
+
+  std::string header;
+  if (format == MappedImageFormat::Pgm) {
+    header = "P5\n" + std::to_string(width) + " " + std::to_string(height) +
+             "\n255\n";
+  } else if (format == MappedImageFormat::Pbm) {
+    header = "P4\n" + std::to_string(width) + " " + std::to_string(height) +
+             "\n";
+  }
+
+  size_t size = header.size() + image.RowBytes() * height;
+
+  int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    throw MappingError("cannot create", path);
+  }
+  if (ftruncate(fd, (off_t)size) != 0) {
+    close(fd);
+    throw MappingError("cannot resize", path);
+  }
+
+  void *mapping =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    throw MappingError("cannot map", path);
+  }
+
+  image.mapping = mapping;
+  image.mappingSize = size;
+  std::memcpy(mapping, header.data(), header.size());
+  image.pixels = (unsigned char *)mapping + header.size();
+  return image;
+}
+
+MappedImage::MappedImage(MappedImage &&other) noexcept {
+  *this = std::move(other);
+}
+
+MappedImage &MappedImage::operator=(MappedImage &&other) noexcept {
+  if (this != &other) {
+    if (mapping != nullptr) {
+      munmap(mapping, mappingSize);
+    }
+    format = other.format;
+    width = other.width;
+    height = other.height;
+    maxValue = other.maxValue;
+    pixels = other.pixels;
+    mapping = other.mapping;
+    mappingSize = other.mappingSize;
+    other.pixels = nullptr;
+    other.mapping = nullptr;
+    other.mappingSize = 0;
+  }
+  return *this;
+}
+
+MappedImage::~MappedImage() {
+  if (mapping != nullptr) {
+    munmap(mapping, mappingSize);
+  }
+}
+
+size_t MappedImage::RowBytes() const {
+  return format == MappedImageFormat::Pbm ? ((size_t)width + 7) / 8
+                                          : (size_t)width;
+}
+
+void ReadMappedPixels(const MappedImage &image, double *output) {
+  int width = image.width;
+  size_t rowBytes = image.RowBytes();
+  // PGM files with a smaller maxval are stretched to the thresholds' range
+  double scale = 255.0 / image.maxValue;
+
+#pragma omp parallel for schedule(static)
+  for (int y = 0; y < image.height; y++) {
+    const unsigned char *row = image.pixels + y * rowBytes;
+    double *outRow = output + (size_t)y * width;
+
+    if (image.format == MappedImageFormat::Pbm) {
+      for (int x = 0; x < width; x++) {
+        bool black = row[x >> 3] & (0x80 >> (x & 7));
+        outRow[x] = black ? 0.0 : 255.0;
+      }
+    } else if (image.maxValue == 255) {
+      for (int x = 0; x < width; x++) {
+        outRow[x] = row[x];
+      }
+    } else {
+      for (int x = 0; x < width; x++) {
+        outRow[x] = row[x] * scale;
+      }
+    }
+  }
+}
+
+void WriteMappedEdges(const double *edges, MappedImage &image) {
+  int width = image.width;
+  size_t rowBytes = image.RowBytes();
+
+#pragma omp parallel for schedule(static)
+  for (int y = 0; y < image.height; y++) {
+    const double *edgeRow = edges + (size_t)y * width;
+    unsigned char *row = image.pixels + y * rowBytes;
+
+    if (image.format == MappedImageFormat::Pbm) {
+      std::memset(row, 0, rowBytes);
+      for (int x = 0; x < width; x++) {
+        if (edgeRow[x] != 0) {
+          row[x >> 3] |= 0x80 >> (x & 7);
+        }
+      }
+    } else {
+      for (int x = 0; x < width; x++) {
+        row[x] = edgeRow[x] != 0 ? 255 : 0;
+      }
+    }
+  }
+}
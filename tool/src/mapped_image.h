@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+enum class MappedImageFormat { Raw, Pgm, Pbm };
+
+/**
+ * @brief Uncompressed image file mapped into memory with mmap. Supports
+ * headerless 8-bit raw, binary PGM (P5, maxval <= 255) and binary PBM (P4).
+ *
+ * `pixels` points straight into the mapping, right after the header, so
+ * reading and writing go through the page cache without a decode/encode step
+ * or an intermediate copy.
+ */
+class MappedImage {
+public:
+  /**
+   * @brief Map an existing file read-only. Raw files have no header, their
+   * size has to be given.
+   */
+  static MappedImage Open(const std::string &path, int rawWidth = 0,
+                          int rawHeight = 0);
+
+  /**
+   * @brief Create (or truncate) a file of the right size, write its header and
+   * map it read-write
+   */
+  static MappedImage Create(const std::string &path, MappedImageFormat format,
+                            int width, int height);
+
+  MappedImage(MappedImage &&other) noexcept;
+  MappedImage &operator=(MappedImage &&other) noexcept;
+  MappedImage(const MappedImage &) = delete;
+  MappedImage &operator=(const MappedImage &) = delete;
+  ~MappedImage();
+
+  // Bytes per row of the pixel payload, PBM packs 8 pixels per byte
+  size_t RowBytes() const;
+
+  MappedImageFormat format = MappedImageFormat::Raw;
+  int width = 0;
+  int height = 0;
+  // Value of white in the pixels, the PGM maxval and 255 otherwise
+  int maxValue = 255;
+  unsigned char *pixels = nullptr;
+
+private:
+  MappedImage() = default;
+
+  void *mapping = nullptr;
+  size_t mappingSize = 0;
+};
+
+/**
+ * @brief Pick the format from the file extension (.raw, .pgm, .pbm). Returns
+ * false for anything else.
+ */
+bool MappedImageFormatFromPath(const std::string &path,
+                               MappedImageFormat *format);
+
+/**
+ * @brief Expand the mapped pixels to doubles in [0, 255], scaling PGM values
+ * by 255 / maxval. PBM set bits are black (0), clear bits white (255).
+ */
+void ReadMappedPixels(const MappedImage &image, double *output);
+
+/**
+ * @brief Write an edge map into a mapped image: non-zero edges become 255 in
+ * raw/PGM and set bits in PBM
+ */
+void WriteMappedEdges(const double *edges, MappedImage &image);
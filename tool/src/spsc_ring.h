@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Tries of a blocking push or pop before it sleeps
+#define SPSC_RING_SPIN_TRIES 64
+
+/**
+ * @brief Bounded lock-free queue between exactly one producer thread and one
+ * consumer thread.
+ *
+ * Each side only writes its own index, so a push or a pop is one acquire
+ * load of the other side's index and one release store of its own. The
+ * indices sit on separate cache lines so the two threads do not bounce one
+ * line between their cores. A full or empty ring makes the blocking
+ * versions retry a few times, then sleep on a condition variable until the
+ * other side moves, so a stage waiting on the detector does not hold a core
+ * the detector's threads need. The lock is only taken while a side sleeps.
+ */
+template <class T> class SpscRing {
+public:
+  // One slot stays empty to tell a full ring from an empty one
+  explicit SpscRing(size_t capacity) : slots(capacity + 1) {}
+
+  SpscRing(const SpscRing &) = delete;
+  SpscRing &operator=(const SpscRing &) = delete;
+
+  /**
+   * @brief Move `value` in unless the ring is full. Returns whether it did.
+   */
+  bool TryPush(T &value) {
+    size_t at = tail.load(std::memory_order_relaxed);
+    size_t next = at + 1 == slots.size() ? 0 : at + 1;
+    if (next == head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    slots[at] = std::move(value);
+    tail.store(next, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Move the oldest value out into `value` unless the ring is empty.
+   * Returns whether it did.
+   */
+  bool TryPop(T &value) {
+    size_t at = head.load(std::memory_order_relaxed);
+    if (at == tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+    value = std::move(slots[at]);
+    head.store(at + 1 == slots.size() ? 0 : at + 1,
+               std::memory_order_release);
+    return true;
+  }
+
+  void Push(T value) {
+    Wait([&] { return TryPush(value); });
+  }
+
+  T Pop() {
+    T value;
+    Wait([&] { return TryPop(value); });
+    return value;
+  }
+
+private:
+  /**
+   * @brief Retry `done` until it succeeds, sleeping after a few tries, then
+   * wake the other side if it sleeps
+   */
+  template <class F> void Wait(F done) {
+    bool moved = false;
+    for (int i = 0; i < SPSC_RING_SPIN_TRIES && !moved; i++) {
+      moved = done();
+      if (!moved) {
+        std::this_thread::yield();
+      }
+    }
+
+    if (!moved) {
+      std::unique_lock<std::mutex> lock(mutex);
+      sleepers.fetch_add(1);
+      // Pairs with the fence in Wake(): either this check sees the other
+      // side's move, or the other side sees this sleeper
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      changed.wait(lock, done);
+      sleepers.fetch_sub(1);
+    }
+
+    Wake();
+  }
+
+  void Wake() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers.load(std::memory_order_relaxed) > 0) {
+      std::lock_guard<std::mutex> lock(mutex);
+      changed.notify_all();
+    }
+  }
+
+  std::vector<T> slots;
+  // Next slot to pop, written by the consumer only
+  alignas(64) std::atomic<size_t> head{0};
+  // Next slot to push, written by the producer only
+  alignas(64) std::atomic<size_t> tail{0};
+  // Sides sleeping in Wait(), the lock and condition variable are only used
+  // when there is one
+  alignas(64) std::atomic<int> sleepers{0};
+  std::mutex mutex;
+  std::condition_variable changed;
+};